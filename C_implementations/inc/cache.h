@@ -0,0 +1,65 @@
+/*==========================================================================================
+** cache.h
+** By Chris Winstead
+
+** Description:
+   Persistent store of simulation results, so that sweeps do not
+   repeat points that were already simulated. With --cache=dir a
+   simulator looks up its point in dir before running. The entry
+   for a point is the final run state in snapshot.h format, kept in
+
+     dir/<key>.result
+
+   where <key> is a 64-bit FNV-1a hash of
+     - the binary name (each decoder variant and its -D options is
+       a separate binary) and the contents of the executable, so a
+       rebuilt decoder does not reuse the old one's results,
+     - the contents of the code file, of the codeword file if one
+       is given and of the --is-positions file,
+     - every positional argument except the log file name,
+     - every option except those that only decide how long to run
+       (--frames, --min-frames, --relwidth, --target-fer, --ber,
+       --confidence, --ci) and bookkeeping switches,
+     - the seed policy: the --crn seed, or "clock".
+
+   A found entry is loaded and the run continues from its counts,
+   so the stopping rule sees the cached frames. If the rule is
+   already met, no frames are simulated and the cached result is
+   reported and logged; otherwise new frames are added until it is
+   met. The updated state is stored back at the end of the run.
+
+   Under --crn the new frames continue the cached frame indices.
+   Stores are serialized with a lock file, and an entry is never
+   replaced by one with fewer frames. Two processes extending the
+   same entry at once both finish, but only the larger result is
+   kept.
+
+** Usage:
+    cache_struct cache;
+    setupCache(cache, snap, crn, argv[0], logfilename);
+    loadCachedResult(cache, snap);
+    ...
+    storeCachedResult(cache, snap);
+==============================================================================================*/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <vector>
+#include <string>
+#include "rng.h"
+#include "snapshot.h"
+
+typedef struct {
+  int enabled ;
+  std::string fileName ;
+  std::vector<std::string> params ;   /* canonical key material */
+} cache_struct ;
+
+
+unsigned long long fnv1a(const std::string & text, unsigned long long h = 0xcbf29ce484222325ULL);
+void setupCache(cache_struct & cache, snapshot_struct & snap, crn_struct & crn, const char * binary, std::string logfilename);
+bool loadCachedResult(cache_struct & cache, snapshot_struct & snap);
+void storeCachedResult(cache_struct & cache, snapshot_struct & snap);
+
+#endif
@@ -0,0 +1,68 @@
+/*==========================================================================================
+** checkpoints.h
+** By Chris Winstead
+
+** Description:
+   Evaluates several iteration limits in a single run. With
+   --checkpoints=50,100,200,400 the decoder still runs to its full
+   T, but at the top of each listed iteration the current decisions
+   are scored as if decoding had been cut off there. A frame that
+   stops early (all checks satisfied) contributes its final result
+   to every larger checkpoint, so each row matches what a separate
+   run with that T would report on the same frames.
+
+   Decoders with output smoothing (decodeSMGDBF, decodeSATGDBF,
+   decodeSMNGDBF) output the majority of the decisions over the last
+   windowsize iterations. They keep one such window per checkpoint,
+   ending at that checkpoint, and score its majority instead of the
+   current decisions.
+
+   Checkpoints above T are dropped and T itself is always included.
+   Results are printed at the end of the run and appended, one row
+   per checkpoint, to <logfilename>.checkpoints:
+
+     SNR  T  BER  avg.iterations  FER  totalBits  totalWords  code
+
+** Usage:
+    checkpoint_struct cp;
+    setupCheckpoints(cp, num_iterations);
+    beginCheckpointFrame(cp);
+    for (it=0; it<T; it++) {
+      if (checkpointDue(cp,it))
+        recordCheckpoint(cp, countDecisionErrors(d,c), it);
+      ...
+    }
+    finishCheckpointFrame(cp, newErrors, it);
+==============================================================================================*/
+
+#ifndef CHECKPOINTS_H
+#define CHECKPOINTS_H
+
+#include <vector>
+#include <string>
+
+typedef struct {
+  int  enabled ;
+  int  next ;                   /* next checkpoint for the current frame */
+  std::vector<int>  T ;         /* increasing iteration limits */
+  std::vector<long> bitErrors ;
+  std::vector<long> wordErrors ;
+  std::vector<long> iterations ;
+  long frames ;
+  int  N ;
+} checkpoint_struct ;
+
+
+void setupCheckpoints(checkpoint_struct & cp, int maxIterations, int N);
+void beginCheckpointFrame(checkpoint_struct & cp);
+void recordCheckpoint(checkpoint_struct & cp, int frameErrors, int it);
+void finishCheckpointFrame(checkpoint_struct & cp, int frameErrors, int it);
+void reportCheckpoints(checkpoint_struct & cp);
+void writeCheckpointLog(checkpoint_struct & cp, std::string logfilename, double SNR, const char * codeName);
+
+inline bool checkpointDue(checkpoint_struct & cp, int it)
+{
+  return cp.enabled && (cp.next < cp.T.size()) && (cp.T[cp.next] == it);
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*==========================================================================================
+** console.h
+** By Chris Winstead
+
+** Description:
+   Buffered console output written by a background thread, so the
+   decode loop never blocks on or flushes stdout. Each message is
+   handed to a single-producer/single-consumer ring of strings
+   (lock-free: one atomic index per side). The writer thread
+   drains the ring with fwrite() and flushes once per batch.
+
+   Messages are of two kinds:
+
+     CONSOLE_EVENT    per-frame reports such as "Ferr with ...".
+                      At most --console-rate=n are printed per
+                      second (default 10, 0 for none); the rest are
+                      dropped, as are events arriving while the
+                      ring is full.
+     CONSOLE_SUMMARY  periodic results; never dropped. The number
+                      of suppressed events since the previous
+                      summary is printed ahead of it.
+
+   drainConsole() waits until everything queued has been written;
+   call it before printing directly with cout again. The ring is
+   also drained when the program exits. Without setupConsole()
+   messages are written synchronously.
+
+** Usage:
+    setupConsole();
+    while (...) {
+      ostringstream msg;
+      msg << "Ferr with " << newErrors << " errors.\n";
+      consoleWrite(msg.str(), CONSOLE_EVENT);
+    }
+    drainConsole();
+==============================================================================================*/
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <string>
+
+#define CONSOLE_EVENT    0
+#define CONSOLE_SUMMARY  1
+
+#define CONSOLE_SLOTS 4096   /* ring capacity, a power of two */
+
+void setupConsole();
+void consoleWrite(const std::string & msg, int kind);
+void drainConsole();
+
+#endif
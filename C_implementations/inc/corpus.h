@@ -0,0 +1,76 @@
+/*==========================================================================================
+** corpus.h
+** By Chris Winstead
+
+** Description:
+   Binary corpus of failed frames for offline re-decoding. With
+   --corpus-out=f a simulator appends every frame it fails to
+   decode to f: the channel samples as the decoder received them,
+   the transmitted codeword, the decoder's final decisions, the
+   frame index, bit errors and iterations. Samples and bits are
+   stored in the code's natural symbol order, so --reorder does not
+   affect the corpus. The simulators register corpus.out with the
+   snapshot (snapshotFile), so --resume trims records appended after
+   the snapshot was taken instead of writing them again.
+
+   With --corpus-in=f a simulator decodes the frames of f instead
+   of simulating the channel, one record per frame, stopping after
+   the last record (or at --frames). Any decoder or parameter set
+   can be applied to the same hard frames; the SNR argument still
+   sets the decoder's sigma and should match the corpus. Combined
+   with --shard/--merge-shards, the corpus is split across
+   processes; scripts/redecodeCorpus.sh does this.
+
+   File layout (native byte order):
+     "LDPCCOR1"  int32 N  int32 textLength  double SNR  double R
+     text        binary name and arguments of the writing run
+     records     frame (int64), errors (int32), iterations (int32),
+                 y (N doubles), codeword bits and decision bits
+                 (each (N+7)/8 bytes, bit i in byte i/8, LSB first)
+
+   Records have fixed size, so record k is read directly. Tools
+   open a corpus with openCorpus() and read each record's codeword
+   and decisions with readCorpusBits().
+
+** Usage:
+    corpus_struct corpus;
+    setupCorpus(corpus, H.N, SNR, R, stop, reordered ? &order : NULL, argc, argv);
+    if (corpus.replay) readCorpusFrame(corpus, frame, c, x, -1);
+    y[i] = corpus.replay ? corpus.y[i] : ...;
+    if (newErrors > 0) writeCorpusFrame(corpus, frame, newErrors, it, y, c, d, -1);
+==============================================================================================*/
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include "reorder.h"
+#include "stopping.h"
+
+#define CORPUS_MAGIC "LDPCCOR1"
+
+typedef struct {
+  int  N ;
+  FILE * out ;                 /* --corpus-out, or NULL */
+  FILE * in ;                  /* --corpus-in, or NULL */
+  int  replay ;
+  long records ;               /* records in the input corpus */
+  long headerSize ;
+  long recordSize ;
+  reorder_struct * order ;     /* decoder symbol order, or NULL */
+  std::vector<double> y ;      /* samples of the frame being replayed, decoder order */
+  std::vector<unsigned char> buffer ;
+} corpus_struct ;
+
+
+void setupCorpus(corpus_struct & corpus, int N, double SNR, double R, stopping_struct & stop, reorder_struct * order, int argc, char * argv[]);
+void readCorpusFrame(corpus_struct & corpus, long frame, std::vector<int> & c, std::vector<double> & x, int one);
+void writeCorpusFrame(corpus_struct & corpus, long frame, int errors, int iterations, std::vector<double> & y, std::vector<int> & c, std::vector<int> & d, int one);
+void closeCorpus(corpus_struct & corpus);
+
+bool openCorpus(corpus_struct & corpus, const std::string & fileName);
+void readCorpusBits(corpus_struct & corpus, long frame, std::vector<int> & c, std::vector<int> & d);
+
+#endif
@@ -0,0 +1,67 @@
+/*==========================================================================================
+** encoder.h
+** By Chris Winstead
+
+** Description:
+   Systematic encoder built directly from the parity-check matrix
+   in an alist_struct, so that every simulated frame can carry a
+   fresh random codeword instead of cycling through a data.enc
+   file made offline with Neal's make-gen/encode tools.
+
+   Two encoding paths are supported:
+    - sparse: if the last M columns of H can be resolved one at a
+      time by back-substitution (staircase/dual-diagonal parity as
+      in DVB-S2 and other IRA codes), each parity bit is computed
+      from a single row of H in O(edges) time.
+    - dense:  otherwise H is reduced to row-echelon form over GF(2)
+      on bit-packed rows (the same elimination as invert_cmatrix in
+      r.cpp, but one machine word per 64 entries), and the parity
+      bits are accumulated by XORing packed columns.
+
+** Usage:
+    encoder_struct E;
+    setupEncoder(H, E);
+    encodeRandom(E, bits);   // bits[i] in {0,1}, length H.N
+==============================================================================================*/
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <vector>
+#include "alist.h"
+
+typedef unsigned long long encword;
+#define ENCWORD_BITS 64
+
+typedef struct {
+  int N, M ;        /* size of the parity-check matrix */
+  int K ;           /* number of information bits, N - rank(H) */
+  int rank ;        /* GF(2) rank of H */
+  int sparse ;      /* 1 if the back-substitution path is used */
+  std::vector<int> info_cols ;    /* codeword positions carrying information bits */
+  std::vector<int> parity_cols ;  /* codeword positions carrying parity bits */
+
+  /* sparse path: parity_cols[i] is resolved from row sched_row[i] */
+  std::vector<int> sched_row ;
+  std::vector<std::vector<int> > rows ;  /* zero-based copy of mlist */
+
+  /* pivot bits on the sparse path */
+  int gap ;
+  std::vector<int> gap_cols ;     /* codeword positions of the pivot bits */
+  std::vector<int> check_rows ;   /* rows not used by the schedule */
+  int gapWords , parityWords ;
+  std::vector<encword> gapEffect ;  /* per pivot bit: scheduled parity bits it flips */
+  std::vector<encword> gapSolve ;   /* per pivot bit: unused checks that determine it */
+
+  /* dense path: column k of the parity generator, packed in 'words' words */
+  int words ;
+  std::vector<encword> G ;
+} encoder_struct ;
+
+
+int  setupEncoder(alist_struct & H, encoder_struct & E);
+void encodeBits(encoder_struct & E, std::vector<int> & info, std::vector<int> & bits);
+void encodeRandom(encoder_struct & E, std::vector<int> & bits);
+int  checkCodeword(alist_struct & H, std::vector<int> & bits);
+
+#endif
@@ -0,0 +1,71 @@
+/*==========================================================================================
+** extrapolate.h
+** By Chris Winstead
+
+** Description:
+   FER/BER at nearby SNRs from a run at a single anchor SNR. Every
+   frame's channel noise is e = sigma0*n over N positions, so the
+   likelihood ratio for moving to noise level sigma depends only on
+   the frame's noise energy S = sum(n^2):
+
+      log w = N log(sigma0/sigma) - (S/2)(sigma0^2/sigma^2 - 1)
+
+   Weighted means of the frame error indicator and error fraction
+   then estimate FER and BER at each requested SNR. In importance-
+   sampling mode the IS weight is folded in.
+
+   The estimate refers to the anchor-SNR decoder applied to the new
+   channel. For min-sum and GDBF, whose processing does not depend
+   on sigma, that is the decoder at the new SNR. BP (LLR scaling)
+   and the noisy GDBF variants (perturbation tied to sigma) differ
+   slightly.
+
+   Validity: the weights degenerate as the target moves away from
+   the anchor. The spread of log w is about
+   sqrt(N/2)*|sigma0^2/sigma^2 - 1|, so a reliable window narrows as
+   1/sqrt(N). Each point reports the Kish effective sample size and
+   is flagged when it falls below 10% of the frames or fewer than
+   10 failures carry weight. The window where the log-weight spread
+   stays below one is printed as well.
+
+   Frames replayed with --corpus-in or read with --llr-in carry no
+   noise energy, so --extrapolate refuses both.
+
+   Options:
+     --extrapolate=s1,s2,...   target Eb/N0 values in dB
+
+** Usage:
+    extrap_struct X;
+    setupExtrapolation(X, SNR, R, H.N);
+    recordExtrapolationFrame(X, IS, newErrors);
+    reportExtrapolation(X);
+==============================================================================================*/
+
+#ifndef EXTRAPOLATE_H
+#define EXTRAPOLATE_H
+
+#include <vector>
+#include <string>
+#include "impsample.h"
+
+typedef struct {
+  int    enabled ;
+  double SNR0 , sigma0 , R ;
+  int    N ;
+  long   frames ;
+  std::vector<double> SNR ;        /* target points */
+  std::vector<double> logRatio ;   /* N log(sigma0/sigma) for each target */
+  std::vector<double> energyCoef ; /* (sigma0^2/sigma^2 - 1)/2 for each target */
+  std::vector<double> sumW , sumW2 ;
+  std::vector<double> sumWE , sumW2E ;
+  std::vector<double> sumWB , sumW2B ;
+  std::vector<long>   failures ;   /* failed frames carrying nonzero weight */
+} extrap_struct ;
+
+
+void setupExtrapolation(extrap_struct & X, double SNR, double R, int N);
+void recordExtrapolationFrame(extrap_struct & X, is_struct & IS, int bitErrors);
+void reportExtrapolation(extrap_struct & X);
+void writeExtrapolationLog(extrap_struct & X, std::string logfilename, const char * codeName);
+
+#endif
@@ -0,0 +1,56 @@
+/*==========================================================================================
+** generic.h
+** By Chris Winstead
+
+** Description:
+   Reference kernels that work on any code straight from the alist
+   adjacency lists. The simulators fall back to these when neither
+   the QC kernels (qc.h) nor the degree-specialized ones (regular.h)
+   apply, and benchmark.cpp times them as the baseline for both.
+
+   Messages are kept per node, as the simulators always have:
+
+      sym_to_check[i][j]   message from symbol i on its j-th edge
+                           (nlist order)
+      check_to_sym[m][k]   message from check m on its k-th edge
+                           (mlist order)
+
+   and every gather looks up the partner's edge index with a linear
+   search of its list, so the cost grows with the node degrees.
+
+   Min-sum and BP share the symbol update; maxLLR clips the outgoing
+   messages as in decodeBP (0 for no clipping, as in qcSymNodeUpdates).
+   The bit-flipping kernels take bipolar decisions d (+1/-1) and
+   produce the bipolar syndrome (-1 for an unsatisfied check) and
+   the per-symbol count of unsatisfied checks, the alist
+   counterparts of qcSyndrome() and qcUnsatisfiedCounts().
+
+** Usage:
+    vector<vector<double> > sym_to_check, check_to_sym;
+    setupGenericMessages(H, sym_to_check, check_to_sym);
+    initializeGenericMessages(H, sym_to_check, y);
+    genericMinSumCheckUpdates(H, sym_to_check, check_to_sym);
+    genericSymNodeUpdates(H, y, d, sym_to_check, check_to_sym, 0.0);
+
+    satisfied = genericSyndrome(H, d, syndrome);
+    genericUnsatisfiedCounts(H, syndrome, counts);
+==============================================================================================*/
+
+#ifndef GENERIC_H
+#define GENERIC_H
+
+#include <vector>
+#include "alist.h"
+
+//--- Min-sum / BP kernels ---//
+void setupGenericMessages(alist_struct & H, std::vector<std::vector<double> > & sym_to_check, std::vector<std::vector<double> > & check_to_sym);
+void initializeGenericMessages(alist_struct & H, std::vector<std::vector<double> > & sym_to_check, std::vector<double> & y);
+void genericMinSumCheckUpdates(alist_struct & H, std::vector<std::vector<double> > & sym_to_check, std::vector<std::vector<double> > & check_to_sym);
+void genericBPCheckUpdates(alist_struct & H, std::vector<std::vector<double> > & sym_to_check, std::vector<std::vector<double> > & check_to_sym);
+void genericSymNodeUpdates(alist_struct & H, std::vector<double> & y, std::vector<int> & d, std::vector<std::vector<double> > & sym_to_check, std::vector<std::vector<double> > & check_to_sym, double maxLLR);
+
+//--- Bit-flipping kernels ---//
+bool genericSyndrome(alist_struct & H, std::vector<int> & d, std::vector<int> & syndrome);
+void genericUnsatisfiedCounts(alist_struct & H, std::vector<int> & syndrome, std::vector<int> & counts);
+
+#endif
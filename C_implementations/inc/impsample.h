@@ -0,0 +1,70 @@
+/*==========================================================================================
+** impsample.h
+** By Chris Winstead
+
+** Description:
+   Importance-sampling channel for estimating very low error rates.
+   The simulators form channel samples as y = x*(1 + sigma*n) with
+   n ~ N(0,1), so an error on bit i needs n < -1/sigma. Here n is
+   drawn from the biased density N(-shift, scale^2) on a chosen set
+   of positions (all bits by default), which pushes those samples
+   toward the decision boundary. Each frame carries the likelihood
+   ratio
+
+      w = prod_i  phi(n_i) / q(n_i)
+
+   over the biased positions, and FER/BER are estimated as the
+   weighted means of the frame error indicator and error fraction,
+   with standard errors from the sample second moments.
+
+   Options:
+     --is-shift=m       mean shift of the noise toward the boundary
+                        (m near 1/sigma centers samples on it)
+     --is-scale=s       standard deviation of the biased noise (default 1)
+     --is-positions=f   file of 0-based bit indices to bias, e.g. a
+                        known trapping set; all bits if omitted
+
+   Either of --is-shift or --is-scale turns the mode on.
+
+** Usage:
+    is_struct IS;
+    setupImportanceSampling(IS, H.N);
+    beginISFrame(IS);
+    for (i...) y[i] = x[i]*(1.0+sigma*channelNoise(IS,i));
+    ...
+    recordISFrame(IS, newErrors, H.N);
+==============================================================================================*/
+
+#ifndef IMPSAMPLE_H
+#define IMPSAMPLE_H
+
+#include <vector>
+#include <ostream>
+
+typedef struct {
+  int    enabled ;
+  double shift ;               /* biased noise mean is -shift */
+  double scale ;               /* biased noise standard deviation */
+  std::vector<char> biased ;   /* 1 where the biased density applies */
+  int    numBiased ;
+  double frameLogWeight ;      /* log likelihood ratio of the current frame */
+  double frameEnergy ;         /* sum of n^2 over the current frame, all positions */
+
+  /* accumulators over frames */
+  long   frames ;
+  double sumW , sumW2 ;        /* sum of w and w^2 */
+  double sumWE , sumW2E ;      /* sum of w*e and (w*e)^2, e = frame error indicator */
+  double sumWB , sumW2B ;      /* sum of w*b and (w*b)^2, b = bit error fraction */
+} is_struct ;
+
+
+void   setupImportanceSampling(is_struct & IS, int N);
+void   beginISFrame(is_struct & IS);
+double channelNoise(is_struct & IS, int i);
+void   recordISFrame(is_struct & IS, int bitErrors, int N);
+void   isEstimates(is_struct & IS, double & fer, double & ferStd, double & ber, double & berStd);
+double isEffectiveSampleSize(is_struct & IS);
+void   reportIS(is_struct & IS);
+void   writeISColumns(is_struct & IS, std::ostream & of);
+
+#endif
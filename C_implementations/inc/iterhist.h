@@ -0,0 +1,61 @@
+/*==========================================================================================
+** iterhist.h
+** By Chris Winstead
+
+** Description:
+   Integer histograms of decoding iterations and phases. Each
+   frame adds one count to iterations[k], where k is the number of
+   iterations it used (k = T when the decoder did not converge),
+   and one count to phases[p] for the phase whose result was kept
+   (always 0 for single-phase decoders). A frame costs two integer
+   increments; distributions are computed only when reported.
+
+   Both vectors are registered with the snapshot module as
+   ordinary long vectors, so snapshots, cache entries and shard
+   records carry them and merging adds the counts exactly. They
+   appear by name in JSON result records.
+
+   iterationSurvival() gives the fraction of frames that used at
+   least k iterations, k = 0..T-1, the distribution NGDBFhw writes
+   to <logfilename>_<SNR>_itdist.dat.
+
+** Usage:
+    iterhist_struct iters;
+    setupIterationHistogram(iters, num_iterations, 1);
+    snapshotField(snap, "iterations", iters.iterations);
+    snapshotField(snap, "phases", iters.phases);
+    ...per frame...
+    recordIterations(iters, it, 0);
+    ...
+    reportIterations(iters);
+==============================================================================================*/
+
+#ifndef ITERHIST_H
+#define ITERHIST_H
+
+#include <vector>
+
+typedef struct {
+  int T ;
+  std::vector<long> iterations ;   /* T+1 bins */
+  std::vector<long> phases ;
+} iterhist_struct ;
+
+
+void setupIterationHistogram(iterhist_struct & h, int T, int numPhases);
+void iterationSurvival(iterhist_struct & h, std::vector<double> & survival);
+long iterationPercentile(iterhist_struct & h, double p);
+void reportIterations(iterhist_struct & h);
+
+
+inline void recordIterations(iterhist_struct & h, int it, int phase)
+{
+  if (it < 0)
+    it = 0;
+  if (it > h.T)
+    it = h.T;
+  h.iterations[it]++;
+  h.phases[phase]++;
+}
+
+#endif
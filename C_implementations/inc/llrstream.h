@@ -0,0 +1,103 @@
+/*==========================================================================================
+** llrstream.h
+** By Chris Winstead
+
+** Description:
+   Decode captured receiver output instead of simulated AWGN.
+   With --llr-in=f the decoders take each frame's channel values
+   from f, N values per frame, until the file ends (or --frames):
+
+     --llr-in=f         a binary file (memory-mapped), or - for stdin
+     --llr-format=t     f32 (default), f64, i8 or i16, native byte order
+     --llr-scale=s      multiply every value by s (for quantized input)
+     --llr-samples      values are channel samples y, not LLRs
+     --llr-out=f        write each frame's decisions to f
+
+   LLRs follow log P(0)/P(1) and are converted to the samples the
+   decoders expect with y = L*sigma^2/2, sigma coming from the SNR
+   argument, so a BP decoder sees exactly the LLRs given. Values
+   are in the code's natural symbol order.
+
+   The output holds (N+7)/8 bytes per frame, bit i of the decision
+   in byte i/8, LSB first (as in corpus.h), in natural order and
+   frame order. A named pipe works for either end.
+
+   Reading and converting run on one thread and packing and writing
+   on another, each a ring of LLR_SLOTS frames away from the decode
+   loop, so decoding overlaps the I/O. Error counts are still taken
+   against the configured codeword source (all-zero by default).
+   Streams cannot be combined with --corpus-in, --shard, --cache or
+   --resume, which assume simulated frames.
+
+** Usage:
+    llrstream_struct stream;
+    setupLLRStream(stream, H.N, sigma, stop, reordered ? &order : NULL);
+    while (keepSimulating(...) && nextLLRFrame(stream)) {
+      y[i] = stream.enabled ? stream.y[i] : ...;
+      ...decode...
+      writeLLRDecisions(stream, d, -1);
+    }
+    closeLLRStream(stream);
+==============================================================================================*/
+
+#ifndef LLRSTREAM_H
+#define LLRSTREAM_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "reorder.h"
+#include "stopping.h"
+
+#define LLR_SLOTS 64        /* frames buffered on each side of the decoder */
+
+#define LLR_F32  0
+#define LLR_F64  1
+#define LLR_I8   2
+#define LLR_I16  3
+
+typedef struct {
+  int  enabled ;
+  int  N ;
+  int  format ;
+  int  valueBytes ;
+  double scale ;            /* applied to every value read */
+  reorder_struct * order ;  /* decoder symbol order, or NULL */
+  std::string inName , outName ;
+
+  /* input: a mapped file, or a descriptor read frame by frame */
+  int  fd ;
+  const unsigned char * map ;
+  size_t mapSize ;
+  size_t offset ;
+  size_t partialBytes ;     /* trailing bytes short of a frame */
+  std::vector<unsigned char> chunk ;
+
+  /* output */
+  FILE * out ;
+  std::vector<unsigned char> packed ;
+
+  std::vector<double> y ;   /* the current frame, decoder order */
+
+  /* pipeline: frames [taken,read) are ready for the decoder and
+     frames [written,queued) are waiting to be written */
+  std::vector<std::vector<double> > inSlots ;
+  std::vector<std::vector<int> > outSlots ;
+  std::vector<int> outOne ;
+  long read , taken , queued , written ;
+  bool inputDone , closing ;
+  std::mutex m ;
+  std::condition_variable cv ;
+  std::thread reader , writer ;
+} llrstream_struct ;
+
+
+void setupLLRStream(llrstream_struct & st, int N, double sigma, stopping_struct & stop, reorder_struct * order);
+bool nextLLRFrame(llrstream_struct & st);
+void writeLLRDecisions(llrstream_struct & st, std::vector<int> & d, int one);
+void closeLLRStream(llrstream_struct & st);
+
+#endif
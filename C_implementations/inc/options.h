@@ -0,0 +1,37 @@
+/*==========================================================================================
+** options.h
+** By Chris Winstead
+
+** Description:
+   Optional switches of the form --name or --name=value. They may
+   appear anywhere on the command line; parseOptions() removes them
+   from argv so the positional argument checks in each simulator
+   are unaffected. A switch that is not listed in optionUsage() (or
+   in the usage text a tool passes to parseOptions()) is an error,
+   as is a numeric value with trailing characters.
+
+** Usage:
+    parseOptions(argc, argv);
+    parseOptions(argc, argv, "--downsample=k --threads=n");   // tools
+    if (hasOption("reorder")) ...
+    long n = optionLong("frames", 0);
+==============================================================================================*/
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <map>
+
+int    parseOptions(int & argc, char * argv[]);
+int    parseOptions(int & argc, char * argv[], const std::string & usage);
+bool   hasOption(const char * name);
+std::string optionString(const char * name, const char * defaultValue);
+long   optionLong(const char * name, long defaultValue);
+double optionDouble(const char * name, double defaultValue);
+void   printOptions();
+std::map<std::string,std::string> allOptions();
+bool   stoppingOption(const std::string & name);
+std::string optionUsage();
+
+#endif
@@ -0,0 +1,48 @@
+/*==========================================================================================
+** outcomes.h
+** By Chris Winstead
+
+** Description:
+   Per-frame outcome records for paired comparisons. With
+   --outcomes=file a simulator appends one fixed-size record per
+   frame: frame index, bit errors after decoding, and iterations.
+   Runs made with the same --crn seed see the same channel on each
+   frame index, so compareOutcomes can pair their records and
+   report how often one configuration failed where the other
+   succeeded.
+
+   File layout: the 8-byte magic "LDPCOUT1", then records of
+   outcome_record in native byte order.
+
+** Usage:
+    outcome_struct out;
+    openOutcomeFile(out);
+    writeOutcome(out, frame, errors, iterations);
+    closeOutcomeFile(out);
+==============================================================================================*/
+
+#ifndef OUTCOMES_H
+#define OUTCOMES_H
+
+#include <cstdio>
+
+#define OUTCOME_MAGIC "LDPCOUT1"
+
+typedef struct {
+  long long frame ;
+  int errors ;
+  int iterations ;
+} outcome_record ;
+
+typedef struct {
+  FILE * fp ;
+} outcome_struct ;
+
+
+void openOutcomeFile(outcome_struct & out);
+void writeOutcome(outcome_struct & out, long frame, int errors, int iterations);
+void closeOutcomeFile(outcome_struct & out);
+FILE * openOutcomeFileForReading(const char * fileName);
+int  readOutcome(FILE * fp, outcome_record & rec);
+
+#endif
@@ -0,0 +1,83 @@
+/*==========================================================================================
+** perfcounters.h
+** By Chris Winstead
+
+** Description:
+   Hardware performance counters around the check-node and
+   symbol-node phases. Built only with -D perfCounters (make
+   PERF=1); otherwise the PERF_* macros expand to nothing.
+
+   A perf_event_open group of four user-space counters is opened
+   for the calling thread: cycles, instructions, last-level cache
+   misses and branch misses. The whole group is read with one
+   read() call at PERF_BEGIN and at PERF_END, and the difference is
+   added to the phase named at PERF_END. Counters the processor or
+   kernel does not provide are left out; if none can be opened
+   (e.g. perf_event_paranoid > 2, or no PMU in a VM) a message is
+   printed and the macros do nothing.
+
+   The report gives each phase's totals with per-frame and per-edge
+   rates (counts / (edges x iterations)) and instructions per
+   cycle. Rows are also appended to <logfilename>.perf:
+
+     SNR  phase  event  count  per-frame  per-edge  frames  iterations  code
+
+** Usage:
+    PERF_COUNTERS(P, H);
+    PERF_BEGIN(P);  checkNodeUpdates(...);  PERF_END(P, PERF_PHASE_CHECK);
+    PERF_BEGIN(P);  symNodeUpdates(...);    PERF_END(P, PERF_PHASE_SYMBOL);
+    PERF_FRAME(P);
+    PERF_REPORT(P, logfilename, SNR, argv[1]);
+==============================================================================================*/
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <string>
+#include "alist.h"
+
+#define PERF_CYCLES         0
+#define PERF_INSTRUCTIONS   1
+#define PERF_LLC_MISSES     2
+#define PERF_BRANCH_MISSES  3
+#define PERF_EVENTS         4
+
+#define PERF_PHASE_CHECK    0
+#define PERF_PHASE_SYMBOL   1
+#define PERF_PHASES         2
+
+typedef struct {
+  int  enabled ;
+  int  leader ;                      /* group leader fd */
+  int  fd[PERF_EVENTS] ;             /* -1 for unavailable events */
+  int  slot[PERF_EVENTS] ;           /* position in the group read, or -1 */
+  int  opened ;
+  unsigned long long start[PERF_EVENTS] ;
+  unsigned long long counts[PERF_PHASES][PERF_EVENTS] ;
+  long calls[PERF_PHASES] ;          /* phase executions, i.e. iterations */
+  long frames ;
+  long edges ;
+} perf_struct ;
+
+
+void setupPerfCounters(perf_struct & P, alist_struct & H);
+void perfBegin(perf_struct & P);
+void perfEnd(perf_struct & P, int phase);
+void reportPerfCounters(perf_struct & P, std::string logfilename, double SNR, const char * codeName);
+
+
+#ifdef perfCounters
+#define PERF_COUNTERS(P,H)    perf_struct P; setupPerfCounters(P,H)
+#define PERF_BEGIN(P)         perfBegin(P)
+#define PERF_END(P,phase)     perfEnd(P,phase)
+#define PERF_FRAME(P)         (P).frames++
+#define PERF_REPORT(P,logfilename,SNR,codeName) reportPerfCounters(P,logfilename,SNR,codeName)
+#else
+#define PERF_COUNTERS(P,H)
+#define PERF_BEGIN(P)
+#define PERF_END(P,phase)
+#define PERF_FRAME(P)
+#define PERF_REPORT(P,logfilename,SNR,codeName)
+#endif
+
+#endif
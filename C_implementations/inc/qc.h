@@ -0,0 +1,88 @@
+/*==========================================================================================
+** qc.h
+** By Chris Winstead
+
+** Description:
+   Quasi-cyclic (QC) code representation. A QC parity-check matrix
+   is an mb x nb array of Z x Z blocks, where each block is either
+   zero or the identity cyclically shifted right by 'shift' columns:
+   row t of block (rb,cb) connects check rb*Z+t to symbol
+   cb*Z + (t+shift)%Z.
+
+   The structure is detected automatically from an alist_struct, or
+   loaded from a compact base-matrix file (*.qc) with the format:
+
+      # optional comment lines
+      mb nb Z
+      s(0,0)    s(0,1)    ... s(0,nb-1)
+      ...
+      s(mb-1,0) ...           s(mb-1,nb-1)
+
+   where s = -1 marks a zero block. loadFile() in alist.cpp expands
+   *.qc files automatically, so every simulator accepts them.
+
+   The kernels below keep messages in "check order": edge block e
+   stores Z messages contiguously, entry t belonging to check
+   row rb*Z+t. Gathers from symbol nodes become rotations by the
+   block shift, which are two contiguous copies.
+
+   For bit-flipping decoders, hard decisions and syndromes are
+   packed as Z-bit vectors (one per block column / block row).
+   A block-row syndrome is the XOR of rotated decision vectors,
+   and the per-symbol count of unsatisfied checks is accumulated
+   across the column's circulants with a bit-sliced ripple adder.
+
+** Usage:
+    qc_struct Q;
+    if (detectQC(H,Q)) ...
+==============================================================================================*/
+
+#ifndef QC_H
+#define QC_H
+
+#include <vector>
+#include "alist.h"
+
+#define QC_MIN_Z 4
+
+typedef unsigned long long qcword;
+#define QCWORD_BITS 64
+#define QC_MAX_PLANES 8   /* bit planes in the unsatisfied-check counters */
+
+typedef struct {
+  int Z ;             /* circulant size */
+  int mb , nb ;       /* base matrix dimensions */
+  int M , N ;         /* expanded dimensions, mb*Z and nb*Z */
+  int E ;             /* number of non-zero blocks (edge blocks) */
+  std::vector<int> shift ;       /* mb*nb base matrix, -1 for zero blocks */
+  std::vector<int> eb_row ;      /* block row of each edge block */
+  std::vector<int> eb_col ;      /* block column of each edge block */
+  std::vector<int> eb_shift ;    /* shift of each edge block */
+  std::vector<std::vector<int> > row_blocks ;  /* edge blocks in each block row */
+  std::vector<std::vector<int> > col_blocks ;  /* edge blocks in each block column */
+} qc_struct ;
+
+
+//--- Construction and file I/O ---//
+int  detectQC(alist_struct & H, qc_struct & Q);
+int  loadQCFile(const char * fileName, qc_struct & Q);
+void writeQCFile(const char * fileName, qc_struct & Q);
+int  isQCFileName(const char * fileName);
+alist_struct qcToAlist(qc_struct & Q);
+void setupQCBlocks(qc_struct & Q);
+
+//--- Min-sum / BP kernels on Z-sized blocks ---//
+void setupQCMessages(qc_struct & Q, std::vector<double> & msgs);
+void initializeQCMessages(qc_struct & Q, std::vector<double> & sym_to_check, std::vector<double> & y);
+void qcMinSumCheckUpdates(qc_struct & Q, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym);
+void qcBPCheckUpdates(qc_struct & Q, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym);
+void qcSymNodeUpdates(qc_struct & Q, std::vector<double> & y, std::vector<int> & d, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym, double maxLLR);
+
+//--- Bit-vector kernels for GDBF/NGDBF ---//
+int  qcWords(qc_struct & Q);
+void packQCSymbols(qc_struct & Q, std::vector<int> & d, int one, std::vector<qcword> & dbits);
+void unpackQCChecks(qc_struct & Q, std::vector<qcword> & sbits, std::vector<int> & syndrome);
+int  qcSyndrome(qc_struct & Q, std::vector<qcword> & dbits, std::vector<qcword> & sbits);
+void qcUnsatisfiedCounts(qc_struct & Q, std::vector<qcword> & sbits, std::vector<int> & counts);
+
+#endif
@@ -1,17 +1,26 @@
 /* RAND.H - Random number generators. */
 /* Copyright (c) 1992 by Radford M. Neal */
 
-/* SET RANDOM NUMBER SEED. */
+/* SET RANDOM NUMBER SEED. Also drops the per-frame generator that
+   seedFrame() in rng.h selects under --crn. */
 
-#define ran_seed(s) srandom(s)
+extern int ran_keyed;
+long ran_keyed_next();
+
+#define ran_seed(s) (ran_keyed = 0, srandom(s))
+
+/* NEXT 31 RANDOM BITS, from random() or the per-frame generator. */
+
+#define ran_next() \
+  (ran_keyed ? ran_keyed_next() : random())
 
 /* GENERATE RANDOM NUMBERS. */
 
 #define ranf() \
-  ((double)random()/(1.0+(double)0x7fffffff)) /* Uniform from interval [0,1) */
+  ((double)ran_next()/(1.0+(double)0x7fffffff)) /* Uniform from interval [0,1) */
 
 #define ranu() \
-  ((1.0+(double)random())/(2.0+(double)0x7fffffff))    /* Uniform from (0,1) */
+  ((1.0+(double)ran_next())/(2.0+(double)0x7fffffff))    /* Uniform from (0,1) */
 
 #define rani(n) \
   ( (int) (ranf()*(n)) )		    /* Uniform from 0, 1, ..., (n-1) */
@@ -0,0 +1,133 @@
+/*==========================================================================================
+** regular.h
+** By Chris Winstead
+
+** Description:
+   Min-sum kernels specialized at compile time on the symbol degree
+   DV and check degree DC. The Tanner graph is flattened into two
+   edge tables so the inner loops have constant trip counts and no
+   int** or find() indirection:
+
+      sym_to_check[sym_start[i] + j]    message from symbol i on its
+                                        j-th edge (nlist order)
+      check_to_sym[check_start[m] + k]  message from check m on its
+                                        k-th edge (mlist order)
+
+   check_edges maps each check-order edge to its symbol-order slot
+   and sym_edges the reverse. A kernel instantiated with DV or DC
+   equal to 0 reads the degree from the start tables instead, so a
+   code that is regular on only one side (e.g. PEGReg504x1008) still
+   gets the specialized kernel on that side.
+
+   detectRegular() selects the instantiations matching the loaded
+   code; add a degree to the lists in regular.cpp to support it.
+   The arithmetic and tie-breaking follow genericMinSumCheckUpdates()
+   and genericSymNodeUpdates() in generic.h exactly.
+
+** Usage:
+    regular_struct G;
+    if (detectRegular(H,G)) {
+      G.minSumCheckUpdates(G, sym_to_check, check_to_sym);
+      G.symNodeUpdates(G, y, d, sym_to_check, check_to_sym);
+    }
+==============================================================================================*/
+
+#ifndef REGULAR_H
+#define REGULAR_H
+
+#include <vector>
+#include <cmath>
+#include "alist.h"
+
+struct regular_struct ;
+typedef void (*regular_check_fn)(regular_struct & G, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym);
+typedef void (*regular_sym_fn)(regular_struct & G, std::vector<double> & y, std::vector<int> & d, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym);
+
+struct regular_struct {
+  int N , M , E ;       /* symbols, checks, edges */
+  int dv , dc ;         /* uniform degrees, or 0 if the degree varies */
+  int max_dv , max_dc ;
+  std::vector<int> sym_start ;    /* N+1 offsets into the symbol-order edges */
+  std::vector<int> check_start ;  /* M+1 offsets into the check-order edges */
+  std::vector<int> check_edges ;  /* check-order edge -> symbol-order slot */
+  std::vector<int> sym_edges ;    /* symbol-order edge -> check-order slot */
+  regular_check_fn minSumCheckUpdates ;
+  regular_sym_fn   symNodeUpdates ;
+} ;
+
+
+int  detectRegular(alist_struct & H, regular_struct & G);
+void setupRegularMessages(regular_struct & G, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym);
+void initializeRegularMessages(regular_struct & G, std::vector<double> & sym_to_check, std::vector<double> & y);
+
+
+inline double regularSign(double x)
+{
+  return (x >= 0.0) ? 1.0 : -1.0;
+}
+
+
+template <int DC>
+void regularMinSumCheckUpdates(regular_struct & G, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym)
+{
+  std::vector<double> buf((DC > 0) ? DC : G.max_dc);
+  double * msg = &buf[0];
+  const int * edges = &G.check_edges[0];
+  const double * in = &sym_to_check[0];
+  double * out = &check_to_sym[0];
+
+  for (int i=0; i<G.M; i++)
+    {
+      const int start = (DC > 0) ? i*DC : G.check_start[i];
+      const int deg   = (DC > 0) ? DC : G.check_start[i+1] - start;
+      double minMag  = INFINITY;
+      double minMag2 = INFINITY;
+      double prod = 1.0;
+      int minIdx = -1;
+
+      for (int j=0; j<deg; j++)
+	{
+	  msg[j] = in[edges[start+j]];
+	  double mag = fabs(msg[j]);
+	  prod *= regularSign(msg[j]);
+	  if (mag <= minMag)
+	    {
+	      minMag2 = minMag;
+	      minMag = mag;
+	      minIdx = j;
+	    }
+	  else if (mag < minMag2)
+	    minMag2 = mag;
+	}
+      for (int j=0; j<deg; j++)
+	out[start+j] = prod*((j == minIdx) ? minMag2 : minMag)*regularSign(msg[j]);
+    }
+}
+
+
+template <int DV>
+void regularSymNodeUpdates(regular_struct & G, std::vector<double> & y, std::vector<int> & d, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym)
+{
+  std::vector<double> buf((DV > 0) ? DV : G.max_dv);
+  double * msg = &buf[0];
+  const int * edges = &G.sym_edges[0];
+  const double * in = &check_to_sym[0];
+  double * out = &sym_to_check[0];
+
+  for (int i=0; i<G.N; i++)
+    {
+      const int start = (DV > 0) ? i*DV : G.sym_start[i];
+      const int deg   = (DV > 0) ? DV : G.sym_start[i+1] - start;
+      double sum = y[i];
+      for (int j=0; j<deg; j++)
+	{
+	  msg[j] = in[edges[start+j]];
+	  sum += msg[j];
+	}
+      for (int j=0; j<deg; j++)
+	out[start+j] = sum - msg[j];
+      d[i] = (sum > 0) ? 1 : -1;
+    }
+}
+
+#endif
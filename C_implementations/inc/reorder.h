@@ -0,0 +1,59 @@
+/*==========================================================================================
+** reorder.h
+** By Chris Winstead
+
+** Description:
+   Locality-improving relabelling of symbol and check nodes. The
+   Tanner graph is ordered by reverse Cuthill-McKee (breadth-first
+   from a pseudo-peripheral node, neighbours visited in order of
+   increasing degree, then reversed), which clusters each check's
+   symbols into nearby indices. For PEG and random codes this turns
+   the scattered gathers in the check and symbol updates into
+   mostly short strides.
+
+   The decoders run entirely in the relabelled index space. The
+   encoder is built from the relabelled H, so random codewords need
+   no translation; codewords read from a file and anything written
+   per symbol are converted with toReordered()/fromReordered().
+
+** Usage:
+    reorder_struct P;
+    reorderCode(H, P);        // H is replaced by its relabelled copy
+    toReordered(P, c);        // original -> decoder order
+==============================================================================================*/
+
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <vector>
+#include "alist.h"
+
+typedef struct {
+  std::vector<int> sym_order ;    /* sym_order[new] = old symbol index */
+  std::vector<int> sym_index ;    /* sym_index[old] = new symbol index */
+  std::vector<int> check_order ;  /* check_order[new] = old check index */
+  std::vector<int> check_index ;  /* check_index[old] = new check index */
+} reorder_struct ;
+
+
+void computeRCMOrder(alist_struct & H, reorder_struct & P);
+alist_struct permuteAlist(alist_struct & H, reorder_struct & P);
+void reorderCode(alist_struct & H, reorder_struct & P);
+double averageCheckSpan(alist_struct & H);
+
+
+template <class T> void toReordered(reorder_struct & P, std::vector<T> & v)
+{
+  std::vector<T> tmp(v);
+  for (int i=0; i<P.sym_order.size(); i++)
+    v[i] = tmp[P.sym_order[i]];
+}
+
+template <class T> void fromReordered(reorder_struct & P, std::vector<T> & v)
+{
+  std::vector<T> tmp(v);
+  for (int i=0; i<P.sym_order.size(); i++)
+    v[P.sym_order[i]] = tmp[i];
+}
+
+#endif
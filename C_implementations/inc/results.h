@@ -0,0 +1,81 @@
+/*==========================================================================================
+** results.h
+** By Chris Winstead
+
+** Description:
+   Structured result records. When the logfilename ends in .jsonl
+   the simulators append one JSON object per run instead of the
+   positional tab-separated row, so sweeps can be aggregated by
+   field name regardless of which decoder variant wrote them:
+
+     {"schema":1, "decoder":"decodeMNGDBF", "code":"...", "snr":4,
+      "time":1760000000,
+      "params":{"num_iterations":300, "theta":-0.6, ...},
+      "options":{"frames":"100000", ...},
+      "counters":{"errors":..., "totalWords":..., ...},
+      "histograms":{"error_weight_hist":[...], ...},
+      "metrics":{"ber":..., "fer":..., "fer_lower":..., "fer_upper":...,
+                 "ber_lower":..., "ber_upper":..., "avg_iterations":...,
+                 "elapsed_s":..., "frames_this_run":..., "frames_per_s":...},
+      "importance_sampling":{...}, "latency":{...}}
+
+   params holds the decoder's named parameters, including the
+   compile-time ones that used to appear or vanish as columns.
+   counters and histograms are every field registered with the
+   snapshot module, so they match what snapshots and shard
+   records carry. importance_sampling and latency appear only
+   when those modes are on. Readers should ignore unknown fields;
+   the schema number changes only when a field changes meaning.
+
+   Each record is written with a single write() to a file opened
+   with O_APPEND while holding an exclusive flock, so concurrent
+   runs sharing one .jsonl file never interleave lines.
+
+** Usage:
+    result_struct res;
+    setupResult(res, argv[0], argv[1], SNR, totalWords);
+    ...simulate...
+    resultParam(res, "num_iterations", num_iterations);
+    if (isJsonLog(logfilename))
+      writeResultRecord(res, logfilename, snap, stop, IS, sla, errors, totalBits, wordErrors, totalWords, totalIterations);
+==============================================================================================*/
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <ctime>
+#include "snapshot.h"
+#include "stopping.h"
+#include "impsample.h"
+#include "sla.h"
+
+#define RESULT_SCHEMA 1
+
+typedef struct {
+  std::string decoder ;
+  std::string code ;
+  double SNR ;
+  time_t started ;
+  std::chrono::steady_clock::time_point start ;
+  long startWords ;        /* frames restored from a snapshot, cache or shards */
+  std::vector<std::pair<std::string,std::string> > params ;   /* name, JSON value */
+} result_struct ;
+
+
+int  isJsonLog(const std::string & logfilename);
+std::string jsonString(const std::string & s);
+std::string jsonNumber(double v);
+std::string jsonNumber(long v);
+void setupResult(result_struct & res, const char * decoder, const char * code, double SNR, long totalWords);
+void resultParam(result_struct & res, const char * name, int v);
+void resultParam(result_struct & res, const char * name, long v);
+void resultParam(result_struct & res, const char * name, double v);
+void resultParam(result_struct & res, const char * name, const char * v);
+bool writeResultRecord(result_struct & res, std::string logfilename, snapshot_struct & snap, stopping_struct & stop,
+		       is_struct & IS, sla_struct & sla, long errors, long totalBits, long wordErrors, long totalWords, long totalIterations);
+
+#endif
@@ -0,0 +1,67 @@
+/*==========================================================================================
+** rng.h
+** By Chris Winstead
+
+** Description:
+   Counter-based generator for common random numbers. All
+   simulators draw through the macros in rand.h, which use random()
+   until seedFrame() is called. With --crn=S, seedFrame() switches
+   them at fixed points of every frame to a 64-bit key, a splitmix64
+   hash of (S, stream, frame index), and draw i of the frame is the
+   splitmix64 finalizer of key + i*0x9E3779B97F4A7C15 (a SplitMix64
+   sequence started from the key). Frames therefore have 2^64
+   possible realizations rather than the 2^32 seeds of srandom().
+   Draws keep the 31 bits of random() so the rand.h macros are
+   unchanged.
+
+     RNG_STREAM_CHANNEL   codeword and channel noise
+     RNG_STREAM_DECODER   decoder-internal perturbation noise
+
+   Frame k receives the same codeword and channel samples in every
+   binary and parameter set run with the same S. The decoder stream
+   is also keyed by the configuration: a hash of the binary name,
+   the positional arguments other than the log file and the options
+   other than the stopping and bookkeeping ones, or the value of
+   --crn-decoder=k when given. Different decoders and parameter sets
+   thus draw independent perturbations on the same channel frames,
+   and --crn-decoder=k makes two configurations share them
+   deliberately. Because a frame depends only on its index, any
+   frame can be regenerated without replaying the ones before it.
+
+   A process running shard k of K (see shard.h) sees local frame
+   j as global frame k + K*j, so shards draw disjoint frames of
+   the same sequence.
+
+** Usage:
+    crn_struct crn;
+    setupCommonRandomNumbers(crn);
+    setupSnapshot(snap, crn, argc, argv);
+    keyDecoderStream(crn, argv[0], snap.params, logfilename);
+    seedFrame(crn, RNG_STREAM_CHANNEL, frame);   // no-op without --crn
+==============================================================================================*/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <string>
+#include <vector>
+
+#define RNG_STREAM_CHANNEL 1
+#define RNG_STREAM_DECODER 2
+
+typedef struct {
+  int enabled ;
+  unsigned long long seed ;
+  unsigned long long decoder ;   /* configuration key of RNG_STREAM_DECODER */
+  long shard , shards ;    /* this process handles frames = shard (mod shards) */
+} crn_struct ;
+
+
+unsigned long long splitmix64(unsigned long long x);
+unsigned long long frameKey(unsigned long long seed, int stream, long frame);
+void setupCommonRandomNumbers(crn_struct & crn);
+void keyDecoderStream(crn_struct & crn, const char * binary, const std::vector<std::string> & params, std::string logfilename);
+void seedFrame(crn_struct & crn, int stream, long frame);
+long globalFrame(crn_struct & crn, long frame);
+
+#endif
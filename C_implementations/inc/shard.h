@@ -0,0 +1,54 @@
+/*==========================================================================================
+** shard.h
+** By Chris Winstead
+
+** Description:
+   Splitting one simulation point across processes or machines.
+   With --shard=k/K (0 <= k < K) and --frames=n, a simulator runs
+   only the frames whose index is congruent to k mod K among the
+   first n, using common random numbers (seed 0 unless --crn is
+   given) so that frame i sees the same codeword and noise in any
+   shard layout. Instead of a log row, it writes its counters,
+   histograms and module state to
+
+     <logfilename>.shard<k>of<K>
+
+   in the snapshot.h format. Running the same command with
+   --merge-shards=K in place of --shard adds up the K records and
+   writes the usual log row, as if all n frames had been simulated
+   by one process. The integer counts are identical for every K.
+
+   Adaptive stopping (--relwidth, --target-fer) would make the
+   frame count depend on the split and is not allowed with shards.
+
+** Usage:
+    shard_struct shard;
+    setupShard(shard, crn, stop);      // before setupSnapshot()
+    ...
+    mergeShards(shard, snap, logfilename);
+    while (...) ...
+    if (shard.enabled) { writeShardRecord(shard, snap, logfilename); return 0; }
+==============================================================================================*/
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <string>
+#include "rng.h"
+#include "stopping.h"
+#include "snapshot.h"
+
+typedef struct {
+  int  enabled ;      /* running one shard */
+  int  merging ;      /* combining K shard records */
+  long k , K ;
+  long frames ;       /* total frames over all shards */
+} shard_struct ;
+
+
+void setupShard(shard_struct & shard, crn_struct & crn, stopping_struct & stop);
+std::string shardFileName(std::string logfilename, long k, long K);
+void mergeShards(shard_struct & shard, snapshot_struct & snap, std::string logfilename);
+void writeShardRecord(shard_struct & shard, snapshot_struct & snap, std::string logfilename);
+
+#endif
@@ -0,0 +1,103 @@
+/*==========================================================================================
+** sla.h
+** By Chris Winstead
+
+** Description:
+   Latency/throughput service-level mode (--sla, --sla-rate=f,
+   --sla-budget=us, --sla-cores=c). The decode of every frame is
+   timed from the moment its channel samples are ready until the
+   final decisions are available, and the measured service times
+   are fed through a model of a link that offers frames at a fixed
+   rate to c decoder cores (first come, first served):
+
+      arrival[k]    = k/rate            (0 for back-to-back frames)
+      start[k]      = max(arrival[k], earliest free core)
+      completion[k] = start[k] + service[k]
+      latency[k]    = completion[k] - arrival[k]
+
+   Frames therefore queue when the decoder falls behind the offered
+   rate, exactly as they would in a receiver, while the simulation
+   itself (codewords, channel noise, statistics) costs no model
+   time. With no --sla-rate the frames arrive as fast as the cores
+   accept them and latency equals service time.
+
+   Latencies and service times are kept in log-linear histograms
+   (about 1.6% resolution, fixed memory), reported as p50, p90,
+   p99, p99.9 and max. A frame misses its deadline when its
+   latency exceeds --sla-budget; service-time misses cannot be
+   removed by adding cores. The report also gives the sustained
+   frames/s, core utilization and the minimum number of cores that
+   keeps up with the offered rate. A row is appended to
+   <logfilename>.sla:
+
+     SNR  rate  cores  budget_us  frames  frames/s  utilization
+     p50_us  p90_us  p99_us  p999_us  max_us  misses  miss_fraction
+     service_p50_us  service_p99_us  service_p999_us  service_max_us
+     service_misses  cores_needed  code
+
+   The model state is not saved in snapshots, so a resumed run
+   reports only the frames decoded after resuming.
+
+** Usage:
+    sla_struct sla;
+    setupSLA(sla);
+    while (...) {
+      ...channel...;
+      slaFrameStart(sla);
+      ...decode...;
+      slaFrameEnd(sla);
+    }
+    reportSLA(sla, logfilename, SNR, argv[1]);
+==============================================================================================*/
+
+#ifndef SLA_H
+#define SLA_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#define SLA_SUB_BUCKETS 64   /* histogram buckets per power of two */
+
+typedef struct {
+  std::vector<long> counts ;
+  long total ;
+  unsigned long long maxValue ;
+} sla_histogram ;
+
+typedef struct {
+  int enabled ;
+  double rate ;                    /* offered frames/s, 0 for back-to-back */
+  double budget ;                  /* latency budget in seconds, 0 for none */
+  int cores ;
+  std::vector<double> freeAt ;     /* model time each core becomes idle */
+  std::chrono::steady_clock::time_point serviceStart ;
+  long frames ;
+  long misses ;
+  long serviceMisses ;
+  double busy ;                    /* summed service time */
+  double makespan ;                /* latest completion */
+  sla_histogram latency ;          /* nanoseconds */
+  sla_histogram service ;
+} sla_struct ;
+
+
+void setupSLA(sla_struct & S);
+void slaRecordFrame(sla_struct & S, double serviceSeconds);
+void reportSLA(sla_struct & S, std::string logfilename, double SNR, const char * codeName);
+double slaPercentile(sla_histogram & h, double p);
+
+
+inline void slaFrameStart(sla_struct & S)
+{
+  if (S.enabled)
+    S.serviceStart = std::chrono::steady_clock::now();
+}
+
+inline void slaFrameEnd(sla_struct & S)
+{
+  if (S.enabled)
+    slaRecordFrame(S,std::chrono::duration<double>(std::chrono::steady_clock::now() - S.serviceStart).count());
+}
+
+#endif
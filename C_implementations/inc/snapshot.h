@@ -0,0 +1,122 @@
+/*==========================================================================================
+** snapshot.h
+** By Chris Winstead
+
+** Description:
+   Periodic snapshots of a running simulation so that a killed or
+   preempted job can be resumed. (Not to be confused with the
+   iteration checkpoints in checkpoints.h.)
+
+   The simulator registers every variable that carries state from
+   one frame to the next: its counters and histograms, the state of
+   the IS, extrapolation, checkpoint and outcome modules, and the
+   codeword file position. Output files that grow frame by frame
+   (outcomes, --corpus-out, --trace) are registered by length, and
+   resuming truncates them to it, dropping the records written after
+   the snapshot so that none is written twice. With --snapshot=f these are written to
+   f every --snapshot-every seconds (default 600) and when the
+   process receives SIGINT or SIGTERM, in which case it exits after
+   saving. Each snapshot is written to f.tmp, synced and renamed
+   over f, so f always holds a complete state.
+
+   Snapshots imply common random numbers: without --crn a seed is
+   drawn from the clock and stored in the file. Since every frame
+   is seeded from (seed, frame index), a run resumed with --resume
+   continues exactly where the snapshot was taken and produces the
+   same frames it would have produced uninterrupted.
+
+   The positional arguments and options (other than the snapshot,
+   shard and outcome switches) are stored as well; --resume refuses
+   a snapshot made with different parameters. The file is removed
+   when the run completes.
+
+   The same registry serves shard.h: a shard's final state is
+   written in this format, and merging adds the saved counters
+   into the registered variables (streams, outcome files and the
+   seed are skipped; mean fields are combined with their weights).
+
+   File format (text, one entry per line):
+     LDPCSNAP1
+     arg <positional argument>
+     opt <name>=<value>
+     key <name>=<value>              other identifying data (cache.h)
+     <name> <value>                  scalars
+     <name> <size> <v0> <v1> ...     vectors
+
+** Usage:
+    snapshot_struct snap;
+    setupSnapshot(snap, crn, argc, argv);
+    snapshotField(snap, "errors", errors);
+    snapshotMean(snap, "itdist", itdist, totalWords);
+    snapshotModules(snap, IS, X, cp, outcomes);
+    snapshotFile(snap, "corpus", corpus.out);
+    resumeSnapshot(snap);
+    while (...) { ...; saveSnapshotIfDue(snap); }
+    finishSnapshot(snap);
+==============================================================================================*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+#include "rng.h"
+#include "impsample.h"
+#include "extrapolate.h"
+#include "checkpoints.h"
+#include "outcomes.h"
+
+#define SNAP_INT      0
+#define SNAP_LONG     1
+#define SNAP_DOUBLE   2
+#define SNAP_VINT     3
+#define SNAP_VLONG    4
+#define SNAP_VDOUBLE  5
+#define SNAP_STREAM   6   /* ifstream read position */
+#define SNAP_FILE     7   /* output file length */
+#define SNAP_SEED     8   /* common random number seed */
+#define SNAP_VMEAN    9   /* vector<double> of per-frame means */
+
+#define SNAP_RESTORE  0   /* readSnapshotFile() overwrites the fields */
+#define SNAP_MERGE    1   /* readSnapshotFile() accumulates into them */
+#define SNAP_CONTINUE 2   /* like SNAP_RESTORE, but leaves the output files alone */
+
+typedef struct {
+  std::string name ;
+  int    type ;
+  void * p ;
+  long * weight ;     /* frame count behind a SNAP_VMEAN field */
+} snapshot_field ;
+
+typedef struct {
+  int    enabled ;
+  std::string fileName ;
+  int    interval ;        /* seconds between snapshots */
+  time_t lastSave ;
+  std::vector<std::string> params ;   /* arg and opt lines */
+  std::vector<snapshot_field> fields ;
+} snapshot_struct ;
+
+
+void setupSnapshot(snapshot_struct & snap, crn_struct & crn, int argc, char * argv[]);
+void snapshotField(snapshot_struct & snap, const char * name, int & v);
+void snapshotField(snapshot_struct & snap, const char * name, long & v);
+void snapshotField(snapshot_struct & snap, const char * name, double & v);
+void snapshotField(snapshot_struct & snap, const char * name, std::vector<int> & v);
+void snapshotField(snapshot_struct & snap, const char * name, std::vector<long> & v);
+void snapshotField(snapshot_struct & snap, const char * name, std::vector<double> & v);
+void snapshotField(snapshot_struct & snap, const char * name, std::ifstream & v);
+void snapshotMean(snapshot_struct & snap, const char * name, std::vector<double> & v, long & weight);
+void snapshotFile(snapshot_struct & snap, const char * name, FILE *& fp);
+void snapshotModules(snapshot_struct & snap, is_struct & IS, extrap_struct & X, checkpoint_struct & cp, outcome_struct & out);
+bool writeSnapshotFile(snapshot_struct & snap, std::string fileName, const std::vector<std::string> & params);
+bool readSnapshotFile(snapshot_struct & snap, std::string fileName, int mode, const std::vector<std::string> & params);
+bool resumeSnapshot(snapshot_struct & snap);
+void saveSnapshot(snapshot_struct & snap);
+void saveSnapshotIfDue(snapshot_struct & snap);
+void finishSnapshot(snapshot_struct & snap);
+
+#endif
@@ -0,0 +1,105 @@
+/*==========================================================================================
+** stagetimer.h
+** By Chris Winstead
+
+** Description:
+   Hot-path timing by decoder stage. Built only when the simulators
+   are compiled with -D profileStages (make PROFILE=1); otherwise
+   every STAGE_* macro expands to nothing and costs nothing.
+
+   Timing is by lap marks: STAGE_MARK(T,stage) charges the time
+   since the previous mark to 'stage', so a frame is split into
+   consecutive intervals with one clock read per mark and no time
+   is lost between stages. The clock is the time-stamp counter
+   (rdtsc) on x86 and steady_clock nanoseconds elsewhere; ticks are
+   converted to seconds with the rate measured over the run.
+
+   Stages:
+     channel      codeword, channel noise and hard decisions
+     init         quantization and message initialization
+     check        check-node updates
+     symbol       symbol-node updates
+     perturb      decoder noise generation (noisy GDBF variants)
+     syndrome     syndromes, flip decisions and stopping checks
+     bookkeeping  error counting, statistics and output
+
+   At the end of the run a table of seconds, share, ticks per frame
+   and ticks per iteration is printed, and one row per stage is
+   appended to <logfilename>.stages:
+
+     SNR  stage  ticks  seconds  fraction  ticks/frame  ticks/iteration  frames  iterations  code
+
+** Usage:
+    STAGE_TIMER(T);
+    while (...) {
+      STAGE_FRAME(T);
+      ...channel...;  STAGE_MARK(T, STAGE_CHANNEL);
+      for (it...) { STAGE_ITERATION(T); ...; STAGE_MARK(T, STAGE_CHECK); ... }
+      ...;            STAGE_MARK(T, STAGE_BOOKKEEPING);
+    }
+    STAGE_REPORT(T, logfilename, SNR, argv[1]);
+==============================================================================================*/
+
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+#include <string>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define STAGE_CHANNEL      0
+#define STAGE_INIT         1
+#define STAGE_CHECK        2
+#define STAGE_SYMBOL       3
+#define STAGE_PERTURB      4
+#define STAGE_SYNDROME     5
+#define STAGE_BOOKKEEPING  6
+#define STAGE_COUNT        7
+
+typedef struct {
+  unsigned long long ticks[STAGE_COUNT] ;
+  unsigned long long last ;          /* clock at the previous mark */
+  unsigned long long startTicks ;
+  double startSeconds ;
+  long frames ;
+  long iterations ;
+} stagetimer_struct ;
+
+
+inline unsigned long long stageClock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline void stageMark(stagetimer_struct & T, int stage)
+{
+  unsigned long long now = stageClock();
+  T.ticks[stage] += now - T.last;
+  T.last = now;
+}
+
+void setupStageTimer(stagetimer_struct & T);
+void reportStages(stagetimer_struct & T, std::string logfilename, double SNR, const char * codeName);
+
+
+#ifdef profileStages
+#define STAGE_TIMER(T)        stagetimer_struct T; setupStageTimer(T)
+#define STAGE_MARK(T,stage)   stageMark(T,stage)
+#define STAGE_FRAME(T)        (T).frames++
+#define STAGE_ITERATION(T)    (T).iterations++
+#define STAGE_REPORT(T,logfilename,SNR,codeName) reportStages(T,logfilename,SNR,codeName)
+#else
+#define STAGE_TIMER(T)
+#define STAGE_MARK(T,stage)
+#define STAGE_FRAME(T)
+#define STAGE_ITERATION(T)
+#define STAGE_REPORT(T,logfilename,SNR,codeName)
+#endif
+
+#endif
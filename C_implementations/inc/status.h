@@ -0,0 +1,73 @@
+/*==========================================================================================
+** status.h
+** By Chris Winstead
+
+** Description:
+   Live progress file for long simulations (--status=f,
+   --status-every=t). Every t seconds (default 10) the file is
+   rewritten atomically (written to f.tmp, then renamed), so a
+   scheduler can poll hundreds of jobs without scraping stdout or
+   ever seeing a partial file. It holds one JSON object:
+
+     {"state":"running", "pid":1234, "host":"...", "decoder":"...",
+      "code":"...", "snr":4, "updated":1760000000,
+      "frames":..., "word_errors":..., "bit_errors":..., "bits":...,
+      "fer":..., "fer_lower":..., "fer_upper":..., "ber":...,
+      "frames_per_s":..., "recent_frames_per_s":...,
+      "frames_to_stop":..., "eta_s":...,
+      "elapsed_s":..., "threads":[{"thread":"decode", "utilization":...}]}
+
+   frames_per_s covers this process, recent_frames_per_s the last
+   interval. frames_to_stop and eta_s estimate when the stopping
+   rule will end the run (framesToStop() in stopping.h); they are
+   null under the decoders' built-in heuristics. Under importance
+   sampling fer, its bounds and ber are the weighted estimates the
+   stopping rules use; the counts stay raw. utilization is
+   CPU time over wall time for each thread. The final rewrite at
+   the end of the run has state "done".
+
+   The check in updateStatus() is one clock read per frame.
+
+** Usage:
+    status_struct status;
+    setupStatus(status, argv[0], argv[1], SNR, totalWords);
+    while (...) {
+      ...
+      updateStatus(status, stop, totalWords, wordErrors, totalBits, errors);
+    }
+    finishStatus(status, stop, totalWords, wordErrors, totalBits, errors);
+==============================================================================================*/
+
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <string>
+#include <chrono>
+#include "stopping.h"
+
+typedef struct {
+  int enabled ;
+  std::string fileName ;
+  double interval ;                    /* seconds between rewrites */
+  std::string decoder , code ;
+  double SNR ;
+  std::chrono::steady_clock::time_point start ;
+  std::chrono::steady_clock::time_point next ;   /* time of the next rewrite */
+  double lastSeconds ;                 /* elapsed time at the previous rewrite */
+  long startWords ;
+  long lastWords ;
+} status_struct ;
+
+
+void setupStatus(status_struct & st, const char * decoder, const char * code, double SNR, long totalWords);
+void writeStatus(status_struct & st, stopping_struct & stop, long words, long wordErrors, long bits, long bitErrors, const char * state);
+void finishStatus(status_struct & st, stopping_struct & stop, long words, long wordErrors, long bits, long bitErrors);
+
+
+inline void updateStatus(status_struct & st, stopping_struct & stop, long words, long wordErrors, long bits, long bitErrors)
+{
+  if (st.enabled && (std::chrono::steady_clock::now() >= st.next))
+    writeStatus(st,stop,words,wordErrors,bits,bitErrors,"running");
+}
+
+#endif
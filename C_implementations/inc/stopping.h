@@ -0,0 +1,95 @@
+/*==========================================================================================
+** stopping.h
+** By Chris Winstead
+
+** Description:
+   Statistical stopping rules for the Monte Carlo loops. Each
+   simulator keeps its own heuristic (e.g. errors < 200 ||
+   wordErrors < 40), given to setupStopping() as thresholds, as the
+   default. The options below replace it:
+
+     --relwidth=r    stop once the confidence interval on FER has
+                     width (upper-lower) <= r times the estimate
+     --ber           also require the BER interval to meet --relwidth
+     --target-fer=p  stop once the FER is shown to lie below or
+                     above p, i.e. the point is proven easier or
+                     harder than p (see below)
+     --confidence=c  two-sided confidence level (default 0.95)
+     --ci=wilson|cp  Wilson score (default) or Clopper-Pearson exact
+                     interval
+     --frames=n      stop after n frames; with no other rule this
+                     gives a fixed-length run, otherwise it is a cap
+     --min-frames=n  never stop before n frames
+
+   --target-fer is a sequential test: checking an interval after
+   every frame would end a run at its first lucky streak (at the
+   nominal 95%, over half of the runs of a point whose FER equals p
+   end with a verdict within 20000 frames). Instead the FER is
+   tested at frames 1, 2, 3, 5, 8, 12, ... (each about 1.5 times the
+   last), look k with an exact Clopper-Pearson interval at level
+   1 - (1-c)/((k+1)(k+2)). These levels spend the error budget 1-c
+   in total, so a verdict is wrong in at most a fraction 1-c of runs
+   (fewer in practice, as the bound is a union bound over looks).
+   The price is a wider interval per look (at 10^6 frames a look
+   tests at about 1 - (1-c)/1300), so a clear-cut point takes a few
+   times the frames the uncorrected check needed.
+
+   If both --relwidth and --target-fer are given, whichever is met
+   first ends the run. With --target-fer alone and no --frames, the
+   decoder's heuristic still ends a point too close to p to decide.
+   The --relwidth rule and the reported intervals are not corrected
+   for the repeated checks. The BER interval treats bits as
+   independent trials, which understates its width when errors
+   cluster in frames.
+
+   Under importance sampling (impsample.h) the raw counts describe
+   the biased channel, so every rule, the heuristic and the reported
+   interval use instead the binomial counts with the same mean and
+   variance as the weighted FER and BER estimates. Equal weights
+   give back the raw counts.
+
+** Usage:
+    stopping_struct stop;
+    setupStopping(stop, IS, 200, 40, 0);   // errors < 200 || wordErrors < 40
+    while (keepSimulating(stop, totalWords, wordErrors, totalBits, errors)) ...
+    reportStopping(stop, totalWords, wordErrors, totalBits, errors);
+==============================================================================================*/
+
+#ifndef STOPPING_H
+#define STOPPING_H
+
+#include "impsample.h"
+
+#define STOP_LEGACY   0   /* decoder's built-in heuristic */
+#define STOP_RULES    1   /* statistical rules from the options */
+
+#define CI_WILSON          0
+#define CI_CLOPPER_PEARSON 1
+
+typedef struct {
+  int    mode ;
+  int    interval ;     /* CI_WILSON or CI_CLOPPER_PEARSON */
+  double confidence ;
+  double z ;            /* normal quantile for the confidence level */
+  double relWidth ;     /* <= 0 disables the relative-width rule */
+  double targetFER ;    /* <= 0 disables the FER target rule */
+  int    useBER ;
+  long   maxFrames ;    /* <= 0 for no cap */
+  long   minFrames ;
+
+  /* the decoder's heuristic: continue while bit errors, word errors
+     or frames are below these */
+  long   legacyBitErrors , legacyWordErrors , legacyFrames ;
+  is_struct * IS ;      /* weighted estimates, or NULL without importance sampling */
+} stopping_struct ;
+
+
+void setupStopping(stopping_struct & S, is_struct & IS, long legacyBitErrors, long legacyWordErrors, long legacyFrames);
+bool keepSimulating(stopping_struct & S, long words, long wordErrors, long bits, long bitErrors);
+void stoppingCounts(stopping_struct & S, long & words, long & wordErrors, long & bits, long & bitErrors);
+void confidenceInterval(stopping_struct & S, long trials, long successes, double & lower, double & upper);
+long framesToStop(stopping_struct & S, long words, long wordErrors, long bits, long bitErrors);
+void reportStopping(stopping_struct & S, long words, long wordErrors, long bits, long bitErrors);
+double incompleteBeta(double a, double b, double x);
+
+#endif
@@ -0,0 +1,128 @@
+/*==========================================================================================
+** trace.h
+** By Chris Winstead
+
+** Description:
+   Binary test-vector traces of the hardware NGDBF decoder
+   (NGDBFhw), replacing the LOG_PROCESSING text dumps. With
+   --trace=f the decoder records, for each selected frame, its
+   quantized inputs and the state of every symbol node after each
+   iteration; traceDump renders a record in the old _msgs.dat,
+   _chanin.dat and _noise.dat text views.
+
+     --trace-frames=failures   frames that fail to decode (default)
+     --trace-frames=all        every frame
+     --trace-frames=a-b,c,...  these frame indices (globalFrame())
+     --trace-compress          deflate each record with zlib (fastest level)
+
+   Every frame is captured in memory while it decodes and written
+   or discarded at its end, so "failures" costs a copy of the node
+   state per iteration on every frame. Nothing is captured when
+   --trace is absent. With --resume the file is kept and trimmed
+   to its length at the snapshot (see snapshot.h).
+
+   Data are column oriented: within a record each quantity is one
+   contiguous array across all traced iterations, which is how
+   RTL testbenches consume them and which compresses well (the
+   decision and flip columns change little between iterations).
+   Nodes are in the decoder's order, i.e. after --reorder.
+
+   File layout (native byte order):
+     "LDPCTRC1"  int32 N, M, Q, NQ, Smult, textLength
+                 double theta, w, SNR
+     text        binary name and arguments of the writing run
+     adjacency   num_nlist (N int32), then each symbol's checks
+                 (0-based int32)
+     records     int64 frame, int32 errors, iterations, phases,
+                 traced, compressed, int64 rawBytes, storedBytes,
+                 then storedBytes of payload (zlib if compressed)
+
+   The payload holds, in order:
+     y          N doubles     channel samples after clipping
+     yprime     N bytes       quantized channel samples (NQ bits)
+     qmodified  Q doubles     perturbation noise before quantization
+     qprime     Q bytes       quantized perturbation noise
+     c          N bytes       transmitted codeword
+     phaseIterations  phases int32, traced iterations per phase
+     it, qpointer     traced int32 each
+     theta      traced doubles
+     d, flip    traced*N bytes  decisions and flips after the update
+     E          traced*N int16  flip function
+     syndrome   traced*M bytes  check results the update used
+
+** Usage:
+    trace_struct trace;
+    setupTrace(trace, H, qprime.size(), NQ, Smult, theta, w, SNR, argc, argv);
+    beginTraceFrame(trace, frame, y, yprime, qmodified, qprime, c);
+    for (phase...) {
+      beginTracePhase(trace);
+      for (it...) { ...update...; if (trace.capturing) traceIteration(trace, it, qpointer, theta, d, E, flip, syndrome); }
+    }
+    endTraceFrame(trace, errors, iterations);
+    closeTrace(trace);
+
+    openTrace(trace, fileName);
+    long rows = countTraceIterations(trace);   // without decompressing
+    while (readTraceRecord(trace)) ...trace.rec...
+==============================================================================================*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include "alist.h"
+
+#define TRACE_MAGIC "LDPCTRC1"
+
+typedef struct {
+  long frame ;
+  int  errors ;
+  int  iterations ;
+  std::vector<double> y , qmodified ;
+  std::vector<unsigned char> yprime , qprime , c ;
+  std::vector<int> phaseIterations ;     /* traced iterations in each phase */
+  std::vector<int> it , qpointer ;       /* one entry per traced iteration */
+  std::vector<double> theta ;
+  std::vector<unsigned char> d , flip , syndrome ;
+  std::vector<short> E ;
+} trace_record ;
+
+typedef struct {
+  FILE * file ;
+  int  writing ;
+  int  compress ;
+  int  N , M , Q , NQ , Smult ;
+  double theta , w , SNR ;
+  std::string text ;
+  std::vector<int> num_nlist ;
+  std::vector<int> nlist ;               /* all symbols' checks, flattened */
+  std::vector<int> nlistStart ;          /* offset of symbol i in nlist */
+
+  int  all ;
+  int  failuresOnly ;
+  std::vector<long> first , last ;       /* --trace-frames ranges */
+  int  capturing ;                       /* the current frame is being recorded */
+  long records ;
+  long dataStart ;                       /* file offset of the first record */
+
+  trace_record rec ;
+  std::vector<unsigned char> raw , packed ;
+} trace_struct ;
+
+
+void setupTrace(trace_struct & tr, alist_struct & H, int Q, int NQ, int Smult, double theta, double w, double SNR, int argc, char * argv[]);
+void beginTraceFrame(trace_struct & tr, long frame, std::vector<double> & y, std::vector<double> & yprime,
+		     std::vector<double> & qmodified, std::vector<double> & qprime, std::vector<int> & c);
+void beginTracePhase(trace_struct & tr);
+void traceIteration(trace_struct & tr, int it, int qpointer, double theta, std::vector<int> & d,
+		    std::vector<int> & E, std::vector<int> & flip, std::vector<int> & syndrome);
+void endTraceFrame(trace_struct & tr, int errors, int iterations);
+void closeTrace(trace_struct & tr);
+
+bool openTrace(trace_struct & tr, const std::string & fileName);
+bool readTraceRecord(trace_struct & tr);
+long countTraceIterations(trace_struct & tr);
+
+#endif
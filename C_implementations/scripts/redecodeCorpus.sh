@@ -0,0 +1,33 @@
+#!/bin/bash
+
+###################################
+### FAILURE CORPUS RE-DECODING  ###
+###################################
+# Re-decodes every frame of a failure corpus (written by any
+# simulator with --corpus-out=file) using K parallel processes,
+# then merges their results into a single log row.
+#
+# Usage:
+#   ./scripts/redecodeCorpus.sh CORPUS K DECODER [decoder arguments and options]
+#
+# Example (decode min-sum failures with BP):
+#   ./scripts/redecodeCorpus.sh tmp/minsum_2.0.corpus 8 decodeBP \
+#       ./codes/PEGReg504x1008/PEGReg504x1008.alist 0.5 2.0 100 results/bp_on_minsum_failures
+
+CORPUS=$1
+K=$2
+ALGNAME=$3
+shift 3
+
+###################################
+### SIMULATION COMMANDS         ###
+###################################
+mkdir -p tmp
+for ((k=0; k<K; k++))
+do
+ echo Running ./bin/$ALGNAME "$@" --corpus-in=$CORPUS --shard=$k/$K \> tmp/nohup_redecode_$k.out
+ ./bin/$ALGNAME "$@" --corpus-in=$CORPUS --shard=$k/$K > tmp/nohup_redecode_$k.out &
+done
+wait
+
+./bin/$ALGNAME "$@" --corpus-in=$CORPUS --merge-shards=$K
@@ -40,6 +40,28 @@ using namespace std;
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
 #include "rand.h"
+#include "encoder.h"
+#include "options.h"
+#include "reorder.h"
+#include "stopping.h"
+#include "impsample.h"
+#include "extrapolate.h"
+#include "checkpoints.h"
+#include "rng.h"
+#include "outcomes.h"
+#include "snapshot.h"
+#include "shard.h"
+#include "cache.h"
+#include "corpus.h"
+#include "llrstream.h"
+#include "stagetimer.h"
+#include "sla.h"
+#include "results.h"
+#include "iterhist.h"
+#include "status.h"
+#include "console.h"
+#include "trace.h"
+#include "qc.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -57,6 +79,10 @@ const int NQ          = 5;     // Number of bits for quantization
 double theta0         = -0.525;
 
 alist_struct H;                // Code definition
+reorder_struct order;          // Node relabelling applied to H (--reorder)
+bool         reordered = false;
+qc_struct    Hqc;              // Quasi-cyclic description of H, if one exists
+bool         useQC = false;    // Use the bit-vector syndrome kernels
 string logfilename;            // Filename for output data
 
 
@@ -65,6 +91,9 @@ double SNR            = 3.5;   // Eb/N0 in decibels
 double theta          = 8;     // Threshold 
 double numFlips       = 0;     // Number of flips in most recent iteration
 int    Smult          = 10;    // Syndrome multiplier to account for quantization
+vector<qcword> qcDecisions;    // Packed decisions (QC codes only)
+vector<qcword> qcSyndromes;    // Packed syndromes (QC codes only)
+vector<int>    qcUnsat;        // Unsatisfied checks adjacent to each symbol (QC codes only)
 
 //============ DECODING ALGORITHM PREDEFINES ===============//
 void checkNodeUpdates(vector<int> & d, vector<int> & syndrome, bool & satisfied);
@@ -85,7 +114,7 @@ vector<string> setupUsage();
 void   parseArguments(int argc, char * argv[]);
 
 //============= I/O PREDEFINES ============================//
-void printHistogram(vector<int> & h);
+void printHistogram(vector<int> & h, ostream & os);
 void printVector(vector<int> v);
 void printVector(vector<double> v);
 
@@ -100,12 +129,13 @@ int main(int argc, char * argv[])
   //=========== Handle command line arguments ============//
   vector<string> command_arguments = setupUsage();
 
+  parseOptions(argc,argv);
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
       cout << "Usage: " << argv[0];
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
-      cout << "\n";
+      cout << "\n" << optionUsage();
       return 0;
     }
 
@@ -114,10 +144,19 @@ int main(int argc, char * argv[])
   ran_seed(seed); 
 
   ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  encoder_struct encoder;
+  bool randomCodewords = false;
+  if ((argc == command_arguments.size()+1) && (string(argv[argc-1]) == "random"))
     {
-      cout << "\nUsing codewords from " << argv[argc] << endl;
-      codewordFile.open(argv[argc],ios::in);
+      cout << "\nUsing random codewords from the built-in encoder.\n";
+      if (setupEncoder(H,encoder))
+	exit(1);
+      randomCodewords = true;
+    }
+  else if (argc == command_arguments.size()+1)
+    {
+      cout << "\nUsing codewords from " << argv[argc-1] << endl;
+      codewordFile.open(argv[argc-1],ios::in);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
@@ -145,6 +184,7 @@ int main(int argc, char * argv[])
   vector<double>    yprime(H.N,0); // Modified and quantized channel samples
   vector<int>    r(H.N);        // Received bipolar decisions (+1 or -1)
   vector<int>    d(H.N,0);      // Decoder outputs (0 or 1 after decoding)
+  vector<int>    dBest(H.N,0);  // Outputs of the phase with the fewest errors
   vector<int>    E(H.N,0);      // Flip function
   vector<int>    flip(H.N,0);      // Flip activity
 
@@ -161,7 +201,6 @@ int main(int argc, char * argv[])
   long totalIterations = 0;   // Total number of iterations accumulated over all frames.
 
   vector<int> error_weight_hist(H.N,0);       // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-  vector<double> itdist(num_iterations,0.0);  // Cumulative distribution of completion times
 
   // Declare and initialize message memories:
   vector<int> syndrome(H.M,0);
@@ -177,24 +216,76 @@ int main(int argc, char * argv[])
 
   theta = unpack(pack(quantize(2),1));//*(lmax/NL);
   Smult = round(NL/lmax);
-  #ifdef LOG_PROCESSING
-      stringstream ss1,ss2,ss3;
-      ss1 << logfilename << "_" << SNR << "_msgs.dat";
-      ss2 << logfilename << "_" << SNR << "_chanin.dat";
-      ss3 << logfilename << "_" << SNR << "_noise.dat";
-      ofstream ofmsgs(ss1.str().c_str(),ios::trunc);
-      ofstream ofchanin(ss2.str().c_str(),ios::trunc);
-      ofstream ofnoise(ss3.str().c_str(),ios::trunc);
-      std::bitset<NQ+1> bth(theta);
-      ofmsgs << "GLOBALS:\n\ttheta = " << theta << "(" << bth << ")" << endl;
-      ofmsgs << "\tSmult = " << Smult << endl;
-  #endif
-
-  while (totalWords < numFrames)
+
+  is_struct IS;
+  setupImportanceSampling(IS,H.N);
+  if (reordered)
+    toReordered(order,IS.biased);
+  extrap_struct X;
+  setupExtrapolation(X,SNR,R,H.N);
+  crn_struct crn;
+  setupCommonRandomNumbers(crn);
+  outcome_struct outcomes;
+  openOutcomeFile(outcomes);
+  checkpoint_struct cp;
+  setupCheckpoints(cp,num_iterations,H.N);
+  stopping_struct stop;
+  setupStopping(stop,IS,0,0,numFrames);
+  corpus_struct corpus;
+  setupCorpus(corpus,H.N,SNR,R,stop,reordered ? &order : NULL,argc,argv);
+  llrstream_struct stream;
+  setupLLRStream(stream,H.N,sigma,stop,reordered ? &order : NULL);
+  trace_struct trace;
+  setupTrace(trace,H,qprime.size(),NQ,Smult,theta,w,SNR,argc,argv);
+  shard_struct shard;
+  setupShard(shard,crn,stop);
+  snapshot_struct snap;
+  setupSnapshot(snap,crn,argc,argv);
+  keyDecoderStream(crn,argv[0],snap.params,logfilename);
+  snapshotField(snap,"errors",errors);
+  snapshotField(snap,"uncodedErrors",uncodedErrors);
+  snapshotField(snap,"totalBits",totalBits);
+  snapshotField(snap,"totalWords",totalWords);
+  snapshotField(snap,"wordErrors",wordErrors);
+  snapshotField(snap,"totalIterations",totalIterations);
+  snapshotField(snap,"error_weight_hist",error_weight_hist);
+  iterhist_struct iters;
+  setupIterationHistogram(iters,num_iterations,maxPhases);
+  snapshotField(snap,"iterations",iters.iterations);
+  snapshotField(snap,"phases",iters.phases);
+  snapshotField(snap,"codewordFile",codewordFile);
+  snapshotModules(snap,IS,X,cp,outcomes);
+  snapshotFile(snap,"corpus",corpus.out);
+  snapshotFile(snap,"trace",trace.file);
+  cache_struct cache;
+  setupCache(cache,snap,crn,argv[0],logfilename);
+  loadCachedResult(cache,snap);
+  resumeSnapshot(snap);
+  mergeShards(shard,snap,logfilename);
+  sla_struct sla;
+  setupSLA(sla);
+  result_struct res;
+  setupResult(res,argv[0],argv[1],SNR,totalWords);
+  status_struct status;
+  setupStatus(status,argv[0],argv[1],SNR,totalWords);
+  setupConsole();
+  STAGE_TIMER(stages);
+  while (keepSimulating(stop,totalWords,wordErrors,totalBits,errors) && nextLLRFrame(stream))
     {
       string s;
+      STAGE_FRAME(stages);
+      seedFrame(crn,RNG_STREAM_CHANNEL,totalWords);
+      // Replay a recorded frame, or draw a fresh codeword from the encoder if requested:
+      if (corpus.replay)
+	readCorpusFrame(corpus,globalFrame(crn,totalWords),c,x,1);
+      else if (randomCodewords)
+	{
+	  encodeRandom(encoder,c);
+	  for (i=0; i<H.N; i++)
+	    x[i] = 1-2*c[i];
+	}
       // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
+      else if (argc == command_arguments.size()+1)
 	{
 	  getline(codewordFile, s);
 	  if (codewordFile.eof())
@@ -210,14 +301,23 @@ int main(int argc, char * argv[])
 	    else if (s[i] == '0')
 	      c[i] = 0;
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
+	      {
+		drainConsole();
+		cout << "Got an invalid symbol at index " << i << endl;
+	      }
 	    x[i] = 1-2*c[i];
 	  }
+	  if (reordered)
+	    {
+	      toReordered(order,c);
+	      toReordered(order,x);
+	    }
 	}
+      beginISFrame(IS);
       // Emulate AWGN or BSC transmission      
       for (i=0; i<H.N; i++)
 	{
-	  y[i] = x[i]*(1.0+sigma*rann());
+	  y[i] = stream.enabled ? stream.y[i] : corpus.replay ? corpus.y[i] : x[i]*(1.0+sigma*channelNoise(IS,i));
 
 	  if (abs(y[i])>Ymax)
 	    y[i] *= Ymax/abs(y[i]);
@@ -233,8 +333,14 @@ int main(int argc, char * argv[])
 	  ymodified[i] = y[i]/(2.0*w);
 	  //yprime[i] = ymodified[i];
 	}
+      STAGE_MARK(stages,STAGE_CHANNEL);
+      slaFrameStart(sla);
 
       quantize(ymodified, yprime);
+      STAGE_MARK(stages,STAGE_INIT);
+      seedFrame(crn,RNG_STREAM_DECODER,totalWords);
+      if (crn.enabled)
+	qpointer = 0;   // keep each frame independent of the ones before it
 
       for (i=0; i<qprime.size(); i++)
 	{
@@ -250,6 +356,7 @@ int main(int argc, char * argv[])
 	  //qprime[i]=round(128.0*qmodified[i])/128.0;
 	}
       quantize(qmodified, qprime);
+      STAGE_MARK(stages,STAGE_PERTURB);
 
       bool satisfied;
       int it;
@@ -257,28 +364,15 @@ int main(int argc, char * argv[])
 
       //-------------- Out Multi-Phase Loop -----------------//
       int leastIterations=num_iterations;
+      int bestPhase=0;
       int leastErrors=H.N;
-      #ifdef LOG_PROCESSING
-      if (totalWords==0) {
-      for (int idx=0; idx<H.N; idx++) {
-	unsigned long yul = yprime[idx];
-	std::bitset<NQ> by(yul);
-	ofchanin << by << endl;
-	unsigned long qul = qprime[idx];
-	std::bitset<NQ> bn(qul);
-	ofnoise << bn << endl;
-      }
-      for (int idx=H.N; idx<qprime.size(); idx++)
-	{
-	unsigned long qul = qprime[idx];
-	std::bitset<NQ> bn(qul);
-	ofnoise << bn << endl;
-	}
-    }
-      #endif
+      bool bestSatisfied=false;
+      beginTraceFrame(trace,globalFrame(crn,totalWords),y,yprime,qmodified,qprime,c);
 
+      beginCheckpointFrame(cp);
       for (int phase=0; phase<maxPhases; phase++)
 	{
+	  beginTracePhase(trace);
 	  //	  theta = theta0;
 	  for (int idx=0; idx<H.N; idx++)
 	    {
@@ -289,50 +383,29 @@ int main(int argc, char * argv[])
 	  //------------ Inner Loop: NGDBF Decoder --------------//
 	  for (it=0; it<num_iterations; it++)
 	    {      
+	      STAGE_ITERATION(stages);
+	      if ((phase == 0) && checkpointDue(cp,it))
+		recordCheckpoint(cp,countDecisionErrors(d,c),it);
 	      satisfied = true;
 	      numFlips = 0;	  
 	  
 	      //'''''''''''''''''''''''''''''''''''''''''''''''
 	      // First update the check nodes:
 	      checkNodeUpdates(d,syndrome,satisfied);
+	      STAGE_MARK(stages,STAGE_SYNDROME);
 	      if (satisfied)
 		break;
 	  
 	      // Then perform Symbol node updates:
 	      symNodeUpdates(yprime, d, syndrome, E, qprime,qpointer,flip);
+	      STAGE_MARK(stages,STAGE_SYMBOL);
 
-	      #ifdef LOG_PROCESSING
-	      if (totalWords==0) {
-	      ofmsgs << "IT " << it << endl;
-	      for (int idx=0; idx<H.N; idx++)
+	      if (trace.capturing)
 		{
-		  ofmsgs << "S" << idx << ":\n";
-		  unsigned long yul = yprime[idx];
-		  std::bitset<NQ> by(abs(yul));
-		  ofmsgs << "\tchan_msg, x: " << y[idx] << " " << ymodified[idx] << " " <<  yul << " (" << by << ") [" << unpack(yprime[idx]) << "], " << d[idx] << endl;
-		  
-		  ofmsgs << "\tin_messages: ";
-		  int SSum = 0;
-		  for (int jdx=0; jdx<H.num_nlist[idx]; jdx++) {
-		    int msg = syndrome[H.nlist[idx][jdx]-1];
-		    ofmsgs << msg  << " ";
-		    SSum += 1-msg;
-		  }
-		  unsigned long Sul = SSum*Smult;
-		  std::bitset<NQ+1> bS(Sul);
-		  ofmsgs << "\n\tS: " << SSum << " " << " (" << Sul << "," << bS << ")";
-		  unsigned long uq = round(qprime[idx+qpointer]);
-		  std::bitset<NQ+1> b(uq);
-		  //if (uq>16)
-		  //  uq = -(uq-16);
-		  ofmsgs << "\n\tq: " << qmodified[idx+qpointer] << " " << qprime[idx+qpointer] << " (" <<  b.to_string<char,std::string::traits_type,std::string::allocator_type>() << ")";
-		  ofmsgs << " [" << unpack(qprime[idx+qpointer]) << "]";
-		  ofmsgs << "\n\tE: " << E[idx] << endl;
-		  ofmsgs << "\ttheta: " << theta << endl;
-		  ofmsgs << "\tflip: " << flip[idx] << endl;
+		  if (useQC)
+		    unpackQCChecks(Hqc,qcSyndromes,syndrome);
+		  traceIteration(trace,it,qpointer,theta,d,E,flip,syndrome);
 		}
-	    }
-	      #endif
 
 
 	      //	      symNodeUpdates(y, d, syndrome, noiseSigma); 
@@ -364,32 +437,43 @@ int main(int argc, char * argv[])
 
       // Count remaining errors after decoding:
       int newErrors = countDecisionErrors(d,c);
+      if (phase == 0)
+	finishCheckpointFrame(cp,newErrors,it);
       
       // Count least iterations from repeated decoding:
-      if (newErrors < leastErrors)
-	leastErrors = newErrors;
+      if ((phase == 0) || (newErrors < leastErrors))
+	{
+	  leastErrors = newErrors;
+	  bestSatisfied = satisfied;
+	  dBest = d;
+	}
       if (it < leastIterations)
-	leastIterations = it;
+	{
+	  leastIterations = it;
+	  bestPhase = phase;
+	}
      }
 	 
 	  
 
+      slaFrameEnd(sla);
+      writeLLRDecisions(stream,dBest,1);
+      endTraceFrame(trace,leastErrors,leastIterations);
       //==================  ACCOUNTING  ==================//
       if (leastErrors > 0)
 	{
 	  // Report the frame error to the console:
-	  cout << "Ferr with " << leastErrors << " errors.";
-	  if (satisfied)
-	    cout << " All checks satisfied.\n";
-	  else
-	    cout << endl;
+	  ostringstream msg;
+	  msg << "Ferr with " << leastErrors << " errors." << (bestSatisfied ? " All checks satisfied.\n" : "\n");
 
 	  // Update statistical information
 	  errors += leastErrors;
 	  error_weight_hist[leastErrors-1]++;
 	  wordErrors++;
+	  writeCorpusFrame(corpus,globalFrame(crn,totalWords),leastErrors,leastIterations,y,c,dBest,1);
 	  
-	  cout << " BER=" << (double)errors/(totalBits+H.N) << ", WER=" << (double) wordErrors/(totalWords+1) << endl;
+	  msg << " BER=" << (double)errors/(totalBits+H.N) << ", WER=" << (double) wordErrors/(totalWords+1) << "\n";
+	  consoleWrite(msg.str(),CONSOLE_EVENT);
 	  // ------------------------------------------------
 	  // WRITE ERROR PATTNERS TO FILE
 	  // ------------------------------------------------
@@ -401,8 +485,9 @@ int main(int argc, char * argv[])
 	  ofstream ofdec(ss2.str().c_str(),ios::app);
 	  for (int idx=0; idx<H.N; idx++)
 	    {
-	      oferrpat << y[idx] << "\t";
-	      ofdec << d[idx] << "\t";
+	      int jdx = reordered ? order.sym_index[idx] : idx;
+	      oferrpat << y[jdx] << "\t";
+	      ofdec << dBest[jdx] << "\t";
 	    }
 	  oferrpat << endl;
 	  ofdec << endl;
@@ -412,13 +497,14 @@ int main(int argc, char * argv[])
 	}
 
       // Increment frame and bit counters:
+      writeOutcome(outcomes,globalFrame(crn,totalWords),leastErrors,leastIterations);
+      recordISFrame(IS,leastErrors,H.N);
+      recordExtrapolationFrame(X,IS,leastErrors);
       totalWords++;
       totalBits += H.N;
       totalIterations += leastIterations;
 
-      // Update cumulative distribution of completion times:
-      for (int idx=0; idx<=leastIterations; idx++)
-	itdist[idx] = (double)((totalWords-1.0)/totalWords)*itdist[idx] + (double)(1.0/totalWords); 
+      recordIterations(iters,leastIterations,bestPhase);
 
       // ------------------------------------------------
       // Give a status message every 100 frames
@@ -426,13 +512,18 @@ int main(int argc, char * argv[])
       int reportInterval = 100;
       if ((totalWords % reportInterval) == 0)
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
+	  ostringstream msg;
+	  msg << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
 	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
 	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  printHistogram(error_weight_hist,msg);
+	  consoleWrite(msg.str(),CONSOLE_SUMMARY);
 	}
       // ------------------------------------------------
 
+      saveSnapshotIfDue(snap);
+      updateStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+      STAGE_MARK(stages,STAGE_BOOKKEEPING);
     }
   /////////////////////////////////////////////////////////////////
   // ------===== END OF MAIN TEST LOOP =====-------
@@ -441,33 +532,78 @@ int main(int argc, char * argv[])
   // ------------------------------------------------
   // APPEND FINAL RESULTS TO LOG FILE:
   // ------------------------------------------------
+  drainConsole();
   cout << "\nFinal result: " << errors << " bit errs in " 
        << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
        << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
        << (double)uncodedErrors/totalBits << endl;      
+  reportStopping(stop,totalWords,wordErrors,totalBits,errors);
+  closeOutcomeFile(outcomes);
+  closeCorpus(corpus);
+  closeLLRStream(stream);
+  closeTrace(trace);
+  reportIS(IS);
+  reportExtrapolation(X);
+  writeExtrapolationLog(X,logfilename,argv[1]);
+  reportCheckpoints(cp);
+  writeCheckpointLog(cp,logfilename,SNR,argv[1]);
+  reportIterations(iters);
+  STAGE_REPORT(stages,logfilename,SNR,argv[1]);
+  reportSLA(sla,logfilename,SNR,argv[1]);
+  finishStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+
+  if (shard.enabled)
+    {
+      writeShardRecord(shard,snap,logfilename);
+      finishSnapshot(snap);
+      return 0;
+    }
+  storeCachedResult(cache,snap);
+
+  resultParam(res,"R",R);
+  resultParam(res,"num_iterations",num_iterations);
+  resultParam(res,"theta0",theta0);
+  resultParam(res,"noiseScale",noiseScale);
+  resultParam(res,"w",w);
+  resultParam(res,"Ymax",Ymax);
+  resultParam(res,"NQ",NQ);
+  resultParam(res,"maxPhases",maxPhases);
+  resultParam(res,"seed",seed);
+  if (isJsonLog(logfilename))
+    writeResultRecord(res,logfilename,snap,stop,IS,sla,errors,totalBits,wordErrors,totalWords,totalIterations);
+  else
+    {
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << errors << tab << wordErrors << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << totalBits << tab << totalWords << tab
+	 << num_iterations << tab << theta0 << tab;
+      of << noiseScale << tab; 
+      of << w << tab;
+      of << Ymax << tab << NQ << tab;
+      of << maxPhases << tab << seed;
+      if (IS.enabled)
+	{
+	  of << tab;
+	  writeISColumns(IS,of);
+	}
+      of << endl;
 
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << errors << tab << wordErrors << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << totalBits << tab << totalWords << tab
-     << num_iterations << tab << theta0 << tab;
-  of << noiseScale << tab; 
-  of << w << tab;
-  of << Ymax << tab << NQ << tab;
-  of << maxPhases << tab << seed;
-  of << endl;
-
-  // ------------------------------------------------
-  // WRITE COMPLETION TIME DISTRIBUTION TO FILE
-  // ------------------------------------------------
-  stringstream ss;
-  ss << logfilename << "_" << SNR << "_itdist.dat";
-  ofstream ofitdist(ss.str().c_str(),ios::trunc);
-  for (int idx=0; idx<itdist.size(); idx++)
-    ofitdist << idx << "\t" << itdist[idx] << "\n";
-  ofitdist.close();
+      // ------------------------------------------------
+      // WRITE COMPLETION TIME DISTRIBUTION TO FILE
+      // ------------------------------------------------
+      stringstream ss;
+      ss << logfilename << "_" << SNR << "_itdist.dat";
+      vector<double> itdist;
+      iterationSurvival(iters,itdist);
+      ofstream ofitdist(ss.str().c_str(),ios::trunc);
+      for (int idx=0; idx<itdist.size(); idx++)
+	ofitdist << idx << "\t" << itdist[idx] << "\n";
+      ofitdist.close();
+    }
 
+  finishSnapshot(snap);
   return 0;
 }
 /////////////////////////////////////////////////////////////////
@@ -485,7 +621,7 @@ vector<string> setupUsage()
   command_arguments.push_back("seed");
   command_arguments.push_back("logfilename");
 
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename | random]");
 
   return command_arguments;
 }
@@ -497,6 +633,16 @@ void parseArguments(int argc, char * argv[])
   int idx=1;
   H = loadFile(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
+  printOptions();
+  reordered = hasOption("reorder");
+  if (reordered)
+    reorderCode(H,order);
+  useQC = !reordered && detectQC(H,Hqc);
+  if (useQC)
+    {
+      cout << " QC:   \tZ=" << Hqc.Z << ", " << Hqc.mb << "x" << Hqc.nb << " base matrix" << endl;
+      qcUnsat.assign(H.N,0);
+    }
   SNR = atof(argv[idx++]);
   cout << " SNR = \t" << SNR << endl;
 
@@ -518,12 +664,12 @@ void parseArguments(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
-void printHistogram(vector<int> & h)
+void printHistogram(vector<int> & h, ostream & os)
 {
   for (int i=0; i<h.size(); i++)
     {
       if (h[i] > 0)
-	cout << i+1 << ":\t" << h[i] << endl;
+	os << i+1 << ":\t" << h[i] << "\n";
     }
 }
 
@@ -545,6 +691,15 @@ int countDecisionErrors(vector<int> d, vector<int> c)
 
 void checkNodeUpdates(vector<int> & d, vector<int> & syndrome, bool & satisfied)
 {
+  if (useQC)
+    {
+      packQCSymbols(Hqc,d,1,qcDecisions);
+      satisfied = qcSyndrome(Hqc,qcDecisions,qcSyndromes);
+      if (!satisfied)
+	qcUnsatisfiedCounts(Hqc,qcSyndromes,qcUnsat);
+      return;
+    }
+
   int msg;
   satisfied = true;
   for (int i=0; i<H.M; i++)
@@ -574,12 +729,15 @@ void symNodeUpdates(vector<double> & yprime, vector<int> & d, vector<int> & synd
 
       int dv = H.num_nlist[i];
       double SSum=0;
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = syndrome[cnode];
-	  SSum += 1-msg;	  
-	}      
+      if (useQC)
+	SSum = dv - qcUnsat[i];
+      else
+	for (int j=0; j<H.num_nlist[i]; j++)
+	  {
+	    int cnode = H.nlist[i][j]-1;
+	    int msg = syndrome[cnode];
+	    SSum += 1-msg;	  
+	  }      
       E[i] += SSum*Smult+unpack(qprime[i+qpointer]);//*(lmax/NL);
       if (E[i] <= theta)
 	{
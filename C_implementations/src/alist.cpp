@@ -17,12 +17,22 @@
 #include <stdio.h>
 #include <fstream>
 #include "r.h"
+#include "qc.h"
 using namespace std;
 
 alist_struct loadFile(const char * fileName)
 {
   int i;
 
+  // Compact quasi-cyclic base-matrix files are expanded on load:
+  if (isQCFileName(fileName))
+    {
+      qc_struct Q;
+      if (!loadQCFile(fileName,Q))
+	exit(1);
+      return qcToAlist(Q);
+    }
+
   #ifdef CPPSTYLE
   ifstream theFile(fileName,ios::in);
   //  FILE * theFile = fopen(fileName, "r");  
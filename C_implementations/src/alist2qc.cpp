@@ -0,0 +1,38 @@
+//==============================================================
+// alist2qc.cpp
+//
+// Detects quasi-cyclic structure in an alist file and writes
+// the compact base-matrix (*.qc) description of the code.
+//==============================================================
+
+#include <iostream>
+#include <cstdlib>
+using namespace std;
+
+#include "alist.h"
+#include "qc.h"
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3)
+    {
+      cout << "Usage: " << argv[0] << " alist qcfile\n";
+      return 0;
+    }
+
+  alist_struct H = loadFile(argv[1]);
+  qc_struct Q;
+  if (!detectQC(H,Q))
+    {
+      cout << argv[1] << " is not quasi-cyclic with circulant size >= " << QC_MIN_Z << endl;
+      freeAlist(H);
+      return 1;
+    }
+
+  cout << "Detected Z=" << Q.Z << " with a " << Q.mb << "x" << Q.nb << " base matrix ("
+       << Q.E << " non-zero blocks)." << endl;
+  writeQCFile(argv[2],Q);
+  cout << "Wrote " << argv[2] << endl;
+  freeAlist(H);
+  return 0;
+}
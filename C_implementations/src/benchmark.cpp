@@ -0,0 +1,504 @@
+//==============================================================
+// benchmark.cpp
+//
+// Standard micro/macro benchmark of the linkable decoder kernels
+// (generic.h, regular.h and qc.h) across every code found under
+// codes/. The generic kernels run on every code and are the
+// baseline for the specialized ones.
+//
+// Micro: check-node and symbol-node update throughput in edges/s,
+//        each kernel repeated for --seconds on one noisy frame.
+//        For the bit-flipping kernels the check update is the
+//        syndrome (with packing, for QC) and the symbol update
+//        the count of unsatisfied checks per symbol.
+// Macro: full min-sum/BP decodes of --frames all-zero codewords
+//        at each of the --snr points (Eb/N0 in dB), reporting
+//        frames/s, FER and per-frame latency percentiles. The
+//        bit-flipping kernels have no decode of their own (the
+//        flip rules live in the simulators) and get no macro rows.
+// Memory: message-array bytes for each kernel and the process
+//        peak resident set size.
+//
+// All noise is drawn from ran_seed(--seed) restarted for every
+// (code, kernel, SNR), so repeated runs decode identical frames.
+// Results are tab-separated rows
+//
+//    code  kernel  snr  metric  value
+//
+// written to stdout and appended to --out=f if given.
+//==============================================================
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+using namespace std;
+
+#include "alist.h"
+#include "qc.h"
+#include "regular.h"
+#include "generic.h"
+#include "options.h"
+#include "rand.h"
+
+#define BENCH_GENERIC_MINSUM 0
+#define BENCH_GENERIC_BP     1
+#define BENCH_REGULAR_MINSUM 2
+#define BENCH_QC_MINSUM      3
+#define BENCH_QC_BP          4
+#define BENCH_GENERIC_GDBF   5
+#define BENCH_QC_GDBF        6
+#define BENCH_KERNELS        7
+
+static const char * kernelNames[BENCH_KERNELS] =
+  {"generic-minsum", "generic-bp", "regular-minsum", "qc-minsum", "qc-bp", "generic-gdbf", "qc-gdbf"};
+
+#define BENCH_MAXLLR 20.0   // same message clipping as decodeBP
+
+typedef chrono::steady_clock bench_clock;
+
+typedef struct {
+  int type ;
+  const char * name ;
+  alist_struct * H ;
+  regular_struct * G ;
+  qc_struct * Q ;
+  long edges ;
+  vector<double> s2c , c2s ;                /* flat messages (regular, QC) */
+  vector<vector<double> > gs2c , gc2s ;     /* per-node messages (generic) */
+  vector<int> syndrome , counts ;           /* bit-flipping state */
+  vector<qcword> dbits , sbits ;
+} kernel_struct ;
+
+static ofstream benchOut;
+
+
+static double secondsSince(bench_clock::time_point t0)
+{
+  return chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+
+static void row(const string & code, const char * kernel, double snr, const char * metric, double value)
+{
+  ostringstream s;
+  s.precision(8);
+  s << code << '\t' << kernel << '\t';
+  if (isnan(snr))
+    s << '-';
+  else
+    s << snr;
+  s << '\t' << metric << '\t' << value << '\n';
+  cout << s.str();
+  if (benchOut.is_open())
+    benchOut << s.str() << flush;
+}
+
+
+static int isCodeFile(const string & name)
+{
+  size_t n = name.size();
+  return ((n > 6) && (name.compare(n-6,6,".alist") == 0)) || isQCFileName(name.c_str());
+}
+
+
+// Collect code files from the arguments: files are taken as given,
+// directories are searched one level deep (codes/<name>/<file>).
+static void findCodes(const string & path, vector<string> & files, int depth)
+{
+  struct stat st;
+  if (stat(path.c_str(),&st) != 0)
+    return;
+  if (!S_ISDIR(st.st_mode))
+    {
+      if ((depth == 0) || isCodeFile(path))
+	files.push_back(path);
+      return;
+    }
+  if (depth > 1)
+    return;
+  DIR * dir = opendir(path.c_str());
+  if (dir == NULL)
+    return;
+  vector<string> entries;
+  struct dirent * ent;
+  while ((ent = readdir(dir)) != NULL)
+    if (ent->d_name[0] != '.')
+      entries.push_back(path + "/" + ent->d_name);
+  closedir(dir);
+  sort(entries.begin(),entries.end());
+  for (size_t i=0; i<entries.size(); i++)
+    findCodes(entries[i],files,depth+1);
+}
+
+
+static string codeName(const string & path)
+{
+  size_t slash = path.find_last_of('/');
+  return (slash == string::npos) ? path : path.substr(slash+1);
+}
+
+
+static int isBitFlipping(kernel_struct & K)
+{
+  return (K.type == BENCH_GENERIC_GDBF) || (K.type == BENCH_QC_GDBF);
+}
+
+
+static int isBP(kernel_struct & K)
+{
+  return (K.type == BENCH_GENERIC_BP) || (K.type == BENCH_QC_BP);
+}
+
+
+static void setupKernel(kernel_struct & K)
+{
+  alist_struct & H = *K.H;
+  switch (K.type)
+    {
+    case BENCH_GENERIC_MINSUM:
+    case BENCH_GENERIC_BP:
+      setupGenericMessages(H,K.gs2c,K.gc2s);
+      break;
+    case BENCH_REGULAR_MINSUM:
+      setupRegularMessages(*K.G,K.s2c,K.c2s);
+      break;
+    case BENCH_QC_MINSUM:
+    case BENCH_QC_BP:
+      setupQCMessages(*K.Q,K.s2c);
+      setupQCMessages(*K.Q,K.c2s);
+      break;
+    case BENCH_GENERIC_GDBF:
+      K.syndrome.assign(H.M,1);
+      K.counts.assign(H.N,0);
+      break;
+    case BENCH_QC_GDBF:
+      K.dbits.assign(K.Q->nb*qcWords(*K.Q),0);
+      K.sbits.assign(K.Q->mb*qcWords(*K.Q),0);
+      K.counts.assign(H.N,0);
+      break;
+    }
+}
+
+
+static double kernelBytes(kernel_struct & K)
+{
+  double bytes = (K.s2c.size() + K.c2s.size())*sizeof(double);
+  for (size_t i=0; i<K.gs2c.size(); i++)
+    bytes += K.gs2c[i].size()*sizeof(double);
+  for (size_t i=0; i<K.gc2s.size(); i++)
+    bytes += K.gc2s[i].size()*sizeof(double);
+  bytes += (K.syndrome.size() + K.counts.size())*sizeof(int);
+  bytes += (K.dbits.size() + K.sbits.size())*sizeof(qcword);
+  return bytes;
+}
+
+
+static void initializeKernel(kernel_struct & K, vector<double> & llr)
+{
+  if ((K.type == BENCH_GENERIC_MINSUM) || (K.type == BENCH_GENERIC_BP))
+    initializeGenericMessages(*K.H,K.gs2c,llr);
+  else if (K.type == BENCH_REGULAR_MINSUM)
+    initializeRegularMessages(*K.G,K.s2c,llr);
+  else if ((K.type == BENCH_QC_MINSUM) || (K.type == BENCH_QC_BP))
+    initializeQCMessages(*K.Q,K.s2c,llr);
+}
+
+
+// The bit-flipping kernels take the hard decisions d (+1/-1).
+static void checkUpdates(kernel_struct & K, vector<int> & d)
+{
+  switch (K.type)
+    {
+    case BENCH_GENERIC_MINSUM: genericMinSumCheckUpdates(*K.H,K.gs2c,K.gc2s); break;
+    case BENCH_GENERIC_BP:     genericBPCheckUpdates(*K.H,K.gs2c,K.gc2s); break;
+    case BENCH_REGULAR_MINSUM: K.G->minSumCheckUpdates(*K.G,K.s2c,K.c2s); break;
+    case BENCH_QC_MINSUM:      qcMinSumCheckUpdates(*K.Q,K.s2c,K.c2s); break;
+    case BENCH_QC_BP:          qcBPCheckUpdates(*K.Q,K.s2c,K.c2s); break;
+    case BENCH_GENERIC_GDBF:   genericSyndrome(*K.H,d,K.syndrome); break;
+    case BENCH_QC_GDBF:
+      packQCSymbols(*K.Q,d,-1,K.dbits);
+      qcSyndrome(*K.Q,K.dbits,K.sbits);
+      break;
+    }
+}
+
+
+static void symbolUpdates(kernel_struct & K, vector<double> & llr, vector<int> & d)
+{
+  double maxLLR = isBP(K) ? BENCH_MAXLLR : 0.0;
+  switch (K.type)
+    {
+    case BENCH_GENERIC_MINSUM:
+    case BENCH_GENERIC_BP:     genericSymNodeUpdates(*K.H,llr,d,K.gs2c,K.gc2s,maxLLR); break;
+    case BENCH_REGULAR_MINSUM: K.G->symNodeUpdates(*K.G,llr,d,K.s2c,K.c2s); break;
+    case BENCH_QC_MINSUM:
+    case BENCH_QC_BP:          qcSymNodeUpdates(*K.Q,llr,d,K.s2c,K.c2s,maxLLR); break;
+    case BENCH_GENERIC_GDBF:   genericUnsatisfiedCounts(*K.H,K.syndrome,K.counts); break;
+    case BENCH_QC_GDBF:        qcUnsatisfiedCounts(*K.Q,K.sbits,K.counts); break;
+    }
+}
+
+
+static int syndromeSatisfied(alist_struct & H, vector<int> & d)
+{
+  for (int i=0; i<H.M; i++)
+    {
+      int parity = 1;
+      for (int j=0; j<H.num_mlist[i]; j++)
+	parity *= d[H.mlist[i][j]-1];
+      if (parity < 0)
+	return 0;
+    }
+  return 1;
+}
+
+
+// Channel output for the all-zero codeword (x = +1) and the
+// kernel's input: raw samples for min-sum, LLRs for BP.
+static void channelFrame(kernel_struct & K, double sigma, vector<double> & llr)
+{
+  double scale = isBP(K) ? 2.0/(sigma*sigma) : 1.0;
+  for (size_t i=0; i<llr.size(); i++)
+    {
+      double y = 1.0 + sigma*rann();
+      llr[i] = scale*y;
+      if (isBP(K) && (fabs(llr[i]) > BENCH_MAXLLR))
+	llr[i] = (llr[i] < 0) ? -BENCH_MAXLLR : BENCH_MAXLLR;
+    }
+}
+
+
+static double sigmaAt(double snr, double R)
+{
+  return sqrt(pow(10.0,-snr/10.0)/R/2.0);
+}
+
+
+static double percentile(vector<double> & sorted, double p)
+{
+  if (sorted.empty())
+    return 0.0;
+  size_t k = (size_t) ceil(p*sorted.size());
+  return sorted[(k > 0) ? k-1 : 0];
+}
+
+
+static void microBenchmark(const string & code, kernel_struct & K, double snr, double R, double seconds, unsigned int seed)
+{
+  int N = K.H->N;
+  vector<double> llr(N);
+  vector<int> d(N);
+  ran_seed(seed);
+  channelFrame(K,sigmaAt(snr,R),llr);
+  for (int i=0; i<N; i++)
+    d[i] = (llr[i] > 0) ? 1 : -1;
+  initializeKernel(K,llr);
+  checkUpdates(K,d);
+
+  long reps = 0;
+  bench_clock::time_point t0 = bench_clock::now();
+  do
+    {
+      checkUpdates(K,d);
+      reps++;
+    }
+  while (secondsSince(t0) < seconds);
+  row(code,K.name,NAN,"check_edges_per_s",K.edges*reps/secondsSince(t0));
+
+  reps = 0;
+  t0 = bench_clock::now();
+  do
+    {
+      symbolUpdates(K,llr,d);
+      reps++;
+    }
+  while (secondsSince(t0) < seconds);
+  row(code,K.name,NAN,"symbol_edges_per_s",K.edges*reps/secondsSince(t0));
+}
+
+
+static void macroBenchmark(const string & code, alist_struct & H, kernel_struct & K, double snr, double R, int frames, int T, unsigned int seed)
+{
+  vector<double> llr(H.N);
+  vector<int> d(H.N);
+  vector<double> latency(frames);
+  double sigma = sigmaAt(snr,R);
+  long failures = 0, iterations = 0;
+
+  ran_seed(seed);
+  bench_clock::time_point t0 = bench_clock::now();
+  for (int f=0; f<frames; f++)
+    {
+      channelFrame(K,sigma,llr);
+      bench_clock::time_point start = bench_clock::now();
+      initializeKernel(K,llr);
+      int it;
+      for (it=0; it<T; it++)
+	{
+	  checkUpdates(K,d);
+	  symbolUpdates(K,llr,d);
+	  if (syndromeSatisfied(H,d))
+	    break;
+	}
+      latency[f] = 1e6*secondsSince(start);
+      iterations += (it < T) ? it+1 : T;
+      for (int i=0; i<H.N; i++)
+	if (d[i] < 0)
+	  {
+	    failures++;
+	    break;
+	  }
+    }
+  double elapsed = secondsSince(t0);
+
+  sort(latency.begin(),latency.end());
+  row(code,K.name,snr,"frames_per_s",frames/elapsed);
+  row(code,K.name,snr,"fer",(double) failures/frames);
+  row(code,K.name,snr,"mean_iterations",(double) iterations/frames);
+  row(code,K.name,snr,"latency_p50_us",percentile(latency,0.50));
+  row(code,K.name,snr,"latency_p90_us",percentile(latency,0.90));
+  row(code,K.name,snr,"latency_p99_us",percentile(latency,0.99));
+  row(code,K.name,snr,"latency_max_us",latency.back());
+}
+
+
+static void benchmarkKernel(const string & code, alist_struct & H, kernel_struct & K, vector<double> & snrs, double R, double seconds, int frames, int T, unsigned int seed)
+{
+  setupKernel(K);
+  row(code,K.name,NAN,"message_bytes",kernelBytes(K));
+  microBenchmark(code,K,snrs[0],R,seconds,seed);
+  if (isBitFlipping(K))
+    return;
+  for (size_t s=0; s<snrs.size(); s++)
+    macroBenchmark(code,H,K,snrs[s],R,frames,T,seed);
+}
+
+
+// Benchmark one kernel type on a code, if selected by --kernels.
+static void runKernel(int type, const string & code, alist_struct & H, regular_struct * G, qc_struct * Q, long edges,
+		      vector<int> & selected, vector<double> & snrs, double R, double seconds, int frames, int T, unsigned int seed)
+{
+  if (!selected[type])
+    return;
+  kernel_struct K;
+  K.type = type;
+  K.name = kernelNames[type];
+  K.H = &H;
+  K.G = G;
+  K.Q = Q;
+  K.edges = edges;
+  benchmarkKernel(code,H,K,snrs,R,seconds,frames,T,seed);
+}
+
+
+int main(int argc, char * argv[])
+{
+  const char * options =
+    "  --snr=s1,s2,...  Eb/N0 points for the decode benchmark (default 2.5,3.5)\n"
+    "  --frames=n       frames decoded per SNR point (default 200)\n"
+    "  --iterations=T   iteration limit (default 20)\n"
+    "  --seconds=t      duration of each kernel micro-benchmark (default 0.5)\n"
+    "  --kernels=k1,... kernels to run (default all):\n"
+    "                   generic-minsum, generic-bp, regular-minsum, qc-minsum,\n"
+    "                   qc-bp, generic-gdbf, qc-gdbf\n"
+    "  --seed=S         noise seed (default 1)\n"
+    "  --out=f          also append result rows to f\n"
+    "  --help           print this summary\n";
+  parseOptions(argc,argv,options);
+  if (hasOption("help"))
+    {
+      cout << "Usage: " << argv[0] << " [codes directory | code files ...]\n" << options;
+      return 0;
+    }
+
+  vector<double> snrs;
+  string snrList = optionString("snr","2.5,3.5");
+  for (char * tok = strtok(&snrList[0],","); tok != NULL; tok = strtok(NULL,","))
+    snrs.push_back(atof(tok));
+  if (snrs.empty())
+    snrs.push_back(2.5);
+  int frames = (int) optionLong("frames",200);
+  int T = (int) optionLong("iterations",20);
+  double seconds = optionDouble("seconds",0.5);
+  unsigned int seed = (unsigned int) optionLong("seed",1);
+  if (hasOption("out"))
+    benchOut.open(optionString("out","").c_str(),ios::app);
+  vector<int> selected(BENCH_KERNELS,!hasOption("kernels"));
+  string kernelList = optionString("kernels","");
+  for (char * tok = strtok(&kernelList[0],","); tok != NULL; tok = strtok(NULL,","))
+    {
+      int k = 0;
+      while ((k < BENCH_KERNELS) && (strcmp(tok,kernelNames[k]) != 0))
+	k++;
+      if (k == BENCH_KERNELS)
+	{
+	  cout << "Unknown kernel " << tok << "\n";
+	  return 1;
+	}
+      selected[k] = 1;
+    }
+
+  vector<string> files;
+  if (argc < 2)
+    findCodes("codes",files,0);
+  for (int i=1; i<argc; i++)
+    findCodes(argv[i],files,0);
+  if (files.empty())
+    {
+      cout << "No code files found. Run from C_implementations or name a codes directory.\n";
+      return 1;
+    }
+
+  cout << "#code\tkernel\tsnr\tmetric\tvalue\n";
+  for (size_t f=0; f<files.size(); f++)
+    {
+      string code = codeName(files[f]);
+      alist_struct H = loadFile(files[f].c_str());
+      double R = (double) (H.N - H.M)/H.N;
+      long edges = 0;
+      for (int i=0; i<H.M; i++)
+	edges += H.num_mlist[i];
+      row(code,"-",NAN,"N",H.N);
+      row(code,"-",NAN,"M",H.M);
+      row(code,"-",NAN,"edges",edges);
+      if (H.M >= H.N)
+	{
+	  cout << "# " << files[f] << ": M >= N, skipping (transposed alist?)\n";
+	  freeAlist(H);
+	  continue;
+	}
+
+      runKernel(BENCH_GENERIC_MINSUM,code,H,NULL,NULL,edges,selected,snrs,R,seconds,frames,T,seed);
+      runKernel(BENCH_GENERIC_BP,code,H,NULL,NULL,edges,selected,snrs,R,seconds,frames,T,seed);
+      runKernel(BENCH_GENERIC_GDBF,code,H,NULL,NULL,edges,selected,snrs,R,seconds,frames,T,seed);
+
+      regular_struct G;
+      if (detectRegular(H,G))
+	runKernel(BENCH_REGULAR_MINSUM,code,H,&G,NULL,G.E,selected,snrs,R,seconds,frames,T,seed);
+
+      qc_struct Q;
+      if (detectQC(H,Q))
+	{
+	  long qcEdges = (long) Q.E*Q.Z;
+	  runKernel(BENCH_QC_MINSUM,code,H,NULL,&Q,qcEdges,selected,snrs,R,seconds,frames,T,seed);
+	  runKernel(BENCH_QC_BP,code,H,NULL,&Q,qcEdges,selected,snrs,R,seconds,frames,T,seed);
+	  runKernel(BENCH_QC_GDBF,code,H,NULL,&Q,qcEdges,selected,snrs,R,seconds,frames,T,seed);
+	}
+      freeAlist(H);
+    }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+  row("all","-",NAN,"peak_rss_kb",usage.ru_maxrss);
+  return 0;
+}
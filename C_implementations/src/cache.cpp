@@ -0,0 +1,156 @@
+/*==========================================================================================
+** cache.cpp
+** By Chris Winstead
+
+** Description:
+   Persistent result cache keyed by a hash of the simulation point.
+   See cache.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "options.h"
+using namespace std;
+
+
+unsigned long long fnv1a(const string & text, unsigned long long h)
+{
+  for (int i=0; i<text.size(); i++)
+    {
+      h ^= (unsigned char) text[i];
+      h *= 0x100000001b3ULL;
+    }
+  return h;
+}
+
+
+static string hexKey(unsigned long long h)
+{
+  char buf[17];
+  snprintf(buf,sizeof(buf),"%016llx",h);
+  return string(buf);
+}
+
+
+// Hash of a file's contents, or "none" if it is not a regular file.
+static string contentsKey(string fileName)
+{
+  struct stat st;
+  if ((stat(fileName.c_str(),&st) != 0) || !S_ISREG(st.st_mode))
+    return "none";
+  ifstream f(fileName.c_str(),ios::binary);
+  stringstream contents;
+  contents << f.rdbuf();
+  return hexKey(fnv1a(contents.str()));
+}
+
+
+void setupCache(cache_struct & cache, snapshot_struct & snap, crn_struct & crn, const char * binary, string logfilename)
+{
+  cache.enabled = hasOption("cache");
+  cache.params.clear();
+  if (!cache.enabled)
+    return;
+  if (hasOption("shard") || hasOption("merge-shards"))
+    {
+      cout << "Result cache is not used with shards." << endl;
+      cache.enabled = 0;
+      return;
+    }
+
+  string name(binary);
+  size_t slash = name.rfind('/');
+  if (slash != string::npos)
+    name = name.substr(slash+1);
+  cache.params.push_back("key binary=" + name);
+  // A rebuilt binary may decode differently under the same name:
+  cache.params.push_back("key exe=" + contentsKey("/proc/self/exe"));
+
+  // The first positional argument is the code file. Any later one
+  // naming a file is the codeword file:
+  for (int i=0; i<snap.params.size(); i++)
+    {
+      const string & p = snap.params[i];
+      if (p == "arg " + logfilename)
+	continue;
+      if ((p.compare(0,4,"opt ") == 0) && stoppingOption(p.substr(4,p.find('=')-4)))
+	continue;
+      cache.params.push_back(p);
+      if (i == 0)
+	cache.params.push_back("key code=" + contentsKey(p.substr(4)));
+      else if ((p.compare(0,4,"arg ") == 0) && (contentsKey(p.substr(4)) != "none"))
+	cache.params.push_back("key codewords=" + contentsKey(p.substr(4)));
+      else if (p.compare(0,17,"opt is-positions=") == 0)
+	cache.params.push_back("key is-positions=" + contentsKey(p.substr(17)));
+    }
+
+  stringstream seed;
+  if (hasOption("crn"))
+    seed << "key seed=crn:" << crn.seed;
+  else
+    seed << "key seed=clock";
+  cache.params.push_back(seed.str());
+
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  for (int i=0; i<cache.params.size(); i++)
+    h = fnv1a(cache.params[i] + "\n",h);
+  cache.fileName = optionString("cache",".") + "/" + hexKey(h) + ".result";
+}
+
+
+static long savedFrames(string fileName)
+{
+  ifstream f(fileName.c_str());
+  string line;
+  while (getline(f,line))
+    if (line.compare(0,11,"totalWords ") == 0)
+      return atol(line.c_str()+11);
+  return -1;
+}
+
+
+bool loadCachedResult(cache_struct & cache, snapshot_struct & snap)
+{
+  if (!cache.enabled)
+    return false;
+  if (!readSnapshotFile(snap,cache.fileName,SNAP_CONTINUE,cache.params))
+    {
+      cout << "No cached result in " << cache.fileName << endl;
+      return false;
+    }
+  cout << "Continuing from cached result " << cache.fileName << " (" << savedFrames(cache.fileName) << " frames)" << endl;
+  return true;
+}
+
+
+void storeCachedResult(cache_struct & cache, snapshot_struct & snap)
+{
+  if (!cache.enabled)
+    return;
+
+  long frames = -1;
+  for (int i=0; i<snap.fields.size(); i++)
+    if (snap.fields[i].name == "totalWords")
+      frames = *(long *) snap.fields[i].p;
+
+  string lockName = cache.fileName + ".lock";
+  int lock = open(lockName.c_str(),O_CREAT|O_RDWR,0666);
+  if (lock >= 0)
+    flock(lock,LOCK_EX);
+  if (savedFrames(cache.fileName) > frames)
+    cout << "Cache already holds a longer run of this point; not updated." << endl;
+  else if (!writeSnapshotFile(snap,cache.fileName,cache.params))
+    cout << "Failed to store result in " << cache.fileName << endl;
+  if (lock >= 0)
+    close(lock);
+}
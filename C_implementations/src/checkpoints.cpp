@@ -0,0 +1,107 @@
+/*==========================================================================================
+** checkpoints.cpp
+** By Chris Winstead
+
+** Description:
+   Per-iteration-limit error accounting. See checkpoints.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include "checkpoints.h"
+#include "options.h"
+using namespace std;
+
+
+void setupCheckpoints(checkpoint_struct & cp, int maxIterations, int N)
+{
+  cp.enabled = hasOption("checkpoints");
+  cp.N = N;
+  cp.frames = 0;
+  cp.next = 0;
+  cp.T.clear();
+  if (!cp.enabled)
+    return;
+
+  string list = optionString("checkpoints","");
+  replace(list.begin(),list.end(),',',' ');
+  stringstream ss(list);
+  int t;
+  while (ss >> t)
+    if ((t > 0) && (t < maxIterations))
+      cp.T.push_back(t);
+  cp.T.push_back(maxIterations);
+  sort(cp.T.begin(),cp.T.end());
+  cp.T.erase(unique(cp.T.begin(),cp.T.end()),cp.T.end());
+
+  cp.bitErrors.assign(cp.T.size(),0);
+  cp.wordErrors.assign(cp.T.size(),0);
+  cp.iterations.assign(cp.T.size(),0);
+
+  cout << "Checkpoints at T =";
+  for (int k=0; k<cp.T.size(); k++)
+    cout << " " << cp.T[k];
+  cout << endl;
+}
+
+
+void beginCheckpointFrame(checkpoint_struct & cp)
+{
+  cp.next = 0;
+}
+
+
+// Score the decisions present after 'it' iterations against the
+// next checkpoint.
+void recordCheckpoint(checkpoint_struct & cp, int frameErrors, int it)
+{
+  cp.bitErrors[cp.next] += frameErrors;
+  cp.wordErrors[cp.next] += (frameErrors > 0);
+  cp.iterations[cp.next] += it;
+  cp.next++;
+}
+
+
+// The frame finished after 'it' iterations with frameErrors errors;
+// every checkpoint not yet reached sees the same outcome.
+void finishCheckpointFrame(checkpoint_struct & cp, int frameErrors, int it)
+{
+  if (!cp.enabled)
+    return;
+  while (cp.next < cp.T.size())
+    recordCheckpoint(cp,frameErrors,it);
+  cp.frames++;
+}
+
+
+void reportCheckpoints(checkpoint_struct & cp)
+{
+  if (!cp.enabled || (cp.frames == 0))
+    return;
+  double bits = (double) cp.frames*cp.N;
+  cout << "\nResults by iteration limit:\n\tT\tBER\tFER\tavg.it\n";
+  for (int k=0; k<cp.T.size(); k++)
+    cout << "\t" << cp.T[k] << "\t" << cp.bitErrors[k]/bits << "\t"
+	 << (double) cp.wordErrors[k]/cp.frames << "\t" << (double) cp.iterations[k]/cp.frames << endl;
+}
+
+
+void writeCheckpointLog(checkpoint_struct & cp, string logfilename, double SNR, const char * codeName)
+{
+  if (!cp.enabled || (cp.frames == 0))
+    return;
+  string fileName = logfilename + ".checkpoints";
+  ofstream of(fileName.c_str(),ios::app);
+  char tab = '\t';
+  double bits = (double) cp.frames*cp.N;
+  for (int k=0; k<cp.T.size(); k++)
+    of << SNR << tab << cp.T[k] << tab << cp.bitErrors[k]/bits << tab
+       << (double) cp.iterations[k]/cp.frames << tab << (double) cp.wordErrors[k]/cp.frames << tab
+       << (long) bits << tab << cp.frames << tab << codeName << endl;
+  of.close();
+}
@@ -0,0 +1,119 @@
+//==============================================================
+// compareOutcomes.cpp
+//
+// Paired comparison of two per-frame outcome files written with
+// --outcomes by runs that shared a --crn seed. Frames are matched
+// by index; the discordant counts (A failed while B decoded, and
+// the reverse) drive McNemar's test and a paired confidence
+// interval on the FER difference.
+//==============================================================
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+using namespace std;
+
+#include "outcomes.h"
+#include "stopping.h"
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3)
+    {
+      cout << "Usage: " << argv[0] << " outcomesA outcomesB\n";
+      return 0;
+    }
+
+  FILE * fa = openOutcomeFileForReading(argv[1]);
+  FILE * fb = openOutcomeFileForReading(argv[2]);
+  if ((fa == NULL) || (fb == NULL))
+    {
+      cout << "Could not read outcome file " << (fa == NULL ? argv[1] : argv[2]) << endl;
+      return 1;
+    }
+
+  long n = 0, n11 = 0, nA = 0, nB = 0;   // nA: only A failed, nB: only B failed
+  long bitsA = 0, bitsB = 0, itA = 0, itB = 0;
+  long unmatched = 0;
+  outcome_record a, b;
+  int haveA = readOutcome(fa,a);
+  int haveB = readOutcome(fb,b);
+  while (haveA && haveB)
+    {
+      if (a.frame < b.frame)
+	{
+	  unmatched++;
+	  haveA = readOutcome(fa,a);
+	  continue;
+	}
+      if (b.frame < a.frame)
+	{
+	  unmatched++;
+	  haveB = readOutcome(fb,b);
+	  continue;
+	}
+      n++;
+      bool failA = (a.errors > 0);
+      bool failB = (b.errors > 0);
+      if (failA && failB)
+	n11++;
+      else if (failA)
+	nA++;
+      else if (failB)
+	nB++;
+      bitsA += a.errors;
+      bitsB += b.errors;
+      itA += a.iterations;
+      itB += b.iterations;
+      haveA = readOutcome(fa,a);
+      haveB = readOutcome(fb,b);
+    }
+  fclose(fa);
+  fclose(fb);
+
+  if (n == 0)
+    {
+      cout << "No frames in common.\n";
+      return 1;
+    }
+
+  double ferA = (double) (n11+nA)/n;
+  double ferB = (double) (n11+nB)/n;
+  double diff = (double) (nA-nB)/n;
+  double pairedVar = ((double) (nA+nB)/n - diff*diff)/n;
+  double unpairedVar = (ferA*(1-ferA) + ferB*(1-ferB))/n;
+  double z = 1.959964;
+
+  cout << "Paired frames:\t" << n;
+  if (unmatched > 0)
+    cout << " (" << unmatched << " unmatched records ignored)";
+  cout << "\n";
+  cout << "A: FER=" << ferA << ", bit errors/frame=" << (double) bitsA/n << ", avg iterations=" << (double) itA/n << "\n";
+  cout << "B: FER=" << ferB << ", bit errors/frame=" << (double) bitsB/n << ", avg iterations=" << (double) itB/n << "\n";
+  cout << "Both failed:\t" << n11 << "\n";
+  cout << "A failed, B decoded:\t" << nA << "\n";
+  cout << "B failed, A decoded:\t" << nB << "\n";
+  cout << "FER(A)-FER(B) = " << diff << ", 95% paired interval [" << diff - z*sqrt(pairedVar)
+       << ", " << diff + z*sqrt(pairedVar) << "]\n";
+
+  long discordant = nA + nB;
+  if (discordant > 0)
+    {
+      // Exact two-sided McNemar test: the smaller discordant count
+      // against Binomial(discordant, 1/2).
+      long k = (nA < nB) ? nA : nB;
+      double p = 2.0*incompleteBeta(discordant-k, k+1, 0.5);
+      if (p > 1.0)
+	p = 1.0;
+      double chi2 = (fabs((double) (nA-nB)) - 1.0);
+      chi2 = chi2*chi2/discordant;
+      cout << "McNemar: chi2=" << chi2 << ", exact p=" << p << "\n";
+    }
+  else
+    cout << "McNemar: no discordant frames.\n";
+
+  if (pairedVar > 0)
+    cout << "Variance reduction from pairing: " << unpairedVar/pairedVar
+	 << "x (unpaired runs would need about that many times more frames)\n";
+  return 0;
+}
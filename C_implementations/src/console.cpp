@@ -0,0 +1,171 @@
+/*==========================================================================================
+** console.cpp
+** By Chris Winstead
+
+** Description:
+   Ring buffer and writer thread for buffered console output.
+   See console.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include "console.h"
+#include "options.h"
+using namespace std;
+
+// The producer (decode thread) owns tail, the writer owns head.
+// Slots in [head,tail) hold messages waiting to be written.
+typedef struct {
+  int started ;
+  vector<string> slots ;
+  atomic<unsigned> head ;
+  atomic<unsigned> tail ;
+  atomic<bool> stopping ;
+  thread writer ;
+
+  /* producer-side rate limiting */
+  double rate ;             /* events per second */
+  double tokens ;
+  chrono::steady_clock::time_point lastRefill ;
+  long suppressed ;
+} console_struct ;
+
+static console_struct console;
+
+
+static bool writeOne()
+{
+  unsigned h = console.head.load(memory_order_relaxed);
+  if (h == console.tail.load(memory_order_acquire))
+    return false;
+  string & s = console.slots[h & (CONSOLE_SLOTS-1)];
+  fwrite(s.data(),1,s.size(),stdout);
+  s.clear();
+  console.head.store(h+1,memory_order_release);
+  return true;
+}
+
+
+static void writerLoop()
+{
+  while (true)
+    {
+      bool wrote = false;
+      while (writeOne())
+	wrote = true;
+      if (wrote)
+	fflush(stdout);
+      else if (console.stopping.load(memory_order_acquire))
+	return;
+      else
+	this_thread::sleep_for(chrono::milliseconds(2));
+    }
+}
+
+
+// Joins the writer when the program exits, after the last message.
+static struct console_exit {
+  ~console_exit()
+  {
+    if (!console.started)
+      return;
+    console.stopping.store(true,memory_order_release);
+    console.writer.join();
+    console.started = 0;
+  }
+} consoleExit;
+
+
+void setupConsole()
+{
+  if (console.started)
+    return;
+  console.slots.assign(CONSOLE_SLOTS,string());
+  console.head.store(0);
+  console.tail.store(0);
+  console.stopping.store(false);
+  console.rate = optionDouble("console-rate",10.0);
+  console.tokens = console.rate;
+  console.lastRefill = chrono::steady_clock::now();
+  console.suppressed = 0;
+  cout << flush;
+  console.writer = thread(writerLoop);
+  console.started = 1;
+}
+
+
+static bool push(const string & msg, bool wait)
+{
+  unsigned t = console.tail.load(memory_order_relaxed);
+  while (t - console.head.load(memory_order_acquire) >= CONSOLE_SLOTS)
+    {
+      if (!wait)
+	return false;
+      this_thread::yield();
+    }
+  console.slots[t & (CONSOLE_SLOTS-1)] = msg;
+  console.tail.store(t+1,memory_order_release);
+  return true;
+}
+
+
+static bool takeToken()
+{
+  if (console.rate <= 0)
+    return false;
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  console.tokens += console.rate*chrono::duration<double>(now - console.lastRefill).count();
+  console.lastRefill = now;
+  if (console.tokens > console.rate)
+    console.tokens = console.rate;
+  if (console.tokens < 1.0)
+    return false;
+  console.tokens -= 1.0;
+  return true;
+}
+
+
+static void pushSuppressed()
+{
+  if (console.suppressed == 0)
+    return;
+  ostringstream s;
+  s << "(" << console.suppressed << " frame reports suppressed)\n";
+  push(s.str(),true);
+  console.suppressed = 0;
+}
+
+
+void consoleWrite(const string & msg, int kind)
+{
+  if (!console.started)
+    {
+      cout << msg << flush;
+      return;
+    }
+  if (kind == CONSOLE_EVENT)
+    {
+      if (!takeToken() || !push(msg,false))
+	console.suppressed++;
+      return;
+    }
+  pushSuppressed();
+  push(msg,true);
+}
+
+
+void drainConsole()
+{
+  if (!console.started)
+    return;
+  pushSuppressed();
+  while (console.head.load(memory_order_acquire) != console.tail.load(memory_order_acquire))
+    this_thread::sleep_for(chrono::milliseconds(1));
+  fflush(stdout);
+}
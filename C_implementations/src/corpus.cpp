@@ -0,0 +1,245 @@
+/*==========================================================================================
+** corpus.cpp
+** By Chris Winstead
+
+** Description:
+   Failure corpus capture and replay. See corpus.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include "corpus.h"
+#include "options.h"
+#include "console.h"
+using namespace std;
+
+
+static void writeCorpusHeader(FILE * fp, int N, double SNR, double R, int argc, char * argv[])
+{
+  string text;
+  for (int i=0; i<argc; i++)
+    text += string(argv[i]) + " ";
+  int len = text.size();
+  fwrite(CORPUS_MAGIC,1,8,fp);
+  fwrite(&N,sizeof(int),1,fp);
+  fwrite(&len,sizeof(int),1,fp);
+  fwrite(&SNR,sizeof(double),1,fp);
+  fwrite(&R,sizeof(double),1,fp);
+  fwrite(text.data(),1,len,fp);
+}
+
+
+// Read and check a corpus header. Returns the header size, or -1.
+static long readCorpusHeader(FILE * fp, int & N, double & SNR, double & R)
+{
+  char magic[8];
+  int len;
+  if ((fread(magic,1,8,fp) != 8) || (memcmp(magic,CORPUS_MAGIC,8) != 0))
+    return -1;
+  if ((fread(&N,sizeof(int),1,fp) != 1) || (fread(&len,sizeof(int),1,fp) != 1)
+      || (fread(&SNR,sizeof(double),1,fp) != 1) || (fread(&R,sizeof(double),1,fp) != 1))
+    return -1;
+  return 8 + 2*sizeof(int) + 2*sizeof(double) + len;
+}
+
+
+void setupCorpus(corpus_struct & corpus, int N, double SNR, double R, stopping_struct & stop, reorder_struct * order, int argc, char * argv[])
+{
+  corpus.N = N;
+  corpus.out = NULL;
+  corpus.in = NULL;
+  corpus.replay = 0;
+  corpus.records = 0;
+  corpus.order = order;
+  corpus.recordSize = sizeof(long long) + 2*sizeof(int) + N*sizeof(double) + 2*((N+7)/8);
+  corpus.buffer.assign(corpus.recordSize,0);
+  corpus.y.assign(N,0);
+
+  if (hasOption("corpus-in"))
+    {
+      string fileName = optionString("corpus-in","");
+      int n;
+      double snr, rate;
+      corpus.in = fopen(fileName.c_str(),"rb");
+      if ((corpus.in == NULL) || ((corpus.headerSize = readCorpusHeader(corpus.in,n,snr,rate)) < 0) || (n != N))
+	{
+	  cout << "Error: " << fileName << " is not a failure corpus for a code with N=" << N << endl;
+	  exit(1);
+	}
+      fseek(corpus.in,0,SEEK_END);
+      corpus.records = (ftell(corpus.in) - corpus.headerSize)/corpus.recordSize;
+      corpus.replay = 1;
+      if ((stop.maxFrames <= 0) || (stop.maxFrames > corpus.records))
+	stop.maxFrames = corpus.records;
+      stop.mode = STOP_RULES;
+      cout << "Re-decoding " << stop.maxFrames << " of " << corpus.records << " frames from " << fileName
+	   << " (recorded at SNR=" << snr << ")" << endl;
+      if (fabs(snr - SNR) > 1e-9)
+	cout << "Warning: decoding at SNR=" << SNR << ", corpus was recorded at SNR=" << snr << endl;
+    }
+
+  if (hasOption("corpus-out"))
+    {
+      string fileName = optionString("corpus-out","");
+      int n;
+      double snr, rate;
+      corpus.out = fopen(fileName.c_str(),"rb");
+      if (corpus.out != NULL)
+	{
+	  long header = readCorpusHeader(corpus.out,n,snr,rate);
+	  fclose(corpus.out);
+	  if ((header < 0) || (n != N))
+	    {
+	      cout << "Error: " << fileName << " exists and is not a corpus for N=" << N << endl;
+	      exit(1);
+	    }
+	  corpus.out = fopen(fileName.c_str(),"ab");
+	  if (corpus.out != NULL)
+	    fseek(corpus.out,0,SEEK_END);   // so a snapshot records the length
+	}
+      else
+	{
+	  corpus.out = fopen(fileName.c_str(),"wb");
+	  if (corpus.out != NULL)
+	    writeCorpusHeader(corpus.out,N,SNR,R,argc,argv);
+	}
+      if (corpus.out == NULL)
+	cout << "Failed to open corpus " << fileName << endl;
+      else
+	cout << "Appending failed frames to " << fileName << endl;
+    }
+}
+
+
+// Load record 'frame' of the input corpus: the codeword into c
+// (bit 1 stored as 'one', bit 0 as +1 or 0 accordingly), the
+// modulated codeword into x and the channel samples into corpus.y,
+// all in decoder order.
+void readCorpusFrame(corpus_struct & corpus, long frame, vector<int> & c, vector<double> & x, int one)
+{
+  int N = corpus.N;
+  int zero = (one == -1) ? 1 : 0;
+  fseek(corpus.in,corpus.headerSize + frame*corpus.recordSize,SEEK_SET);
+  if (fread(corpus.buffer.data(),1,corpus.recordSize,corpus.in) != corpus.recordSize)
+    {
+      drainConsole();
+      cout << "Error: short read of corpus record " << frame << endl;
+      exit(1);
+    }
+  unsigned char * p = corpus.buffer.data() + sizeof(long long) + 2*sizeof(int);
+  memcpy(corpus.y.data(),p,N*sizeof(double));
+  p += N*sizeof(double);
+  for (int i=0; i<N; i++)
+    {
+      int bit = (p[i/8] >> (i%8)) & 1;
+      c[i] = bit ? one : zero;
+      x[i] = 1 - 2*bit;
+    }
+  if (corpus.order != NULL)
+    {
+      toReordered(*corpus.order,c);
+      toReordered(*corpus.order,x);
+      toReordered(*corpus.order,corpus.y);
+    }
+}
+
+
+static void packBits(vector<int> & v, int one, unsigned char * p)
+{
+  for (int i=0; i<v.size(); i++)
+    if (v[i] == one)
+      p[i/8] |= 1 << (i%8);
+}
+
+
+// Append one failed frame. y, c and d are in decoder order; c and
+// d hold 'one' for a 1 bit.
+void writeCorpusFrame(corpus_struct & corpus, long frame, int errors, int iterations, vector<double> & y, vector<int> & c, vector<int> & d, int one)
+{
+  if (corpus.out == NULL)
+    return;
+  int N = corpus.N;
+  vector<double> ys(y);
+  vector<int> cs(c), ds(d);
+  if (corpus.order != NULL)
+    {
+      fromReordered(*corpus.order,ys);
+      fromReordered(*corpus.order,cs);
+      fromReordered(*corpus.order,ds);
+    }
+
+  unsigned char * p = corpus.buffer.data();
+  memset(p,0,corpus.recordSize);
+  long long f = frame;
+  memcpy(p,&f,sizeof(long long));
+  p += sizeof(long long);
+  memcpy(p,&errors,sizeof(int));
+  p += sizeof(int);
+  memcpy(p,&iterations,sizeof(int));
+  p += sizeof(int);
+  memcpy(p,ys.data(),N*sizeof(double));
+  p += N*sizeof(double);
+  packBits(cs,one,p);
+  packBits(ds,one,p + (N+7)/8);
+  fwrite(corpus.buffer.data(),1,corpus.recordSize,corpus.out);
+}
+
+
+void closeCorpus(corpus_struct & corpus)
+{
+  if (corpus.out != NULL)
+    fclose(corpus.out);
+  if (corpus.in != NULL)
+    fclose(corpus.in);
+  corpus.out = NULL;
+  corpus.in = NULL;
+}
+
+
+// Open a corpus for reading outside a simulation (no reordering).
+bool openCorpus(corpus_struct & corpus, const string & fileName)
+{
+  double snr, rate;
+  corpus.out = NULL;
+  corpus.replay = 0;
+  corpus.order = NULL;
+  corpus.in = fopen(fileName.c_str(),"rb");
+  if ((corpus.in == NULL) || ((corpus.headerSize = readCorpusHeader(corpus.in,corpus.N,snr,rate)) < 0))
+    {
+      closeCorpus(corpus);
+      return false;
+    }
+  corpus.recordSize = sizeof(long long) + 2*sizeof(int) + corpus.N*sizeof(double) + 2*((corpus.N+7)/8);
+  corpus.buffer.assign(corpus.recordSize,0);
+  corpus.y.assign(corpus.N,0);
+  fseek(corpus.in,0,SEEK_END);
+  corpus.records = (ftell(corpus.in) - corpus.headerSize)/corpus.recordSize;
+  return true;
+}
+
+
+// Codeword and decision bits (0 or 1) of record 'frame', in the
+// code's natural order.
+void readCorpusBits(corpus_struct & corpus, long frame, vector<int> & c, vector<int> & d)
+{
+  int N = corpus.N;
+  fseek(corpus.in,corpus.headerSize + frame*corpus.recordSize,SEEK_SET);
+  if (fread(corpus.buffer.data(),1,corpus.recordSize,corpus.in) != corpus.recordSize)
+    {
+      cout << "Error: short read of corpus record " << frame << endl;
+      exit(1);
+    }
+  unsigned char * p = corpus.buffer.data() + sizeof(long long) + 2*sizeof(int) + N*sizeof(double);
+  c.resize(N);
+  d.resize(N);
+  for (int i=0; i<N; i++)
+    {
+      c[i] = (p[i/8] >> (i%8)) & 1;
+      d[i] = (p[(N+7)/8 + i/8] >> (i%8)) & 1;
+    }
+}
@@ -20,33 +20,47 @@ using namespace std;
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
 #include "rand.h"
+#include "encoder.h"
+#include "options.h"
+#include "reorder.h"
+#include "stopping.h"
+#include "impsample.h"
+#include "extrapolate.h"
+#include "checkpoints.h"
+#include "rng.h"
+#include "outcomes.h"
+#include "snapshot.h"
+#include "shard.h"
+#include "cache.h"
+#include "corpus.h"
+#include "llrstream.h"
+#include "stagetimer.h"
+#include "sla.h"
+#include "results.h"
+#include "iterhist.h"
+#include "status.h"
+#include "console.h"
+#include "perfcounters.h"
+#include "qc.h"
+#include "generic.h"
 
 
 //============ GLOBAL PARAMETERS ============//
 int    num_iterations; // Maximum number of iterations 
 double MAXLLR;         // Maximum magnitude of LLR messages
 
-//============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
-
-
 //============= SUPPORTING FUNCTION PREDEFINES =================//
-void setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check);
-void setupCheckMessages(alist_struct & H, vector<vector<double> > & check_to_sym);
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<double> & y);
 double sgn(double x);
 int find(int symNodes[], int len, int snode);
 int countDecisionErrors(vector<int> d, vector<int> c);
 
 //============= I/O PREDEFINES ============================//
-void printHistogram(vector<int> & h);
+void printHistogram(vector<int> & h, ostream & os);
 void printVector(vector<int> v);
 void printVector(vector<double> v);
 void printErroneousMessages(vector<vector<int> > v);
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, int fid);
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, vector<double> & y, vector<int> & yq, vector<int> & r, int fid, int it);
-void sendMQTT(int bitErrors, int frameErrors, int totalBits, int totalWords);
 
 
 
@@ -64,15 +78,16 @@ int main(int argc, char * argv[])
   command_arguments.push_back("SNR");
   command_arguments.push_back("T");
   command_arguments.push_back("logfilename");
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename | random]");
 
   // Check arguments and print usage statements:
+  parseOptions(argc,argv);
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
       cout << "Usage: " << argv[0];
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
-      cout << "\n";
+      cout << "\n" << optionUsage();
       return 0;
     }
 
@@ -80,6 +95,11 @@ int main(int argc, char * argv[])
   int idx=1;
   alist_struct H = loadFile(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
+  printOptions();
+  reorder_struct order;
+  bool reordered = hasOption("reorder");
+  if (reordered)
+    reorderCode(H,order);
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
   //double pchan = atof(argv[idx++]);
@@ -92,7 +112,17 @@ int main(int argc, char * argv[])
   cout << " log = \t" << logfilename << endl;
 
   ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  encoder_struct encoder;
+  vector<int> bits(H.N,0);      // Codeword bits drawn from the built-in encoder
+  bool randomCodewords = false;
+  if ((argc == command_arguments.size()+1) && (string(argv[idx]) == "random"))
+    {
+      cout << "\nUsing random codewords from the built-in encoder.\n";
+      if (setupEncoder(H,encoder))
+	exit(1);
+      randomCodewords = true;
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
       codewordFile.open(argv[idx],ios::in);
@@ -136,8 +166,20 @@ int main(int argc, char * argv[])
   vector<vector<double> > sym_to_check;
 
   // Allocate appropriate sizes for the message memories:                                                                                                                                                         
-  setupSymMessages(H,sym_to_check);
-  setupCheckMessages(H,check_to_sym);
+  setupGenericMessages(H,sym_to_check,check_to_sym);
+
+  // Quasi-cyclic codes use block-rotation kernels with contiguous
+  // per-block message memories instead:
+  qc_struct Hqc;
+  bool useQC = !reordered && detectQC(H,Hqc);
+  vector<double> qc_check_to_sym;
+  vector<double> qc_sym_to_check;
+  if (useQC)
+    {
+      cout << "Quasi-cyclic code detected: Z=" << Hqc.Z << ", base matrix " << Hqc.mb << "x" << Hqc.nb << endl;
+      setupQCMessages(Hqc,qc_sym_to_check);
+      setupQCMessages(Hqc,qc_check_to_sym);
+    }
 
   /////////////////////////////////////////////////////////////////
   // ------===== MAIN TEST LOOP =====-------
@@ -147,11 +189,77 @@ int main(int argc, char * argv[])
   if (H.N > 50000) minWordErrors = 5;
   ran_seed(time(0)); //(134159);
   int i,j;
-  while ((errors < 200) || (wordErrors < minWordErrors))
+  is_struct IS;
+  setupImportanceSampling(IS,H.N);
+  if (reordered)
+    toReordered(order,IS.biased);
+  extrap_struct X;
+  setupExtrapolation(X,SNR,R,H.N);
+  crn_struct crn;
+  setupCommonRandomNumbers(crn);
+  outcome_struct outcomes;
+  openOutcomeFile(outcomes);
+  checkpoint_struct cp;
+  setupCheckpoints(cp,num_iterations,H.N);
+  stopping_struct stop;
+  setupStopping(stop,IS,200,minWordErrors,0);
+  corpus_struct corpus;
+  setupCorpus(corpus,H.N,SNR,R,stop,reordered ? &order : NULL,argc,argv);
+  llrstream_struct stream;
+  setupLLRStream(stream,H.N,sigma,stop,reordered ? &order : NULL);
+  shard_struct shard;
+  setupShard(shard,crn,stop);
+  snapshot_struct snap;
+  setupSnapshot(snap,crn,argc,argv);
+  keyDecoderStream(crn,argv[0],snap.params,logfilename);
+  snapshotField(snap,"errors",errors);
+  snapshotField(snap,"uncodedErrors",uncodedErrors);
+  snapshotField(snap,"totalBits",totalBits);
+  snapshotField(snap,"totalWords",totalWords);
+  snapshotField(snap,"wordErrors",wordErrors);
+  snapshotField(snap,"totalIterations",totalIterations);
+  snapshotField(snap,"error_weight_hist",error_weight_hist);
+  iterhist_struct iters;
+  setupIterationHistogram(iters,num_iterations,1);
+  snapshotField(snap,"iterations",iters.iterations);
+  snapshotField(snap,"phases",iters.phases);
+  snapshotField(snap,"codewordFile",codewordFile);
+  snapshotModules(snap,IS,X,cp,outcomes);
+  snapshotFile(snap,"corpus",corpus.out);
+  cache_struct cache;
+  setupCache(cache,snap,crn,argv[0],logfilename);
+  loadCachedResult(cache,snap);
+  resumeSnapshot(snap);
+  mergeShards(shard,snap,logfilename);
+  sla_struct sla;
+  setupSLA(sla);
+  result_struct res;
+  setupResult(res,argv[0],argv[1],SNR,totalWords);
+  status_struct status;
+  setupStatus(status,argv[0],argv[1],SNR,totalWords);
+  setupConsole();
+  STAGE_TIMER(stages);
+  PERF_COUNTERS(perf,H);
+  while (keepSimulating(stop,totalWords,wordErrors,totalBits,errors) && nextLLRFrame(stream))
     {
       string s;
+      STAGE_FRAME(stages);
+      PERF_FRAME(perf);
+      seedFrame(crn,RNG_STREAM_CHANNEL,totalWords);
+      // Replay a recorded frame, or draw a fresh codeword from the encoder if requested:
+      if (corpus.replay)
+	readCorpusFrame(corpus,globalFrame(crn,totalWords),c,x,-1);
+      else if (randomCodewords)
+	{
+	  encodeRandom(encoder,bits);
+	  for (i=0; i<H.N; i++)
+	    {
+	      c[i] = 1-2*bits[i];
+	      x[i] = c[i];
+	    }
+	}
       // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
+      else if (argc == command_arguments.size()+1)
 	{
 	  getline(codewordFile, s);
 	  if (codewordFile.eof())
@@ -167,10 +275,19 @@ int main(int argc, char * argv[])
 	    else if (s[i] == '0')
 	      c[i] = +1;
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
+	      {
+		drainConsole();
+		cout << "Got an invalid symbol at index " << i << endl;
+	      }
 	    x[i] = c[i];
 	  }
+	  if (reordered)
+	    {
+	      toReordered(order,c);
+	      toReordered(order,x);
+	    }
 	}
+      beginISFrame(IS);
       // Emulate Additive White Gaussian Noise (AWGN) transmission      
       for (i=0; i<H.N; i++)
 	{
@@ -181,7 +298,7 @@ int main(int argc, char * argv[])
 	    y[i] = 1.0 - y[i];
 	  }
 	  */
-	  y[i] = x[i]*(1.0+sigma*rann());
+	  y[i] = stream.enabled ? stream.y[i] : corpus.replay ? corpus.y[i] : x[i]*(1.0+sigma*channelNoise(IS,i));
 	  
 	  //yq[i] = log(pchan)/log(1.0-pchan); // y[i]; //
 	  
@@ -195,60 +312,104 @@ int main(int argc, char * argv[])
 	  if (r[i]*c[i] < 0)
 	    uncodedErrors++;
 	}
+      STAGE_MARK(stages,STAGE_CHANNEL);
+      slaFrameStart(sla);
 
-      initializeSymMessages(H, sym_to_check, yq);
+      if (useQC)
+	initializeQCMessages(Hqc, qc_sym_to_check, yq);
+      else
+	initializeGenericMessages(H, sym_to_check, yq);
+      STAGE_MARK(stages,STAGE_INIT);
 
+      seedFrame(crn,RNG_STREAM_DECODER,totalWords);
 
       // Perform decoding iterations:      
       int it;
 
       
+      beginCheckpointFrame(cp);
       for (it=0; it<num_iterations; it++)
 	{      
+	  STAGE_ITERATION(stages);
+	  if (checkpointDue(cp,it))
+	    recordCheckpoint(cp,countDecisionErrors(d,c),it);
+	  if (useQC)
+	    {
+	      PERF_BEGIN(perf);
+	      qcBPCheckUpdates(Hqc, qc_sym_to_check, qc_check_to_sym);
+	      PERF_END(perf,PERF_PHASE_CHECK);
+	      STAGE_MARK(stages,STAGE_CHECK);
+	      PERF_BEGIN(perf);
+	      qcSymNodeUpdates(Hqc, yq, d, qc_sym_to_check, qc_check_to_sym, MAXLLR);
+	      PERF_END(perf,PERF_PHASE_SYMBOL);
+	      STAGE_MARK(stages,STAGE_SYMBOL);
+	      continue;
+	    }
+
 	  // First update the check nodes:
-	  checkNodeUpdates(H,sym_to_check,check_to_sym);
+	  PERF_BEGIN(perf);
+	  genericBPCheckUpdates(H,sym_to_check,check_to_sym);
+	  PERF_END(perf,PERF_PHASE_CHECK);
+	  STAGE_MARK(stages,STAGE_CHECK);
 	  
 	  // Then perform Symbol node updates:
-	  symNodeUpdates(H, yq, d, sym_to_check, check_to_sym);	  
+	  PERF_BEGIN(perf);
+	  genericSymNodeUpdates(H, yq, d, sym_to_check, check_to_sym, MAXLLR);	  
+	  PERF_END(perf,PERF_PHASE_SYMBOL);
+	  STAGE_MARK(stages,STAGE_SYMBOL);
 	}
       
       // --- End of iteration --------------------------------------
       // -------------------------------------------------------------
 
 
+      slaFrameEnd(sla);
+      writeLLRDecisions(stream,d,-1);
+
       // Count remaining errors after decoding:
       int newErrors = countDecisionErrors(d,c);
+      finishCheckpointFrame(cp,newErrors,it);
 
       if (newErrors > 0)
 	{
 	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  cout << endl;
+	  ostringstream msg;
+	  msg << "Ferr with " << newErrors << " errors.\n";
+	  consoleWrite(msg.str(),CONSOLE_EVENT);
 
 	  // Update statistical information
 	  errors += newErrors;
 	  error_weight_hist[newErrors-1]++;
 	  wordErrors++;
-	  
-	  //	  sendMQTT(errors,wordErrors,totalBits+H.N,totalWords+1);
+	  writeCorpusFrame(corpus,globalFrame(crn,totalWords),newErrors,it,y,c,d,-1);
+
 	}
 
       // Increment frame and bit counters:
+      writeOutcome(outcomes,globalFrame(crn,totalWords),newErrors,it);
+      recordISFrame(IS,newErrors,H.N);
+      recordExtrapolationFrame(X,IS,newErrors);
       totalWords++;
       totalBits += H.N;
       totalIterations += it;
+      recordIterations(iters,it,0);
       
       // ------------------------------------------------
       // Give a status message every 5 frames
       if ((totalWords % 5) == 0)
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
+	  ostringstream msg;
+	  msg << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
 	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
 	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  printHistogram(error_weight_hist,msg);
+	  consoleWrite(msg.str(),CONSOLE_SUMMARY);
 	}
       // ------------------------------------------------
 
+      saveSnapshotIfDue(snap);
+      updateStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+      STAGE_MARK(stages,STAGE_BOOKKEEPING);
     }
   /////////////////////////////////////////////////////////////////
   // ------===== END OF MAIN TEST LOOP =====-------
@@ -256,23 +417,60 @@ int main(int argc, char * argv[])
   
   // ------------------------------------------------
   // REPORT FINAL RESULTS:
+  drainConsole();
   cout << "\nFinal result: " << errors << " bit errs in " 
        << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
        << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
        << (double)uncodedErrors/totalBits << endl;      
+  reportStopping(stop,totalWords,wordErrors,totalBits,errors);
+  closeOutcomeFile(outcomes);
+  closeCorpus(corpus);
+  closeLLRStream(stream);
+  reportIS(IS);
+  reportExtrapolation(X);
+  writeExtrapolationLog(X,logfilename,argv[1]);
+  reportCheckpoints(cp);
+  writeCheckpointLog(cp,logfilename,SNR,argv[1]);
+  reportIterations(iters);
+  STAGE_REPORT(stages,logfilename,SNR,argv[1]);
+  reportSLA(sla,logfilename,SNR,argv[1]);
+  finishStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+  PERF_REPORT(perf,logfilename,SNR,argv[1]);
+
+  if (shard.enabled)
+    {
+      writeShardRecord(shard,snap,logfilename);
+      finishSnapshot(snap);
+      return 0;
+    }
+  storeCachedResult(cache,snap);
 
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << num_iterations << tab;
+  resultParam(res,"R",R);
+  resultParam(res,"num_iterations",num_iterations);
+  resultParam(res,"MAXLLR",MAXLLR);
+  if (isJsonLog(logfilename))
+    writeResultRecord(res,logfilename,snap,stop,IS,sla,errors,totalBits,wordErrors,totalWords,totalIterations);
+  else
+    {
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << num_iterations << tab;
 
-  of << argv[1]
-     << endl;
-  of.close();
+      if (IS.enabled)
+	{
+	  writeISColumns(IS,of);
+	  of << tab;
+	}
+      of << argv[1]
+	 << endl;
+      of.close();
+    }
 
   freeAlist(H);
 
+  finishSnapshot(snap);
   return 0;
 }
 /////////////////////////////////////////////////////////////////
@@ -285,40 +483,12 @@ int main(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
-void  setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check)
-{
-  for (int i=0; i<H.N; i++)
-    {
-      vector<double> initial_msgs(H.num_nlist[i],0.0);
-      sym_to_check.push_back(initial_msgs);
-    }
-}
-
-void setupCheckMessages(alist_struct & H,vector<vector<double> > & check_to_sym)
-{
-  for (int i=0; i<H.M; i++)
-    {
-      vector<double> initial_msgs(H.num_mlist[i],0.0);
-      check_to_sym.push_back(initial_msgs);
-    }
-}
-
-
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<double> & y)
-{
-  int i,j;
-  for (i=0; i<H.N; i++)
-    for (j=0; j<H.num_nlist[i]; j++)
-      sym_to_check[i][j] = y[i];
-}
-
-
-void printHistogram(vector<int> & h)
+void printHistogram(vector<int> & h, ostream & os)
 {
   for (int i=0; i<h.size(); i++)
     {
       if (h[i] > 0)
-	cout << i+1 << ":\t" << h[i] << endl;
+	os << i+1 << ":\t" << h[i] << "\n";
     }
 }
 
@@ -350,65 +520,6 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
-{
-  double msg;
-  double prod;
-  double outmsg;
-  for (int i=0; i<H.M; i++)
-    {
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  prod=1.0;
-	  for (int k=0; k<H.num_mlist[i]; k++)
-	    {
-	      if (j != k)
-		{
-		  int snode = H.mlist[i][k]-1;
-		  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
-		  msg = sym_to_check[snode][midx];
-		  prod *= tanh(msg/2.0);
-		}
-	    }
-	  outmsg = log((1.0+prod)/(1.0-prod));	      
-	  check_to_sym[i][j] = outmsg;	  
-	}
-    }
-}
-
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
-{ 
-  int cnode, midx;
-  double msg, outmsg, sum;
-
-  for (int i=0; i<H.N; i++)
-    {
-      sum = y[i];
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  cnode = H.nlist[i][j]-1;
-	  midx = find(H.mlist[cnode],H.num_mlist[cnode],i);
-	  msg = check_to_sym[cnode][midx];
-	  sum += msg;
-	}      
-      for (int j=0; j<H.num_nlist[i]; j++) 
-	{
-	  cnode = H.nlist[i][j]-1;  
-	  midx = find(H.mlist[cnode],H.num_mlist[cnode],i); 
-	  msg = check_to_sym[cnode][midx]; 
-	  outmsg = sum - msg;
-	  if (abs(outmsg) > MAXLLR)
-	    outmsg = MAXLLR*sgn(outmsg);
-	  sym_to_check[i][j] = outmsg;
-	}
-      if (sum > 0)
-	d[i] = 1;
-      else
-	d[i] = -1;	
-    }
-}
-
-
 double sgn(double x)
 {
   if (x >= 0.0)
@@ -444,20 +555,6 @@ void printVector(vector<double> v)
     }
 }                                           
 
-/*
-void sendMQTT(int bitErrors, int wordErrors, int totalBits, int totalWords) {
-  stringstream ss;
-  ss << "./send_message.sh \'" 
-     << bitErrors << '\t' << wordErrors << '\t'
-     << totalBits << '\t' << totalWords << '\t'
-     << (double)bitErrors/totalBits << '\t'
-     << (double)wordErrors/totalWords << '\'';
-  cout << ss.str() << endl;
-
-  system(ss.str().c_str());
-}
-*/
-
 
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, int fid)
 {
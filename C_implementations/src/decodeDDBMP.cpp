@@ -19,6 +19,26 @@ using namespace std;
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
 #include "rand.h"
+#include "encoder.h"
+#include "options.h"
+#include "reorder.h"
+#include "stopping.h"
+#include "impsample.h"
+#include "extrapolate.h"
+#include "checkpoints.h"
+#include "rng.h"
+#include "outcomes.h"
+#include "snapshot.h"
+#include "shard.h"
+#include "cache.h"
+#include "corpus.h"
+#include "llrstream.h"
+#include "stagetimer.h"
+#include "sla.h"
+#include "results.h"
+#include "iterhist.h"
+#include "status.h"
+#include "console.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -40,7 +60,7 @@ int countDecisionErrors(vector<int> d, vector<int> c);
 double quantize(double x, double Ymax, double Nq);
 
 //============= I/O PREDEFINES ============================//
-void printHistogram(vector<int> & h);
+void printHistogram(vector<int> & h, ostream & os);
 void printVector(vector<int> v);
 void printVector(vector<double> v);
 void printErroneousMessages(vector<vector<int> > v);
@@ -62,15 +82,16 @@ int main(int argc, char * argv[])
   command_arguments.push_back("Ymax");
   command_arguments.push_back("Q");
   command_arguments.push_back("logfilename");
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename | random]");
 
   // Check arguments and print usage statements:
+  parseOptions(argc,argv);
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
       cout << "Usage: " << argv[0];
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
-      cout << "\n";
+      cout << "\n" << optionUsage();
       return 0;
     }
 
@@ -78,6 +99,11 @@ int main(int argc, char * argv[])
   int idx=1;
   alist_struct H = loadFile(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
+  printOptions();
+  reorder_struct order;
+  bool reordered = hasOption("reorder");
+  if (reordered)
+    reorderCode(H,order);
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
   double SNR = atof(argv[idx++]);
@@ -92,7 +118,17 @@ int main(int argc, char * argv[])
   cout << " log = \t" << logfilename << endl;
 
   ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  encoder_struct encoder;
+  vector<int> bits(H.N,0);      // Codeword bits drawn from the built-in encoder
+  bool randomCodewords = false;
+  if ((argc == command_arguments.size()+1) && (string(argv[idx]) == "random"))
+    {
+      cout << "\nUsing random codewords from the built-in encoder.\n";
+      if (setupEncoder(H,encoder))
+	exit(1);
+      randomCodewords = true;
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
       codewordFile.open(argv[idx],ios::in);
@@ -146,11 +182,75 @@ int main(int argc, char * argv[])
   /////////////////////////////////////////////////////////////////
   ran_seed(time(0)); //(134159);
   int i,j;
-   while ((errors < 200) || (wordErrors < 40))
+   is_struct IS;
+   setupImportanceSampling(IS,H.N);
+   if (reordered)
+     toReordered(order,IS.biased);
+   extrap_struct X;
+   setupExtrapolation(X,SNR,R,H.N);
+   crn_struct crn;
+   setupCommonRandomNumbers(crn);
+   outcome_struct outcomes;
+   openOutcomeFile(outcomes);
+   checkpoint_struct cp;
+   setupCheckpoints(cp,num_iterations,H.N);
+   stopping_struct stop;
+   setupStopping(stop,IS,200,40,0);
+   corpus_struct corpus;
+   setupCorpus(corpus,H.N,SNR,R,stop,reordered ? &order : NULL,argc,argv);
+   llrstream_struct stream;
+   setupLLRStream(stream,H.N,sigma,stop,reordered ? &order : NULL);
+   shard_struct shard;
+   setupShard(shard,crn,stop);
+   snapshot_struct snap;
+   setupSnapshot(snap,crn,argc,argv);
+   keyDecoderStream(crn,argv[0],snap.params,logfilename);
+   snapshotField(snap,"errors",errors);
+   snapshotField(snap,"uncodedErrors",uncodedErrors);
+   snapshotField(snap,"totalBits",totalBits);
+   snapshotField(snap,"totalWords",totalWords);
+   snapshotField(snap,"wordErrors",wordErrors);
+   snapshotField(snap,"totalIterations",totalIterations);
+   snapshotField(snap,"error_weight_hist",error_weight_hist);
+   iterhist_struct iters;
+   setupIterationHistogram(iters,num_iterations,1);
+   snapshotField(snap,"iterations",iters.iterations);
+   snapshotField(snap,"phases",iters.phases);
+   snapshotField(snap,"codewordFile",codewordFile);
+   snapshotModules(snap,IS,X,cp,outcomes);
+   snapshotFile(snap,"corpus",corpus.out);
+   cache_struct cache;
+   setupCache(cache,snap,crn,argv[0],logfilename);
+   loadCachedResult(cache,snap);
+   resumeSnapshot(snap);
+   mergeShards(shard,snap,logfilename);
+   sla_struct sla;
+   setupSLA(sla);
+   result_struct res;
+   setupResult(res,argv[0],argv[1],SNR,totalWords);
+   status_struct status;
+   setupStatus(status,argv[0],argv[1],SNR,totalWords);
+   setupConsole();
+   STAGE_TIMER(stages);
+   while (keepSimulating(stop,totalWords,wordErrors,totalBits,errors) && nextLLRFrame(stream))
     {
       string s;
+      STAGE_FRAME(stages);
+      seedFrame(crn,RNG_STREAM_CHANNEL,totalWords);
+      // Replay a recorded frame, or draw a fresh codeword from the encoder if requested:
+      if (corpus.replay)
+	readCorpusFrame(corpus,globalFrame(crn,totalWords),c,x,-1);
+      else if (randomCodewords)
+	{
+	  encodeRandom(encoder,bits);
+	  for (i=0; i<H.N; i++)
+	    {
+	      c[i] = 1-2*bits[i];
+	      x[i] = c[i];
+	    }
+	}
       // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
+      else if (argc == command_arguments.size()+1)
 	{
 	  getline(codewordFile, s);
 	  if (codewordFile.eof())
@@ -166,14 +266,23 @@ int main(int argc, char * argv[])
 	    else if (s[i] == '0')
 	      c[i] = +1;
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
+	      {
+		drainConsole();
+		cout << "Got an invalid symbol at index " << i << endl;
+	      }
 	    x[i] = c[i];
 	  }
+	  if (reordered)
+	    {
+	      toReordered(order,c);
+	      toReordered(order,x);
+	    }
 	}
+      beginISFrame(IS);
       // Emulate AWGN transmission      
       for (i=0; i<H.N; i++)
 	{
-	  y[i] = x[i]*(1.0+sigma*rann());
+	  y[i] = stream.enabled ? stream.y[i] : corpus.replay ? corpus.y[i] : x[i]*(1.0+sigma*channelNoise(IS,i));
 	  yq[i] = quantize(y[i],Ymax,Nq);
 	  if (yq[i] > 0)
 	    r[i] = 1;
@@ -183,24 +292,36 @@ int main(int argc, char * argv[])
 	  if (r[i]*c[i] < 0)
 	    uncodedErrors++;
 	}
+      STAGE_MARK(stages,STAGE_CHANNEL);
+      slaFrameStart(sla);
 
       initializeSymMessages(H, sym_to_check, sym_memories, yq);
+      STAGE_MARK(stages,STAGE_INIT);
 
+      seedFrame(crn,RNG_STREAM_DECODER,totalWords);
 
       // Perform decoding iterations:      
       int it;
 
       
+      beginCheckpointFrame(cp);
       for (it=0; it<num_iterations; it++)
 	{      
+	  STAGE_ITERATION(stages);
+	  if (checkpointDue(cp,it))
+	    recordCheckpoint(cp,countDecisionErrors(d,c),it);
 	  // First update the check nodes:
 	  checkNodeUpdates(H,sym_to_check,check_to_sym);
+	  STAGE_MARK(stages,STAGE_CHECK);
 	  
 	  // Then perform Symbol node updates:
 	  symNodeUpdates(H, yq, d, sym_to_check, check_to_sym, sym_memories);	  
+	  STAGE_MARK(stages,STAGE_SYMBOL);
 
 	  // Check stopping condition:
-	  if (checkStoppingCondition(H,d))
+	  bool stopped = checkStoppingCondition(H,d);
+	  STAGE_MARK(stages,STAGE_SYNDROME);
+	  if (stopped)
 	    break;
 	}
       
@@ -208,38 +329,53 @@ int main(int argc, char * argv[])
       // -------------------------------------------------------------
 
 
+      slaFrameEnd(sla);
+      writeLLRDecisions(stream,d,-1);
+
       // Count remaining errors after decoding:
       int newErrors = countDecisionErrors(d,c);
+      finishCheckpointFrame(cp,newErrors,it);
 
       if (newErrors > 0)
 	{
 	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  cout << endl;
+	  ostringstream msg;
+	  msg << "Ferr with " << newErrors << " errors.\n";
+	  consoleWrite(msg.str(),CONSOLE_EVENT);
 
 	  // Update statistical information
 	  errors += newErrors;
 	  error_weight_hist[newErrors-1]++;
 	  wordErrors++;
+	  writeCorpusFrame(corpus,globalFrame(crn,totalWords),newErrors,it,y,c,d,-1);
 	  
 	}
 
       // Increment frame and bit counters:
+      writeOutcome(outcomes,globalFrame(crn,totalWords),newErrors,it);
+      recordISFrame(IS,newErrors,H.N);
+      recordExtrapolationFrame(X,IS,newErrors);
       totalWords++;
       totalBits += H.N;
       totalIterations += it;
+      recordIterations(iters,it,0);
       
       // ------------------------------------------------
       // Give a status message every 100 frames
       if ((totalWords % 5) == 0)
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
+	  ostringstream msg;
+	  msg << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
 	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
 	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  printHistogram(error_weight_hist,msg);
+	  consoleWrite(msg.str(),CONSOLE_SUMMARY);
 	}
       // ------------------------------------------------
 
+      saveSnapshotIfDue(snap);
+      updateStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+      STAGE_MARK(stages,STAGE_BOOKKEEPING);
     }
   /////////////////////////////////////////////////////////////////
   // ------===== END OF MAIN TEST LOOP =====-------
@@ -247,25 +383,62 @@ int main(int argc, char * argv[])
   
   // ------------------------------------------------
   // REPORT FINAL RESULTS:
+  drainConsole();
   cout << "\nFinal result: " << errors << " bit errs in " 
        << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
        << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
        << (double)uncodedErrors/totalBits << endl;      
-
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << num_iterations << tab
-     << Ymax << tab 
-     << Q << tab;
-
-  of << argv[1]
-     << endl;
-  of.close();
+  reportStopping(stop,totalWords,wordErrors,totalBits,errors);
+  closeOutcomeFile(outcomes);
+  closeCorpus(corpus);
+  closeLLRStream(stream);
+  reportIS(IS);
+  reportExtrapolation(X);
+  writeExtrapolationLog(X,logfilename,argv[1]);
+  reportCheckpoints(cp);
+  writeCheckpointLog(cp,logfilename,SNR,argv[1]);
+  reportIterations(iters);
+  STAGE_REPORT(stages,logfilename,SNR,argv[1]);
+  reportSLA(sla,logfilename,SNR,argv[1]);
+  finishStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+
+  if (shard.enabled)
+    {
+      writeShardRecord(shard,snap,logfilename);
+      finishSnapshot(snap);
+      return 0;
+    }
+  storeCachedResult(cache,snap);
+
+  resultParam(res,"R",R);
+  resultParam(res,"num_iterations",num_iterations);
+  resultParam(res,"Ymax",Ymax);
+  resultParam(res,"Q",Q);
+  if (isJsonLog(logfilename))
+    writeResultRecord(res,logfilename,snap,stop,IS,sla,errors,totalBits,wordErrors,totalWords,totalIterations);
+  else
+    {
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << num_iterations << tab
+	 << Ymax << tab 
+	 << Q << tab;
+
+      if (IS.enabled)
+	{
+	  writeISColumns(IS,of);
+	  of << tab;
+	}
+      of << argv[1]
+	 << endl;
+      of.close();
+    }
 
   freeAlist(H);
 
+  finishSnapshot(snap);
   return 0;
 }
 /////////////////////////////////////////////////////////////////
@@ -310,12 +483,12 @@ void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_c
 }
 
 
-void printHistogram(vector<int> & h)
+void printHistogram(vector<int> & h, ostream & os)
 {
   for (int i=0; i<h.size(); i++)
     {
       if (h[i] > 0)
-	cout << i+1 << ":\t" << h[i] << endl;
+	os << i+1 << ":\t" << h[i] << "\n";
     }
 }
 
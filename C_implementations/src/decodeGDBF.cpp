@@ -41,6 +41,28 @@ using namespace std;
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
 #include "rand.h"
+#include "encoder.h"
+#include "options.h"
+#include "reorder.h"
+#include "stopping.h"
+#include "impsample.h"
+#include "extrapolate.h"
+#include "checkpoints.h"
+#include "rng.h"
+#include "outcomes.h"
+#include "snapshot.h"
+#include "shard.h"
+#include "cache.h"
+#include "corpus.h"
+#include "llrstream.h"
+#include "stagetimer.h"
+#include "sla.h"
+#include "results.h"
+#include "iterhist.h"
+#include "status.h"
+#include "console.h"
+#include "qc.h"
+#include "generic.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -56,8 +78,7 @@ double noiseScale = 1.0;
 int    NQ         = 16;
 
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
-void symNodeUpdates(alist_struct &H, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
+void symNodeUpdates(alist_struct &H, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation, bool useQC, vector<int> & unsat);
 double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
@@ -71,7 +92,7 @@ double quantize(double x);
 double sgn(double y);
 
 //============= I/O PREDEFINES ============================//
-void printHistogram(vector<int> & h);
+void printHistogram(vector<int> & h, ostream & os);
 void printVector(vector<int> v);
 void printVector(vector<double> v);
 void printErroneousMessages(vector<vector<int> > v);
@@ -110,15 +131,16 @@ int main(int argc, char * argv[])
   #ifdef saturateSamples
   command_arguments.push_back("Ymax");
   #endif
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename | random]");
 
   // Check arguments and print usage statements:
+  parseOptions(argc,argv);
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
       cout << "Usage: " << argv[0];
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
-      cout << "\n";
+      cout << "\n" << optionUsage();
       return 0;
     }
 
@@ -126,6 +148,11 @@ int main(int argc, char * argv[])
   int idx=1;
   alist_struct H = loadFile(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
+  printOptions();
+  reorder_struct order;
+  bool reordered = hasOption("reorder");
+  if (reordered)
+    reorderCode(H,order);
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
   double SNR = atof(argv[idx++]);
@@ -163,7 +190,17 @@ int main(int argc, char * argv[])
   #endif
 
   ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  encoder_struct encoder;
+  vector<int> bits(H.N,0);      // Codeword bits drawn from the built-in encoder
+  bool randomCodewords = false;
+  if ((argc == command_arguments.size()+1) && (string(argv[idx]) == "random"))
+    {
+      cout << "\nUsing random codewords from the built-in encoder.\n";
+      if (setupEncoder(H,encoder))
+	exit(1);
+      randomCodewords = true;
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
       codewordFile.open(argv[idx],ios::in);
@@ -179,6 +216,12 @@ int main(int argc, char * argv[])
   int dv = H.biggest_num_n;
   int dc = H.biggest_num_m;
 
+  // Quasi-cyclic codes use the bit-vector syndrome kernels:
+  qc_struct Hqc;
+  bool useQC = !reordered && detectQC(H,Hqc);
+  if (useQC)
+    cout << "Quasi-cyclic structure detected: Z=" << Hqc.Z << ", " << Hqc.mb << "x" << Hqc.nb << " base matrix.\n";
+
   // Report initial status messages:
   cout << "Simulating GDBF decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
   cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
@@ -214,6 +257,9 @@ int main(int argc, char * argv[])
 
   // Declare and initialize message memories:
   vector<int> check_to_sym(H.M,0);
+  vector<qcword> qc_decisions;   // Packed decisions, one Z-bit vector per block column
+  vector<qcword> qc_syndromes;   // Packed syndromes, one Z-bit vector per block row
+  vector<int>    unsat(H.N,0);   // Unsatisfied checks adjacent to each symbol (QC only)
 
   /////////////////////////////////////////////////////////////////
   // ------===== MAIN TEST LOOP =====-------
@@ -223,11 +269,81 @@ int main(int argc, char * argv[])
   if (H.N > 50000) minWordErrors = 5;
   ran_seed(time(0)); //(134159);
   int i,j;
-   while ((errors < 200) || (wordErrors < minWordErrors))
+   is_struct IS;
+   setupImportanceSampling(IS,H.N);
+   if (reordered)
+     toReordered(order,IS.biased);
+   extrap_struct X;
+   setupExtrapolation(X,SNR,R,H.N);
+   crn_struct crn;
+   setupCommonRandomNumbers(crn);
+   outcome_struct outcomes;
+   openOutcomeFile(outcomes);
+   checkpoint_struct cp;
+   setupCheckpoints(cp,num_iterations,H.N);
+   stopping_struct stop;
+   setupStopping(stop,IS,200,minWordErrors,0);
+   corpus_struct corpus;
+   setupCorpus(corpus,H.N,SNR,R,stop,reordered ? &order : NULL,argc,argv);
+   llrstream_struct stream;
+   setupLLRStream(stream,H.N,sigma,stop,reordered ? &order : NULL);
+   shard_struct shard;
+   setupShard(shard,crn,stop);
+   snapshot_struct snap;
+   setupSnapshot(snap,crn,argc,argv);
+   keyDecoderStream(crn,argv[0],snap.params,logfilename);
+   snapshotField(snap,"errors",errors);
+   snapshotField(snap,"uncodedErrors",uncodedErrors);
+   snapshotField(snap,"totalBits",totalBits);
+   snapshotField(snap,"totalWords",totalWords);
+   snapshotField(snap,"wordErrors",wordErrors);
+   snapshotField(snap,"totalIterations",totalIterations);
+   snapshotField(snap,"error_weight_hist",error_weight_hist);
+   iterhist_struct iters;
+   setupIterationHistogram(iters,num_iterations,1);
+   snapshotField(snap,"iterations",iters.iterations);
+   snapshotField(snap,"phases",iters.phases);
+   snapshotField(snap,"codewordFile",codewordFile);
+  #ifdef outputSmoothing
+   snapshotField(snap,"smoothingUsed",smoothingUsed);
+   // Each checkpoint keeps the smoothing window a run with that T would use:
+   vector<vector<int> > cpsum(cp.T.size(),vector<int>(H.N,0));
+   vector<int> dcp(H.N,0);
+  #endif
+   snapshotModules(snap,IS,X,cp,outcomes);
+   snapshotFile(snap,"corpus",corpus.out);
+   cache_struct cache;
+   setupCache(cache,snap,crn,argv[0],logfilename);
+   loadCachedResult(cache,snap);
+   resumeSnapshot(snap);
+   mergeShards(shard,snap,logfilename);
+   sla_struct sla;
+   setupSLA(sla);
+   result_struct res;
+   setupResult(res,argv[0],argv[1],SNR,totalWords);
+   status_struct status;
+   setupStatus(status,argv[0],argv[1],SNR,totalWords);
+   setupConsole();
+   STAGE_TIMER(stages);
+   while (keepSimulating(stop,totalWords,wordErrors,totalBits,errors) && nextLLRFrame(stream))
     {
       string s;
+      STAGE_FRAME(stages);
+      seedFrame(crn,RNG_STREAM_CHANNEL,totalWords);
+      // Replay a recorded frame, or draw a fresh codeword from the encoder if requested:
+      if (corpus.replay)
+	readCorpusFrame(corpus,globalFrame(crn,totalWords),c,x,-1);
+      else if (randomCodewords)
+	{
+	  encodeRandom(encoder,bits);
+	  for (i=0; i<H.N; i++)
+	    {
+	      c[i] = 1-2*bits[i];
+	      x[i] = c[i];
+	    }
+	}
       // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
+      else if (argc == command_arguments.size()+1)
 	{
 	  getline(codewordFile, s);
 	  if (codewordFile.eof())
@@ -243,14 +359,23 @@ int main(int argc, char * argv[])
 	    else if (s[i] == '0')
 	      c[i] = +1;
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
+	      {
+		drainConsole();
+		cout << "Got an invalid symbol at index " << i << endl;
+	      }
 	    x[i] = c[i];
 	  }
+	  if (reordered)
+	    {
+	      toReordered(order,c);
+	      toReordered(order,x);
+	    }
 	}
+      beginISFrame(IS);
       // Emulate AWGN transmission      
       for (i=0; i<H.N; i++)
 	{
-	  y[i] = x[i]*(1.0+sigma*rann());
+	  y[i] = stream.enabled ? stream.y[i] : corpus.replay ? corpus.y[i] : x[i]*(1.0+sigma*channelNoise(IS,i));
 	  yq[i] = y[i];
 	  #ifdef saturateSamples
 	  if (abs(yq[i])>Ymax)
@@ -272,6 +397,14 @@ int main(int argc, char * argv[])
 	  dsum[i] = 0;
 	  #endif
 	}
+      #ifdef outputSmoothing
+      for (int k=0; k<cpsum.size(); k++)
+	cpsum[k].assign(H.N,0);
+      #endif
+      STAGE_MARK(stages,STAGE_CHANNEL);
+      slaFrameStart(sla);
+
+      seedFrame(crn,RNG_STREAM_DECODER,totalWords);
 
       // Perform decoding iterations:      
       bool satisfied;
@@ -295,13 +428,40 @@ int main(int argc, char * argv[])
 
       double noiseSigma = sigma*noiseScale;
       
+      beginCheckpointFrame(cp);
       for (it=0; it<num_iterations; it++)
 	{      
+	  STAGE_ITERATION(stages);
+	  if (checkpointDue(cp,it))
+	    {
+	      #ifdef outputSmoothing
+	      for (int i=0; i<H.N; i++)
+		dcp[i] = (cpsum[cp.next][i] > 0) ? 1 : -1;
+	      recordCheckpoint(cp,countDecisionErrors(dcp,c),it);
+	      #else
+	      recordCheckpoint(cp,countDecisionErrors(d,c),it);
+	      #endif
+	    }
 	  satisfied = true;
 	  
 	  
 	  // First update the check nodes:
-	  checkNodeUpdates(H,d,check_to_sym,satisfied);
+	  if (useQC)
+	    {
+	      packQCSymbols(Hqc,d,-1,qc_decisions);
+	      satisfied = qcSyndrome(Hqc,qc_decisions,qc_syndromes);
+	      if (satisfied)
+		break;
+	      qcUnsatisfiedCounts(Hqc,qc_syndromes,unsat);
+	      #ifdef modeswitching
+	      unpackQCChecks(Hqc,qc_syndromes,check_to_sym);
+	      for (int i=0; i<H.M; i++)
+		check_to_sym[i] = 1-2*check_to_sym[i];
+	      #endif
+	    }
+	  else
+	    satisfied = genericSyndrome(H,d,check_to_sym);
+	  STAGE_MARK(stages,STAGE_SYNDROME);
 	  if (satisfied)
 	    break;
 
@@ -330,10 +490,12 @@ int main(int argc, char * argv[])
 	      perturbation[i] = newSample;
 	      #endif
 	    }
+	  STAGE_MARK(stages,STAGE_PERTURB);
 	  #endif
 	  
 
-	  symNodeUpdates(H,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
+	  symNodeUpdates(H,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation, useQC, unsat); 
+	  STAGE_MARK(stages,STAGE_SYMBOL);
 	  
 	  #ifdef modeswitching
 	  if (it > Tswitch)
@@ -351,6 +513,10 @@ int main(int argc, char * argv[])
 	      for (int i=0; i<H.N; i++)
 		dsum[i] += d[i];
 	    }
+	  for (int k=cp.next; k+1<cpsum.size(); k++)
+	    if (it > cp.T[k]-windowsize)
+	      for (int i=0; i<H.N; i++)
+		cpsum[k][i] += d[i];
 	  #endif
 	  
 	}
@@ -374,42 +540,54 @@ int main(int argc, char * argv[])
 	smoothingUsed++;
       #endif
 
+      slaFrameEnd(sla);
+      writeLLRDecisions(stream,d,-1);
+
       // Count remaining errors after decoding:
       int newErrors = countDecisionErrors(d,c);
+      finishCheckpointFrame(cp,newErrors,it);
 
       if (newErrors > 0)
 	{
 	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  if (satisfied)
-	    cout << " All checks satisfied.\n";
-	  else
-	    cout << endl;
+	  ostringstream msg;
+	  msg << "Ferr with " << newErrors << " errors." << (satisfied ? " All checks satisfied.\n" : "\n");
+	  consoleWrite(msg.str(),CONSOLE_EVENT);
 
 	  // Update statistical information
 	  errors += newErrors;
 	  error_weight_hist[newErrors-1]++;
 	  wordErrors++;
+	  writeCorpusFrame(corpus,globalFrame(crn,totalWords),newErrors,it,y,c,d,-1);
 	  
 	}
 
       // Increment frame and bit counters:
+      writeOutcome(outcomes,globalFrame(crn,totalWords),newErrors,it);
+      recordISFrame(IS,newErrors,H.N);
+      recordExtrapolationFrame(X,IS,newErrors);
       totalWords++;
       totalBits += H.N;
       totalIterations += it;
+      recordIterations(iters,it,0);
       
       // ------------------------------------------------
       // Give a status message every 100 frames
       int reportInterval = round(100e3/H.N);
       if ((totalWords % reportInterval) == 0)
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
+	  ostringstream msg;
+	  msg << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
 	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
 	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  printHistogram(error_weight_hist,msg);
+	  consoleWrite(msg.str(),CONSOLE_SUMMARY);
 	}
       // ------------------------------------------------
 
+      saveSnapshotIfDue(snap);
+      updateStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+      STAGE_MARK(stages,STAGE_BOOKKEEPING);
     }
   /////////////////////////////////////////////////////////////////
   // ------===== END OF MAIN TEST LOOP =====-------
@@ -417,39 +595,93 @@ int main(int argc, char * argv[])
   
   // ------------------------------------------------
   // REPORT FINAL RESULTS:
+  drainConsole();
   cout << "\nFinal result: " << errors << " bit errs in " 
        << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
        << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
        << (double)uncodedErrors/totalBits << endl;      
+  reportStopping(stop,totalWords,wordErrors,totalBits,errors);
+  closeOutcomeFile(outcomes);
+  closeCorpus(corpus);
+  closeLLRStream(stream);
+  reportIS(IS);
+  reportExtrapolation(X);
+  writeExtrapolationLog(X,logfilename,argv[1]);
+  reportCheckpoints(cp);
+  writeCheckpointLog(cp,logfilename,SNR,argv[1]);
+  reportIterations(iters);
+  STAGE_REPORT(stages,logfilename,SNR,argv[1]);
+  reportSLA(sla,logfilename,SNR,argv[1]);
+  finishStatus(status,stop,totalWords,wordErrors,totalBits,errors);
+
+  if (shard.enabled)
+    {
+      writeShardRecord(shard,snap,logfilename);
+      finishSnapshot(snap);
+      return 0;
+    }
+  storeCachedResult(cache,snap);
 
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << totalBits << tab << totalWords << tab
-     << num_iterations << tab << theta << tab;
+  resultParam(res,"R",R);
+  resultParam(res,"num_iterations",num_iterations);
+  resultParam(res,"theta",theta);
 #if defined(addNoise) || defined(quantizeProbabilities)
-  of << noiseScale << tab; 
+  resultParam(res,"noiseScale",noiseScale);
   #endif
 #ifdef quantizeSamples
-  of << NQ << tab;
+  resultParam(res,"NQ",NQ);
 #endif
   #ifdef thresholdAdaptation
-  of << lambda << tab; 
+  resultParam(res,"lambda",lambda);
   #endif
   #ifdef weightSyndromes
-  of << alpha << tab;
+  resultParam(res,"alpha",alpha);
   #endif
   #ifdef outputSmoothing
-  of << smoothingUsed << tab << (double) smoothingUsed/totalWords << tab;
-  of << windowsize << tab; 
+  resultParam(res,"windowsize",windowsize);
   #endif
   #ifdef saturateSamples
-  of << Ymax << tab;
+  resultParam(res,"Ymax",Ymax);
   #endif
+  if (isJsonLog(logfilename))
+    writeResultRecord(res,logfilename,snap,stop,IS,sla,errors,totalBits,wordErrors,totalWords,totalIterations);
+  else
+    {
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << totalBits << tab << totalWords << tab
+	 << num_iterations << tab << theta << tab;
+#if defined(addNoise) || defined(quantizeProbabilities)
+      of << noiseScale << tab; 
+      #endif
+#ifdef quantizeSamples
+      of << NQ << tab;
+#endif
+      #ifdef thresholdAdaptation
+      of << lambda << tab; 
+      #endif
+      #ifdef weightSyndromes
+      of << alpha << tab;
+      #endif
+      #ifdef outputSmoothing
+      of << smoothingUsed << tab << (double) smoothingUsed/totalWords << tab;
+      of << windowsize << tab; 
+      #endif
+      #ifdef saturateSamples
+      of << Ymax << tab;
+      #endif
 
-  of << argv[1]
-     << endl;
+      if (IS.enabled)
+	{
+	  writeISColumns(IS,of);
+	  of << tab;
+	}
+      of << argv[1]
+	 << endl;
+    }
+  finishSnapshot(snap);
   return 0;
 }
 /////////////////////////////////////////////////////////////////
@@ -462,12 +694,12 @@ int main(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
-void printHistogram(vector<int> & h)
+void printHistogram(vector<int> & h, ostream & os)
 {
   for (int i=0; i<h.size(); i++)
     {
       if (h[i] > 0)
-	cout << i+1 << ":\t" << h[i] << endl;
+	os << i+1 << ":\t" << h[i] << "\n";
     }
 }
 
@@ -514,26 +746,7 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
-{
-  int msg;
-  satisfied = true;
-  for (int i=0; i<H.M; i++)
-    {
-      int prod = 1;
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = sym_to_check[snode];
-	  prod *= msg;
-	}
-      if (prod < 0)
-	satisfied = false;
-      check_to_sym[i] = prod;	
-    }
-}
-
-void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
+void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation, bool useQC, vector<int> & unsat)
 {
   vector<double> E(H.N,0.0);
   double Emin = INFINITY;
@@ -550,12 +763,15 @@ void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, i
       w = alpha;//*Ymax/dv;
       #endif
 
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = check_to_sym[cnode];
-	  E[i] += w*msg;	  
-	}      
+      if (useQC)
+	E[i] += w*(H.num_nlist[i] - 2*unsat[i]);
+      else
+	for (int j=0; j<H.num_nlist[i]; j++)
+	  {
+	    int cnode = H.nlist[i][j]-1;
+	    int msg = check_to_sym[cnode];
+	    E[i] += w*msg;	  
+	  }      
       #ifdef addNoise
       E[i] += perturbation[i]; //sigma*rann();
       #endif
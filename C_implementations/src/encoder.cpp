@@ -0,0 +1,386 @@
+/*==========================================================================================
+** encoder.cpp
+** By Chris Winstead
+
+** Description:
+   Systematic encoder built from the parity-check matrix. See
+   encoder.h for an overview of the sparse and dense paths.
+==============================================================================================*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "encoder.h"
+#include "rand.h"
+using namespace std;
+
+int setupSparseEncoder(alist_struct & H, encoder_struct & E);
+int setupDenseEncoder(alist_struct & H, encoder_struct & E);
+int setupGapSolver(alist_struct & H, encoder_struct & E);
+
+
+int setupEncoder(alist_struct & H, encoder_struct & E)
+{
+  E.N = H.N;
+  E.M = H.M;
+  E.gap = 0;
+  E.rows.assign(H.M, vector<int>(0));
+  for (int i=0; i<H.M; i++)
+    for (int j=0; j<H.num_mlist[i]; j++)
+      E.rows[i].push_back(H.mlist[i][j]-1);
+
+  if (setupSparseEncoder(H,E))
+    {
+      cout << "Encoder: parity resolved by back-substitution, K=" << E.K;
+      if (E.gap > 0)
+	cout << ", " << E.gap << " pivot bits";
+      cout << endl;
+    }
+  else
+    {
+      setupDenseEncoder(H,E);
+      cout << "Encoder: dense GF(2) elimination, rank=" << E.rank << ", K=" << E.K << endl;
+    }
+
+  // Sanity check on one random codeword:
+  vector<int> bits(E.N,0);
+  encodeRandom(E,bits);
+  int unsat = checkCodeword(H,bits);
+  if (unsat > 0)
+    {
+      cout << "Encoder: self-test failed with " << unsat << " unsatisfied checks.\n";
+      return 1;
+    }
+  return 0;
+}
+
+
+// Attempt to resolve the last M positions one at a time, always
+// using a row with exactly one unresolved parity position. This
+// succeeds for staircase and other triangular parity structures.
+// When it stalls (as on the 802.11n dual diagonal, whose first
+// parity column has weight three), the lowest unresolved parity
+// column becomes a pivot bit that is treated as known, and the
+// rows left unused at the end determine the pivot bits.
+int setupSparseEncoder(alist_struct & H, encoder_struct & E)
+{
+  int firstParity = H.N - H.M;
+  if (firstParity < 0)
+    return 0;
+
+  vector<int> unknowns(H.M,0);
+  vector<char> resolved(H.N,0);
+  vector<char> used(H.M,0);
+  for (int i=0; i<H.M; i++)
+    for (int j=0; j<H.num_mlist[i]; j++)
+      if (H.mlist[i][j]-1 >= firstParity)
+	unknowns[i]++;
+
+  vector<int> queue;
+  for (int i=0; i<H.M; i++)
+    if (unknowns[i] == 1)
+      queue.push_back(i);
+
+  E.parity_cols.clear();
+  E.sched_row.clear();
+  E.gap_cols.clear();
+  int nextPivot = firstParity;
+  int q = 0;
+  while (E.parity_cols.size() + E.gap_cols.size() < H.M)
+    {
+      int col = -1;
+      if (q < queue.size())
+	{
+	  int row = queue[q++];
+	  if ((unknowns[row] != 1) || used[row])
+	    continue;
+	  for (int j=0; j<E.rows[row].size(); j++)
+	    if ((E.rows[row][j] >= firstParity) && !resolved[E.rows[row][j]])
+	      col = E.rows[row][j];
+	  used[row] = 1;
+	  E.parity_cols.push_back(col);
+	  E.sched_row.push_back(row);
+	}
+      else
+	{
+	  while (resolved[nextPivot])
+	    nextPivot++;
+	  col = nextPivot;
+	  E.gap_cols.push_back(col);
+	  if (8*E.gap_cols.size() > H.M)
+	    return 0;     // no cheaper than the dense path
+	}
+      resolved[col] = 1;
+      for (int j=0; j<H.num_nlist[col]; j++)
+	{
+	  int cnode = H.nlist[col][j]-1;
+	  unknowns[cnode]--;
+	  if (unknowns[cnode] == 1)
+	    queue.push_back(cnode);
+	}
+    }
+
+  E.gap = E.gap_cols.size();
+  E.check_rows.clear();
+  for (int i=0; i<H.M; i++)
+    if (!used[i])
+      E.check_rows.push_back(i);
+  if (E.gap > 0 && !setupGapSolver(H,E))
+    return 0;
+
+  E.sparse = 1;
+  E.rank = H.M;
+  E.K = H.N - H.M;
+  E.info_cols.clear();
+  for (int i=0; i<firstParity; i++)
+    E.info_cols.push_back(i);
+  return 1;
+}
+
+
+// Resolve the scheduled parity bits from the bits already set.
+static void resolveParity(encoder_struct & E, vector<int> & bits)
+{
+  for (int i=0; i<E.parity_cols.size(); i++)
+    {
+      int col = E.parity_cols[i];
+      vector<int> & row = E.rows[E.sched_row[i]];
+      int v = 0;
+      for (int j=0; j<row.size(); j++)
+	if (row[j] != col)
+	  v ^= bits[row[j]];
+      bits[col] = v;
+    }
+}
+
+
+// For each pivot bit, record which scheduled parity bits and which
+// unused rows it flips, then invert the gap x gap matrix of unused
+// row checks so that encodeBits can solve for the pivot bits.
+int setupGapSolver(alist_struct & H, encoder_struct & E)
+{
+  int g = E.gap;
+  int P = E.parity_cols.size();
+  E.gapWords = (g + ENCWORD_BITS - 1)/ENCWORD_BITS;
+  E.parityWords = (P + ENCWORD_BITS - 1)/ENCWORD_BITS;
+  E.gapEffect.assign(g*E.parityWords,0);
+
+  // A holds one row per unused check, one column per pivot bit,
+  // followed by the identity that becomes the inverse:
+  int Aw = 2*E.gapWords;
+  vector<encword> A(g*Aw,0);
+  vector<int> bits(H.N,0);
+  for (int s=0; s<g; s++)
+    {
+      bits.assign(H.N,0);
+      bits[E.gap_cols[s]] = 1;
+      resolveParity(E,bits);
+      for (int i=0; i<P; i++)
+	if (bits[E.parity_cols[i]])
+	  E.gapEffect[s*E.parityWords + i/ENCWORD_BITS] |= ((encword) 1) << (i % ENCWORD_BITS);
+      for (int r=0; r<g; r++)
+	{
+	  int p = 0;
+	  vector<int> & row = E.rows[E.check_rows[r]];
+	  for (int j=0; j<row.size(); j++)
+	    p ^= bits[row[j]];
+	  if (p)
+	    A[r*Aw + s/ENCWORD_BITS] |= ((encword) 1) << (s % ENCWORD_BITS);
+	}
+    }
+  for (int r=0; r<g; r++)
+    A[r*Aw + E.gapWords + r/ENCWORD_BITS] |= ((encword) 1) << (r % ENCWORD_BITS);
+
+  for (int c=0; c<g; c++)
+    {
+      int w = c/ENCWORD_BITS;
+      encword mask = ((encword) 1) << (c % ENCWORD_BITS);
+      int prow = -1;
+      for (int r=c; r<g; r++)
+	if (A[r*Aw + w] & mask)
+	  {
+	    prow = r;
+	    break;
+	  }
+      if (prow < 0)
+	return 0;      // parity part of H is singular
+      if (prow != c)
+	for (int k=0; k<Aw; k++)
+	  {
+	    encword tmp = A[c*Aw + k];
+	    A[c*Aw + k] = A[prow*Aw + k];
+	    A[prow*Aw + k] = tmp;
+	  }
+      for (int r=0; r<g; r++)
+	if ((r != c) && (A[r*Aw + w] & mask))
+	  for (int k=0; k<Aw; k++)
+	    A[r*Aw + k] ^= A[c*Aw + k];
+    }
+
+  E.gapSolve.assign(g*E.gapWords,0);
+  for (int c=0; c<g; c++)
+    for (int k=0; k<E.gapWords; k++)
+      E.gapSolve[c*E.gapWords + k] = A[c*Aw + E.gapWords + k];
+  return 1;
+}
+
+
+// Reduce bit-packed rows of H to reduced row-echelon form. Pivots
+// are searched from the last column backward so that parity bits
+// land at the end of the codeword whenever possible.
+int setupDenseEncoder(alist_struct & H, encoder_struct & E)
+{
+  int Wn = (H.N + ENCWORD_BITS - 1)/ENCWORD_BITS;
+  vector<encword> rows(H.M*Wn,0);
+  for (int i=0; i<H.M; i++)
+    for (int j=0; j<H.num_mlist[i]; j++)
+      {
+	int col = H.mlist[i][j]-1;
+	rows[i*Wn + col/ENCWORD_BITS] ^= ((encword) 1) << (col % ENCWORD_BITS);
+      }
+
+  vector<char> isPivot(H.N,0);
+  E.parity_cols.clear();
+  int r = 0;
+  for (int col=H.N-1; (col>=0) && (r<H.M); col--)
+    {
+      int w = col/ENCWORD_BITS;
+      encword mask = ((encword) 1) << (col % ENCWORD_BITS);
+      int prow = -1;
+      for (int i=r; i<H.M; i++)
+	if (rows[i*Wn + w] & mask)
+	  {
+	    prow = i;
+	    break;
+	  }
+      if (prow < 0)
+	continue;
+      if (prow != r)
+	for (int k=0; k<Wn; k++)
+	  {
+	    encword tmp = rows[r*Wn + k];
+	    rows[r*Wn + k] = rows[prow*Wn + k];
+	    rows[prow*Wn + k] = tmp;
+	  }
+      for (int i=0; i<H.M; i++)
+	if ((i != r) && (rows[i*Wn + w] & mask))
+	  for (int k=0; k<Wn; k++)
+	    rows[i*Wn + k] ^= rows[r*Wn + k];
+      isPivot[col] = 1;
+      E.parity_cols.push_back(col);
+      r++;
+    }
+
+  E.sparse = 0;
+  E.rank = r;
+  E.K = H.N - r;
+  E.info_cols.clear();
+  for (int col=0; col<H.N; col++)
+    if (!isPivot[col])
+      E.info_cols.push_back(col);
+
+  // Store the parity generator column-wise, packed over the rank rows:
+  E.words = (E.rank + ENCWORD_BITS - 1)/ENCWORD_BITS;
+  E.G.assign(E.K*E.words,0);
+  for (int k=0; k<E.K; k++)
+    {
+      int col = E.info_cols[k];
+      int w = col/ENCWORD_BITS;
+      encword mask = ((encword) 1) << (col % ENCWORD_BITS);
+      for (int i=0; i<E.rank; i++)
+	if (rows[i*Wn + w] & mask)
+	  E.G[k*E.words + i/ENCWORD_BITS] |= ((encword) 1) << (i % ENCWORD_BITS);
+    }
+  return 1;
+}
+
+
+void encodeBits(encoder_struct & E, vector<int> & info, vector<int> & bits)
+{
+  int i,j,k;
+  for (k=0; k<E.K; k++)
+    bits[E.info_cols[k]] = info[k];
+
+  if (E.sparse)
+    {
+      for (i=0; i<E.gap; i++)
+	bits[E.gap_cols[i]] = 0;
+      resolveParity(E,bits);
+      if (E.gap == 0)
+	return;
+
+      // Checks left unused with the pivot bits at zero:
+      vector<encword> syn(E.gapWords,0);
+      for (i=0; i<E.gap; i++)
+	{
+	  int p = 0;
+	  vector<int> & row = E.rows[E.check_rows[i]];
+	  for (j=0; j<row.size(); j++)
+	    p ^= bits[row[j]];
+	  syn[i/ENCWORD_BITS] |= ((encword) p) << (i % ENCWORD_BITS);
+	}
+      vector<encword> acc(E.parityWords,0);
+      for (k=0; k<E.gap; k++)
+	{
+	  encword v = 0;
+	  for (j=0; j<E.gapWords; j++)
+	    v ^= E.gapSolve[k*E.gapWords + j] & syn[j];
+	  if (__builtin_parityll(v))
+	    {
+	      bits[E.gap_cols[k]] = 1;
+	      const encword * g = &E.gapEffect[k*E.parityWords];
+	      for (j=0; j<E.parityWords; j++)
+		acc[j] ^= g[j];
+	    }
+	}
+      for (i=0; i<E.parity_cols.size(); i++)
+	bits[E.parity_cols[i]] ^= (acc[i/ENCWORD_BITS] >> (i % ENCWORD_BITS)) & 1;
+      return;
+    }
+
+  vector<encword> acc(E.words,0);
+  for (k=0; k<E.K; k++)
+    if (info[k])
+      {
+	const encword * g = &E.G[k*E.words];
+	for (j=0; j<E.words; j++)
+	  acc[j] ^= g[j];
+      }
+  for (i=0; i<E.rank; i++)
+    bits[E.parity_cols[i]] = (acc[i/ENCWORD_BITS] >> (i % ENCWORD_BITS)) & 1;
+}
+
+
+void encodeRandom(encoder_struct & E, vector<int> & bits)
+{
+  vector<int> info(E.K,0);
+  long r = 0;
+  int avail = 0;
+  for (int k=0; k<E.K; k++)
+    {
+      if (avail == 0)
+	{
+	  r = ran_next();
+	  avail = 31;
+	}
+      info[k] = r & 1;
+      r >>= 1;
+      avail--;
+    }
+  encodeBits(E,info,bits);
+}
+
+
+int checkCodeword(alist_struct & H, vector<int> & bits)
+{
+  int unsat = 0;
+  for (int i=0; i<H.M; i++)
+    {
+      int p = 0;
+      for (int j=0; j<H.num_mlist[i]; j++)
+	p ^= bits[H.mlist[i][j]-1];
+      unsat += p;
+    }
+  return unsat;
+}
@@ -1,6 +1,28 @@
 /* errtopng
    Program to analyze error patterns and convert them to
    PNG images.
+
+   Usage: errtopng outfile infile [infile2 infile3 ...] [--downsample=k] [--threads=n]
+
+   Each input is a matrix with one row per image line:
+     - text: whitespace-separated values, one row per line, such
+       as bipolar decisions (+1 correct, -1 in error); each value
+       v is drawn as 1-v
+     - a failure corpus (--corpus-out): one row per failed frame
+     - a decoder trace (--trace): one row per traced iteration
+   In the binary formats a bit in error is drawn as 2 and a correct
+   bit as 0, as for bipolar text. Inputs are added row by row, so
+   several phases or runs can be overlaid.
+
+   The image is streamed: worker threads (--threads, default one
+   per core) each parse a share of the inputs into a small ring of
+   rows, and the merged rows go straight to libpng. Memory does not
+   grow with the number of rows, apart from the one count per row
+   and input kept for outfile.err. --downsample=k averages k x k
+   blocks into one pixel.
+
+   Writes outfile.png and outfile.err (the per-row sums of each
+   input, one line per input).
 */
 
 
@@ -11,33 +33,78 @@
 #include <vector>
 #include <cmath>
 #include <cstdio>
-#include <malloc.h>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <png.h>
 
 using namespace std;
 
-// This takes the float value 'val', converts it to red, green & blue values, then 
+#include "options.h"
+#include "corpus.h"
+#include "trace.h"
+
+#define INPUT_TEXT    0
+#define INPUT_CORPUS  1
+#define INPUT_TRACE   2
+
+#define RING_ROWS 16      // rows buffered between each worker and the writer
+
+typedef struct {
+  string name ;
+  int  kind ;
+  long rows ;
+  int  width ;
+  long row ;              // next row to read
+  ifstream text ;
+  string line ;
+  corpus_struct corpus ;
+  trace_struct trace ;
+  int  traceRow ;         // next row within the current trace record
+  vector<int> c , d ;
+  vector<float> errTrace ;
+} input_struct ;
+
+typedef struct {
+  vector<vector<float> > slots ;
+  long produced , consumed ;
+  mutex m ;
+  condition_variable cv ;
+} ring_struct ;
+
+typedef struct {
+  FILE * fp ;
+  png_structp png_ptr ;
+  png_infop info_ptr ;
+  vector<png_byte> row ;
+} image_struct ;
+
+// This takes the float value 'val', converts it to red, green & blue values, then
 // sets those values into the image memory buffer location pointed to by 'ptr'
 inline void setRGB(png_byte *ptr, float val);
 
-// This function actually writes out the PNG image file. The string 'title' is
+// These write out the PNG image file row by row. The string 'title' is
 // also written into the image file
+int openImage(image_struct & img, const char * filename, int width, int height, const char * title);
+int writeImageRow(image_struct & img, vector<float> & values);
+int closeImage(image_struct & img);
+void destroyImage(image_struct & img);
 
-int writeImage(const char * filename, int width, int height, vector<vector<float> > & buffer, char* title);
-
-void printMatrix(vector<vector<float> > & matrix);
-int readMatrix(char * fname, vector<vector<float> > & matrix);
-void shiftMatrix(vector<vector<float> > & matrix, float shiftval, float scaleVal);
-void mergeMatrices(vector<vector<float> > & matrix1, vector<vector<float> > & matrix2);
-void countErrorTrace(vector<vector<float> > & matrix ,vector<float> & errTrace);
-void fprintMatrix(const char * fname,vector<vector<float> > & matrix);
+bool openInput(input_struct & in, const char * fname);
+bool readRow(input_struct & in, vector<float> & sum);
+void fillRing(ring_struct & ring, vector<input_struct *> inputs, long rows);
+void fprintErrorTraces(const char * fname, vector<input_struct> & inputs);
 
 
-int main(int argc, char *argv[])  
+int main(int argc, char *argv[])
 {
+  const char * options = "[--downsample=k] [--threads=n]";
+  parseOptions(argc,argv,options);
   // Make sure that the output filename argument has been provided
   if (argc < 3) {
-    fprintf(stderr, "Usage: %s outfile infile [infile2 infile3 ...]", argv[0]);
+    fprintf(stderr, "Usage: %s outfile infile [infile2 infile3 ...] %s\n", argv[0], options);
     return 1;
   }
 
@@ -50,118 +117,249 @@ int main(int argc, char *argv[])
   errfnamestr << fprefix << ".err";
   string errfname(errfnamestr.str());
 
-  vector<vector<float> > matrix;
-  vector<vector<float> > errorHistory;
-
-  //cout << "Attempting to read from " << argv[1] << endl;
-
-  for (int idx=2;idx<argc;idx++)
+  int numInputs = argc-2;
+  int k = optionLong("downsample",1);
+  if (k < 1)
+    k = 1;
+  int numWorkers = optionLong("threads",thread::hardware_concurrency());
+  if ((numWorkers < 1) || (numWorkers > numInputs))
+    numWorkers = numInputs;
+
+  // Open the inputs in parallel; text inputs are counted here.
+  vector<input_struct> inputs(numInputs);
+  vector<char> opened(numInputs,0);
+  vector<thread> openers;
+  for (int w=0; w<numWorkers; w++)
+    openers.push_back(thread([&,w]() {
+	  for (int idx=w; idx<numInputs; idx+=numWorkers)
+	    opened[idx] = openInput(inputs[idx],argv[idx+2]);
+	}));
+  for (int w=0; w<numWorkers; w++)
+    openers[w].join();
+
+  long rows = 0;
+  int columns = 0;
+  for (int idx=0; idx<numInputs; idx++)
     {
-      vector<vector<float> > newMatrix;
-      vector<float> errTrace;
-      if (readMatrix(argv[idx],newMatrix)==1)
+      if (!opened[idx])
 	{
-	  cout << "Some error happened.\n";
+	  cout << "Failed to open input file " << argv[idx+2] << ".\n";
 	  return 1;
 	}
+      cout << "Got matrix with " << inputs[idx].rows << " rows from " << inputs[idx].name << ".\n";
+      rows = max(rows,inputs[idx].rows);
+      columns = max(columns,inputs[idx].width);
+    }
+  if ((rows == 0) || (columns == 0))
+    {
+      cout << "Nothing to draw.\n";
+      return 1;
+    }
 
-      cout << "Got matrix with " << newMatrix.size() << " rows.\n";
-      shiftMatrix(newMatrix,-1,-1);
+  // Each worker adds its share of the inputs into one ring:
+  vector<ring_struct> rings(numWorkers);
+  vector<thread> workers;
+  for (int w=0; w<numWorkers; w++)
+    {
+      rings[w].slots.assign(RING_ROWS,vector<float>(columns,0));
+      rings[w].produced = 0;
+      rings[w].consumed = 0;
+      vector<input_struct *> share;
+      for (int idx=w; idx<numInputs; idx+=numWorkers)
+	share.push_back(&inputs[idx]);
+      workers.push_back(thread(fillRing,ref(rings[w]),share,rows));
+    }
 
-      countErrorTrace(newMatrix,errTrace);
-      errorHistory.push_back(errTrace);
+  int width = (columns+k-1)/k;
+  int height = (rows+k-1)/k;
+  cout << "Writing " << width << "x" << height << " png file to " << pngfname << endl;
+  image_struct img;
+  int result = openImage(img,pngfname.c_str(),width,height,"This is my test image");
+
+  vector<float> merged(columns), block(width,0);
+  for (long y=0; y<rows; y++)
+    {
+      merged.assign(columns,0);
+      for (int w=0; w<numWorkers; w++)
+	{
+	  ring_struct & ring = rings[w];
+	  unique_lock<mutex> lock(ring.m);
+	  ring.cv.wait(lock,[&]() { return ring.produced > y; });
+	  vector<float> & slot = ring.slots[y % RING_ROWS];
+	  lock.unlock();
+	  for (int x=0; x<columns; x++)
+	    merged[x] += slot[x];
+	  lock.lock();
+	  ring.consumed++;
+	  ring.cv.notify_all();
+	}
 
-      mergeMatrices(matrix,newMatrix);
+      for (int x=0; x<columns; x++)
+	block[x/k] += merged[x];
+      if (((y+1) % k == 0) || (y == rows-1))
+	{
+	  int blockRows = y % k + 1;
+	  for (int x=0; x<width; x++)
+	    {
+	      int blockColumns = min(k,columns-x*k);
+	      block[x] /= blockRows*blockColumns;
+	    }
+	  if (result == 0)
+	    result = writeImageRow(img,block);
+	  block.assign(width,0);
+	}
     }
-  int rows= matrix.size();
-  int columns = matrix[0].size();
- 
-  cout << "Writing png file to " << pngfname << endl;
- 
-  int result = writeImage(pngfname.c_str(), columns, rows, matrix, "This is my test image");
+  for (int w=0; w<numWorkers; w++)
+    workers[w].join();
+  if (result == 0)
+    result = closeImage(img);
 
   cout << "Writing error trace to " << errfname << endl;
-  fprintMatrix(errfname.c_str(),errorHistory);
-  return 0;
-}
-
-void mergeMatrices(vector<vector<float> > & matrix1, vector<vector<float> > & matrix2)
-{
-  int rows1 = matrix1.size();
-  int rows2 = matrix2.size();
-  int minsize=min(rows1,rows2);
-  for (int idx=0; idx<minsize; idx++)
-    for (int jdx=0; jdx<matrix1[idx].size(); jdx++)
-      matrix1[idx][jdx] += matrix2[idx][jdx];
-  if (rows1<rows2)
-    for (int idx=rows1; idx<rows2; idx++)
-      matrix1.push_back(matrix2[idx]);
+  fprintErrorTraces(errfname.c_str(),inputs);
+  return result;
 }
 
 
-int readMatrix(char * fname, vector<vector<float> > & matrix)
+// Identify an input by its magic number and find its size. Text
+// inputs are read through once to count their rows.
+bool openInput(input_struct & in, const char * fname)
 {
-  ifstream infile(fname,ios::in);
-  if (!infile)
+  in.name = fname;
+  in.row = 0;
+  in.rows = 0;
+  in.width = 0;
+  char magic[8] = "";
+  FILE * fp = fopen(fname,"rb");
+  if (fp == NULL)
+    return false;
+  size_t got = fread(magic,1,8,fp);
+  fclose(fp);
+
+  if ((got == 8) && (memcmp(magic,CORPUS_MAGIC,8) == 0))
     {
-      cout << "Failed to open input file.\n";
-      return 1;
+      in.kind = INPUT_CORPUS;
+      if (!openCorpus(in.corpus,fname))
+	return false;
+      in.rows = in.corpus.records;
+      in.width = in.corpus.N;
+      return true;
     }
-
-  //if (infile.is_open())
-  //  cout << "It's open...\n";
-
-  //infile.seekg(0);
-  string line;
-  while (getline(infile,line)) //!infile.eof())
+  if ((got == 8) && (memcmp(magic,TRACE_MAGIC,8) == 0))
     {
-      vector<float> entries;
+      in.kind = INPUT_TRACE;
+      if (!openTrace(in.trace,fname))
+	return false;
+      in.rows = countTraceIterations(in.trace);
+      in.width = in.trace.N;
+      in.traceRow = 0;
+      in.trace.rec.it.clear();
+      return true;
+    }
 
-      /*
-      string line;
-      if (getline(infile,line))
-	{
-	  cout << "Acquired line: ";
-	  cout << line;
-	  cout << "\nRecovered values:\n";
-      */
-      stringstream ss(line);
-      for(float num; ss >> num;)
+  in.kind = INPUT_TEXT;
+  in.text.open(fname,ios::in);
+  if (!in.text)
+    return false;
+  while (getline(in.text,in.line))
+    {
+      int entries = 0;
+      char * p = (char *) in.line.c_str();
+      char * end;
+      while (strtof(p,&end), end != p)
 	{
-	  //cout << num << " ";
-	  entries.push_back(num);
+	  entries++;
+	  p = end;
 	}
-      //cout << endl;
-      /*}
-      else
+      if (entries > 0)
 	{
-	  cout << "Failed to read line from input file.\n";
-	  return 1;
-	  }*/
-      if (entries.size() > 0)
-	matrix.push_back(entries);
+	  if (in.rows == 0)
+	    in.width = entries;
+	  in.rows++;
+	}
     }
-  //cout << "Got " << matrix.size() << " rows.\n";
-  infile.close();
-  return 0;
+  in.text.clear();
+  in.text.seekg(0);
+  return true;
 }
 
-void printMatrix(vector<vector<float> > matrix)
+
+// Add the next row of an input into sum. Returns false when the
+// input has no more rows.
+bool readRow(input_struct & in, vector<float> & sum)
 {
-  for (int idx=0; idx<matrix.size(); idx++)
+  if (in.row >= in.rows)
+    return false;
+  float err = 0;
+  if (in.kind == INPUT_TEXT)
+    {
+      int entries = 0;
+      while ((entries == 0) && getline(in.text,in.line))
+	{
+	  char * p = (char *) in.line.c_str();
+	  char * end;
+	  for (float num = strtof(p,&end); end != p; num = strtof(p,&end))
+	    {
+	      float v = (num - 1)*(-1);
+	      if (entries < sum.size())
+		sum[entries] += v;
+	      err += v;
+	      entries++;
+	      p = end;
+	    }
+	}
+      if (entries == 0)
+	return false;
+    }
+  else if (in.kind == INPUT_CORPUS)
+    {
+      readCorpusBits(in.corpus,in.row,in.c,in.d);
+      for (int x=0; x<in.width; x++)
+	if (in.d[x] != in.c[x])
+	  {
+	    sum[x] += 2;
+	    err += 2;
+	  }
+    }
+  else
     {
-      for (int jdx=0; jdx<matrix[idx].size(); jdx++)
-	cout << matrix[idx][jdx] << " ";
-      cout << endl;
+      trace_record & r = in.trace.rec;
+      while (in.traceRow >= r.it.size())
+	{
+	  if (!readTraceRecord(in.trace))
+	    return false;
+	  in.traceRow = 0;
+	}
+      const unsigned char * d = &r.d[(size_t) in.traceRow*in.width];
+      for (int x=0; x<in.width; x++)
+	if (d[x] != r.c[x])
+	  {
+	    sum[x] += 2;
+	    err += 2;
+	  }
+      in.traceRow++;
     }
+  in.errTrace.push_back(err);
+  in.row++;
+  return true;
 }
 
 
-void shiftMatrix(vector<vector<float> > & matrix, float shiftval, float scaleVal)
+// Worker: sum row y of every input in 'inputs' into slot y of the ring.
+void fillRing(ring_struct & ring, vector<input_struct *> inputs, long rows)
 {
-  for (int idx=0; idx<matrix.size(); idx++)
-    for (int jdx=0; jdx<matrix[idx].size(); jdx++)
-      matrix[idx][jdx] = (matrix[idx][jdx] + shiftval)*scaleVal;
+  for (long y=0; y<rows; y++)
+    {
+      unique_lock<mutex> lock(ring.m);
+      ring.cv.wait(lock,[&]() { return ring.produced - ring.consumed < RING_ROWS; });
+      lock.unlock();
+      vector<float> & slot = ring.slots[y % RING_ROWS];
+      slot.assign(slot.size(),0);
+      for (int idx=0; idx<inputs.size(); idx++)
+	readRow(*inputs[idx],slot);
+      lock.lock();
+      ring.produced++;
+      ring.cv.notify_all();
+    }
 }
 
 
@@ -183,49 +381,45 @@ inline void setRGB(png_byte *ptr, float val)
   }
 }
 
-int writeImage(const char * filename, int width, int height, vector<vector<float> > & buffer, char* title)
+int openImage(image_struct & img, const char * filename, int width, int height, const char * title)
 {
-  int code = 0;
-  FILE *fp;
-  png_structp png_ptr;
-  png_infop info_ptr;
-  png_bytep row;
-	
+  img.png_ptr = NULL;
+  img.info_ptr = NULL;
+
   // Open file for writing (binary mode)
-  fp = fopen(filename, "wb");
-  if (fp == NULL) {
+  img.fp = fopen(filename, "wb");
+  if (img.fp == NULL) {
     fprintf(stderr, "Could not open file %s for writing\n", filename);
-    code = 1;
-    goto finalise;
+    return 1;
   }
 
   // Initialize write structure
-  png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  if (png_ptr == NULL) {
+  img.png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (img.png_ptr == NULL) {
     fprintf(stderr, "Could not allocate write struct\n");
-    code = 1;
-    goto finalise;
+    destroyImage(img);
+    return 1;
   }
 
   // Initialize info structure
-  info_ptr = png_create_info_struct(png_ptr);
-  if (info_ptr == NULL) {
+  img.info_ptr = png_create_info_struct(img.png_ptr);
+  if (img.info_ptr == NULL) {
     fprintf(stderr, "Could not allocate info struct\n");
-    code = 1;
-    goto finalise;
+    destroyImage(img);
+    return 1;
   }
 
   // Setup Exception handling
-  if (setjmp(png_jmpbuf(png_ptr))) {
+  if (setjmp(png_jmpbuf(img.png_ptr))) {
     fprintf(stderr, "Error during png creation\n");
-    code = 1;
-    goto finalise;
+    destroyImage(img);
+    return 1;
   }
 
-  png_init_io(png_ptr, fp);
+  png_init_io(img.png_ptr, img.fp);
 
   // Write header (8 bit colour depth)
-  png_set_IHDR(png_ptr, info_ptr, width, height,
+  png_set_IHDR(img.png_ptr, img.info_ptr, width, height,
 	       8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
 	       PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
@@ -233,58 +427,63 @@ int writeImage(const char * filename, int width, int height, vector<vector<float
   if (title != NULL) {
     png_text title_text;
     title_text.compression = PNG_TEXT_COMPRESSION_NONE;
-    title_text.key = "Title";
-    title_text.text = title;
-    png_set_text(png_ptr, info_ptr, &title_text, 1);
+    title_text.key = (png_charp) "Title";
+    title_text.text = (png_charp) title;
+    png_set_text(img.png_ptr, img.info_ptr, &title_text, 1);
   }
 
-  png_write_info(png_ptr, info_ptr);
+  png_write_info(img.png_ptr, img.info_ptr);
 
-  // Allocate memory for one row (3 bytes per pixel - RGB)
-  row = (png_bytep) malloc(3 * width * sizeof(png_byte));
+  // Memory for one row (3 bytes per pixel - RGB)
+  img.row.assign(3*width,0);
+  return 0;
+}
 
-  // Write image data
-  int x, y;
-  for (y=0 ; y<height ; y++) {
-    for (x=0 ; x<width ; x++) {
-      setRGB(&(row[x*3]), buffer[y][x]);
-    }
-    png_write_row(png_ptr, row);
+int writeImageRow(image_struct & img, vector<float> & values)
+{
+  if (setjmp(png_jmpbuf(img.png_ptr))) {
+    fprintf(stderr, "Error during png creation\n");
+    destroyImage(img);
+    return 1;
   }
+  for (int x=0 ; x<values.size() ; x++)
+    setRGB(&(img.row[x*3]), values[x]);
+  png_write_row(img.png_ptr, img.row.data());
+  return 0;
+}
 
+int closeImage(image_struct & img)
+{
   // End write
-  png_write_end(png_ptr, NULL);
-
- finalise:
-  if (fp != NULL) fclose(fp);
-  if (info_ptr != NULL) png_free_data(png_ptr, info_ptr, PNG_FREE_ALL, -1);
-  if (png_ptr != NULL) png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-  if (row != NULL) free(row);
-
-  return code;
+  if (setjmp(png_jmpbuf(img.png_ptr))) {
+    fprintf(stderr, "Error during png creation\n");
+    destroyImage(img);
+    return 1;
+  }
+  png_write_end(img.png_ptr, NULL);
+  destroyImage(img);
+  return 0;
 }
 
-
-void countErrorTrace(vector<vector<float> > & matrix ,vector<float> & errTrace)
+void destroyImage(image_struct & img)
 {
-  for (int idx=0; idx<matrix.size(); idx++)
-    {
-      int err=0;
-      for (int jdx=0; jdx<matrix[idx].size(); jdx++)
-	err += matrix[idx][jdx];
-      errTrace.push_back(err);
-    }
+  if (img.fp != NULL) fclose(img.fp);
+  if (img.info_ptr != NULL) png_free_data(img.png_ptr, img.info_ptr, PNG_FREE_ALL, -1);
+  if (img.png_ptr != NULL) png_destroy_write_struct(&img.png_ptr, (png_infopp)NULL);
+  img.fp = NULL;
+  img.png_ptr = NULL;
+  img.info_ptr = NULL;
 }
 
 
-void fprintMatrix(const char * fname,vector<vector<float> > & matrix)
+void fprintErrorTraces(const char * fname, vector<input_struct> & inputs)
 {
   ofstream of(fname,ios::out);
-  for (int idx=0; idx<matrix.size(); idx++)
+  for (int idx=0; idx<inputs.size(); idx++)
     {
-      for (int jdx=0; jdx<matrix[idx].size(); jdx++)
-	of << matrix[idx][jdx] << "\t";
-      of << endl;
-    }  
+      for (int jdx=0; jdx<inputs[idx].errTrace.size(); jdx++)
+	of << inputs[idx].errTrace[jdx] << "\t";
+      of << "\n";
+    }
   of.close();
 }
@@ -0,0 +1,153 @@
+/*==========================================================================================
+** extrapolate.cpp
+** By Chris Winstead
+
+** Description:
+   Likelihood-ratio reweighting of simulated frames to nearby SNRs.
+   See extrapolate.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "extrapolate.h"
+#include "options.h"
+using namespace std;
+
+double snrToSigma(double SNR, double R)
+{
+  return sqrt(pow(10.0,-SNR/10.0)/R/2.0);
+}
+
+
+void setupExtrapolation(extrap_struct & X, double SNR, double R, int N)
+{
+  X.enabled = hasOption("extrapolate");
+  X.SNR0 = SNR;
+  X.R = R;
+  X.N = N;
+  X.sigma0 = snrToSigma(SNR,R);
+  X.frames = 0;
+  X.SNR.clear();
+  if (!X.enabled)
+    return;
+  // Replayed or captured frames draw no channel noise to reweight:
+  if (hasOption("corpus-in") || hasOption("llr-in"))
+    {
+      cout << "Error: --extrapolate cannot be combined with --corpus-in or --llr-in." << endl;
+      exit(1);
+    }
+
+  string list = optionString("extrapolate","");
+  replace(list.begin(),list.end(),',',' ');
+  stringstream ss(list);
+  double snr;
+  while (ss >> snr)
+    X.SNR.push_back(snr);
+
+  int K = X.SNR.size();
+  X.logRatio.assign(K,0);
+  X.energyCoef.assign(K,0);
+  for (int k=0; k<K; k++)
+    {
+      double sigma = snrToSigma(X.SNR[k],R);
+      X.logRatio[k] = N*log(X.sigma0/sigma);
+      X.energyCoef[k] = 0.5*(X.sigma0*X.sigma0/(sigma*sigma) - 1.0);
+    }
+  X.sumW.assign(K,0);
+  X.sumW2.assign(K,0);
+  X.sumWE.assign(K,0);
+  X.sumW2E.assign(K,0);
+  X.sumWB.assign(K,0);
+  X.sumW2B.assign(K,0);
+  X.failures.assign(K,0);
+
+  // Targets where the log-weight spread sqrt(N/2)|sigma0^2/sigma^2-1|
+  // stays below one:
+  double ratioLo = 1.0 - sqrt(2.0/N);
+  double ratioHi = 1.0 + sqrt(2.0/N);
+  double snrLo = SNR - 10.0*log10(ratioHi);
+  double snrHi = (ratioLo > 0) ? SNR - 10.0*log10(ratioLo) : INFINITY;
+  cout << "Extrapolating to " << K << " SNR points; reliable window about ["
+       << snrLo << ", " << snrHi << "] dB." << endl;
+}
+
+
+void recordExtrapolationFrame(extrap_struct & X, is_struct & IS, int bitErrors)
+{
+  if (!X.enabled)
+    return;
+  double e = (bitErrors > 0) ? 1.0 : 0.0;
+  double b = (double) bitErrors/X.N;
+  X.frames++;
+  for (int k=0; k<X.SNR.size(); k++)
+    {
+      double w = exp(IS.frameLogWeight + X.logRatio[k] - X.energyCoef[k]*IS.frameEnergy);
+      X.sumW[k]   += w;
+      X.sumW2[k]  += w*w;
+      X.sumWE[k]  += w*e;
+      X.sumW2E[k] += w*w*e;
+      X.sumWB[k]  += w*b;
+      X.sumW2B[k] += w*w*b*b;
+      if ((e > 0) && (w > 0))
+	X.failures[k]++;
+    }
+}
+
+
+void extrapolationPoint(extrap_struct & X, int k, double & fer, double & ferStd, double & ber, double & berStd, double & ess)
+{
+  double n = X.frames;
+  fer = X.sumWE[k]/n;
+  ber = X.sumWB[k]/n;
+  ferStd = sqrt(max(0.0, X.sumW2E[k]/n - fer*fer)/n);
+  berStd = sqrt(max(0.0, X.sumW2B[k]/n - ber*ber)/n);
+  ess = (X.sumW2[k] > 0) ? X.sumW[k]*X.sumW[k]/X.sumW2[k] : 0;
+}
+
+
+bool extrapolationValid(extrap_struct & X, int k, double ess)
+{
+  return (ess >= 0.1*X.frames) && (X.failures[k] >= 10);
+}
+
+
+void reportExtrapolation(extrap_struct & X)
+{
+  if (!X.enabled || (X.frames == 0))
+    return;
+  cout << "\nExtrapolated from SNR=" << X.SNR0 << " over " << X.frames << " frames:\n\tSNR\tFER\tstd\tBER\tstd\tESS\n";
+  for (int k=0; k<X.SNR.size(); k++)
+    {
+      double fer, ferStd, ber, berStd, ess;
+      extrapolationPoint(X,k,fer,ferStd,ber,berStd,ess);
+      cout << "\t" << X.SNR[k] << "\t" << fer << "\t" << ferStd << "\t" << ber << "\t" << berStd << "\t" << ess;
+      if (!extrapolationValid(X,k,ess))
+	cout << "\t(unreliable)";
+      cout << endl;
+    }
+}
+
+
+// One row per target: SNR FER std BER std ESS valid frames anchorSNR code
+void writeExtrapolationLog(extrap_struct & X, string logfilename, const char * codeName)
+{
+  if (!X.enabled || (X.frames == 0))
+    return;
+  string fileName = logfilename + ".extrap";
+  ofstream of(fileName.c_str(),ios::app);
+  char tab = '\t';
+  for (int k=0; k<X.SNR.size(); k++)
+    {
+      double fer, ferStd, ber, berStd, ess;
+      extrapolationPoint(X,k,fer,ferStd,ber,berStd,ess);
+      of << X.SNR[k] << tab << fer << tab << ferStd << tab << ber << tab << berStd << tab
+	 << ess << tab << extrapolationValid(X,k,ess) << tab << X.frames << tab << X.SNR0 << tab << codeName << endl;
+    }
+  of.close();
+}
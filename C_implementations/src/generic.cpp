@@ -0,0 +1,177 @@
+/*==========================================================================================
+** generic.cpp
+** By Chris Winstead
+
+** Description:
+   Reference min-sum, BP and bit-flipping kernels on the alist
+   adjacency lists. See generic.h.
+==============================================================================================*/
+
+#include <vector>
+#include <cmath>
+#include "generic.h"
+using namespace std;
+
+
+static double sgn(double x)
+{
+  if (x >= 0.0)
+    return 1.0;
+  return -1.0;
+}
+
+
+// Index of (0-based) node 'node' in a 1-based adjacency list.
+static int find(int list[], int len, int node)
+{
+  int result = -1;
+  for (int i=0; i<len; i++)
+    {
+      if (node == (list[i]-1))
+	result = i;
+    }
+  return result;
+}
+
+
+void setupGenericMessages(alist_struct & H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
+{
+  for (int i=0; i<H.N; i++)
+    sym_to_check.push_back(vector<double>(H.num_nlist[i],0.0));
+  for (int i=0; i<H.M; i++)
+    check_to_sym.push_back(vector<double>(H.num_mlist[i],0.0));
+}
+
+
+void initializeGenericMessages(alist_struct & H, vector<vector<double> > & sym_to_check, vector<double> & y)
+{
+  for (int i=0; i<H.N; i++)
+    for (int j=0; j<H.num_nlist[i]; j++)
+      sym_to_check[i][j] = y[i];
+}
+
+
+void genericMinSumCheckUpdates(alist_struct & H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
+{
+  double minMag;
+  double minMag2;
+  int    minIdx;
+  double msg;
+  double prod;
+  for (int i=0; i<H.M; i++)
+    {
+      minMag = INFINITY;
+      minMag2 = INFINITY;
+      minIdx = -1;
+      prod = 1.0;
+      for (int j=0; j<H.num_mlist[i]; j++)
+	{
+	  int snode = H.mlist[i][j]-1;
+	  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
+	  msg = sym_to_check[snode][midx];
+	  prod *= sgn(msg);
+	  if (abs(msg) <= minMag)
+	    {
+	      minMag2 = minMag;
+	      minMag = abs(msg);
+	      minIdx = j;
+	    }
+	  else if (abs(msg) < minMag2)
+	    {
+	      minMag2 = abs(msg);
+	    }
+	}
+      for (int j=0; j<H.num_mlist[i]; j++)
+	{
+	  int snode = H.mlist[i][j]-1;
+	  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
+	  msg = sym_to_check[snode][midx];
+	  if (j == minIdx)
+	    check_to_sym[i][j] = prod*minMag2*sgn(msg);
+	  else
+	    check_to_sym[i][j] = prod*minMag*sgn(msg);
+	}
+    }
+}
+
+
+void genericBPCheckUpdates(alist_struct & H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
+{
+  double msg;
+  double prod;
+  for (int i=0; i<H.M; i++)
+    {
+      for (int j=0; j<H.num_mlist[i]; j++)
+	{
+	  prod=1.0;
+	  for (int k=0; k<H.num_mlist[i]; k++)
+	    {
+	      if (j != k)
+		{
+		  int snode = H.mlist[i][k]-1;
+		  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
+		  msg = sym_to_check[snode][midx];
+		  prod *= tanh(msg/2.0);
+		}
+	    }
+	  check_to_sym[i][j] = log((1.0+prod)/(1.0-prod));
+	}
+    }
+}
+
+
+void genericSymNodeUpdates(alist_struct & H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym, double maxLLR)
+{
+  for (int i=0; i<H.N; i++)
+    {
+      double sum = y[i];
+      for (int j=0; j<H.num_nlist[i]; j++)
+	{
+	  int cnode = H.nlist[i][j]-1;
+	  int midx = find(H.mlist[cnode],H.num_mlist[cnode],i);
+	  sum += check_to_sym[cnode][midx];
+	}
+      for (int j=0; j<H.num_nlist[i]; j++)
+	{
+	  int cnode = H.nlist[i][j]-1;
+	  int midx = find(H.mlist[cnode],H.num_mlist[cnode],i);
+	  double outmsg = sum - check_to_sym[cnode][midx];
+	  if ((maxLLR > 0) && (abs(outmsg) > maxLLR))
+	    outmsg = maxLLR*sgn(outmsg);
+	  sym_to_check[i][j] = outmsg;
+	}
+      if (sum > 0)
+	d[i] = 1;
+      else
+	d[i] = -1;
+    }
+}
+
+
+// Returns true if every check is satisfied.
+bool genericSyndrome(alist_struct & H, vector<int> & d, vector<int> & syndrome)
+{
+  bool satisfied = true;
+  for (int i=0; i<H.M; i++)
+    {
+      int prod = 1;
+      for (int j=0; j<H.num_mlist[i]; j++)
+	prod *= d[H.mlist[i][j]-1];
+      if (prod < 0)
+	satisfied = false;
+      syndrome[i] = prod;
+    }
+  return satisfied;
+}
+
+
+void genericUnsatisfiedCounts(alist_struct & H, vector<int> & syndrome, vector<int> & counts)
+{
+  for (int i=0; i<H.N; i++)
+    {
+      int n = 0;
+      for (int j=0; j<H.num_nlist[i]; j++)
+	n += (syndrome[H.nlist[i][j]-1] < 0);
+      counts[i] = n;
+    }
+}
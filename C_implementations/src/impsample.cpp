@@ -0,0 +1,150 @@
+/*==========================================================================================
+** impsample.cpp
+** By Chris Winstead
+
+** Description:
+   Importance-sampling channel and weighted estimators. See
+   impsample.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "impsample.h"
+#include "options.h"
+#include "rand.h"
+using namespace std;
+
+
+void setupImportanceSampling(is_struct & IS, int N)
+{
+  IS.enabled = hasOption("is-shift") || hasOption("is-scale");
+  IS.shift = optionDouble("is-shift",0.0);
+  IS.scale = optionDouble("is-scale",1.0);
+  IS.biased.assign(N,IS.enabled);
+  IS.numBiased = IS.enabled ? N : 0;
+  IS.frameLogWeight = 0;
+  IS.frameEnergy = 0;
+  IS.frames = 0;
+  IS.sumW = IS.sumW2 = 0;
+  IS.sumWE = IS.sumW2E = 0;
+  IS.sumWB = IS.sumW2B = 0;
+
+  if (!IS.enabled)
+    return;
+
+  string fileName = optionString("is-positions","");
+  if (!fileName.empty())
+    {
+      ifstream f(fileName.c_str(),ios::in);
+      if (!f)
+	{
+	  cout << "Failed to open importance-sampling position file " << fileName << endl;
+	  exit(1);
+	}
+      IS.biased.assign(N,0);
+      IS.numBiased = 0;
+      int idx;
+      while (f >> idx)
+	if ((idx >= 0) && (idx < N) && !IS.biased[idx])
+	  {
+	    IS.biased[idx] = 1;
+	    IS.numBiased++;
+	  }
+    }
+  cout << "Importance sampling: noise ~ N(" << -IS.shift << ", " << IS.scale*IS.scale
+       << ") on " << IS.numBiased << " of " << N << " positions." << endl;
+}
+
+
+void beginISFrame(is_struct & IS)
+{
+  IS.frameLogWeight = 0;
+  IS.frameEnergy = 0;
+}
+
+
+// Normalized noise sample for position i. Positions outside the
+// biased set draw from N(0,1) exactly as the plain simulators do.
+// The frame's noise energy is kept for SNR extrapolation.
+double channelNoise(is_struct & IS, int i)
+{
+  if (!IS.enabled || !IS.biased[i])
+    {
+      double n = rann();
+      IS.frameEnergy += n*n;
+      return n;
+    }
+
+  double n = -IS.shift + IS.scale*rann();
+  double u = (n + IS.shift)/IS.scale;
+  IS.frameLogWeight += -0.5*n*n + 0.5*u*u + log(IS.scale);
+  IS.frameEnergy += n*n;
+  return n;
+}
+
+
+void recordISFrame(is_struct & IS, int bitErrors, int N)
+{
+  if (!IS.enabled)
+    return;
+  double w = exp(IS.frameLogWeight);
+  double e = (bitErrors > 0) ? 1.0 : 0.0;
+  double b = (double) bitErrors/N;
+  IS.frames++;
+  IS.sumW   += w;
+  IS.sumW2  += w*w;
+  IS.sumWE  += w*e;
+  IS.sumW2E += w*w*e;
+  IS.sumWB  += w*b;
+  IS.sumW2B += w*w*b*b;
+}
+
+
+void isEstimates(is_struct & IS, double & fer, double & ferStd, double & ber, double & berStd)
+{
+  double n = IS.frames;
+  if (n == 0)
+    {
+      fer = ferStd = ber = berStd = 0;
+      return;
+    }
+  fer = IS.sumWE/n;
+  ber = IS.sumWB/n;
+  ferStd = sqrt(max(0.0, IS.sumW2E/n - fer*fer)/n);
+  berStd = sqrt(max(0.0, IS.sumW2B/n - ber*ber)/n);
+}
+
+
+// Kish effective sample size of the frame weights. Values far below
+// the frame count mean a few frames dominate the estimate.
+double isEffectiveSampleSize(is_struct & IS)
+{
+  if (IS.sumW2 == 0)
+    return 0;
+  return IS.sumW*IS.sumW/IS.sumW2;
+}
+
+
+void reportIS(is_struct & IS)
+{
+  if (!IS.enabled)
+    return;
+  double fer, ferStd, ber, berStd;
+  isEstimates(IS,fer,ferStd,ber,berStd);
+  cout << "Importance-sampling estimate: FER=" << fer << " (std " << ferStd << "), BER="
+       << ber << " (std " << berStd << "), effective frames=" << isEffectiveSampleSize(IS)
+       << " of " << IS.frames << endl;
+}
+
+
+// Weighted estimates as four tab-separated log columns:
+// FER, std(FER), BER, std(BER).
+void writeISColumns(is_struct & IS, ostream & of)
+{
+  double fer, ferStd, ber, berStd;
+  isEstimates(IS,fer,ferStd,ber,berStd);
+  of << fer << '\t' << ferStd << '\t' << ber << '\t' << berStd;
+}
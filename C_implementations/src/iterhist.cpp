@@ -0,0 +1,85 @@
+/*==========================================================================================
+** iterhist.cpp
+** By Chris Winstead
+
+** Description:
+   Iteration and phase histograms. See iterhist.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <cmath>
+#include "iterhist.h"
+using namespace std;
+
+
+void setupIterationHistogram(iterhist_struct & h, int T, int numPhases)
+{
+  h.T = T;
+  h.iterations.assign(T+1,0);
+  h.phases.assign((numPhases > 0) ? numPhases : 1,0);
+}
+
+
+void iterationSurvival(iterhist_struct & h, vector<double> & survival)
+{
+  long total = 0;
+  for (int k=0; k<=h.T; k++)
+    total += h.iterations[k];
+  survival.assign(h.T,0.0);
+  if (total == 0)
+    return;
+  long atLeast = total;
+  for (int k=0; k<h.T; k++)
+    {
+      survival[k] = (double) atLeast/total;
+      atLeast -= h.iterations[k];
+    }
+}
+
+
+// Smallest k such that a fraction p of the frames used at most k iterations.
+long iterationPercentile(iterhist_struct & h, double p)
+{
+  long total = 0;
+  for (int k=0; k<=h.T; k++)
+    total += h.iterations[k];
+  long rank = (long) ceil(p*total);
+  if (rank < 1)
+    rank = 1;
+  long seen = 0;
+  for (int k=0; k<=h.T; k++)
+    {
+      seen += h.iterations[k];
+      if (seen >= rank)
+	return k;
+    }
+  return h.T;
+}
+
+
+void reportIterations(iterhist_struct & h)
+{
+  long total = 0, sum = 0;
+  int largest = 0;
+  for (int k=0; k<=h.T; k++)
+    {
+      total += h.iterations[k];
+      sum += k*h.iterations[k];
+      if (h.iterations[k] > 0)
+	largest = k;
+    }
+  if (total == 0)
+    return;
+
+  cout << "\nIterations over " << total << " frames: mean " << (double) sum/total
+       << ", p50 " << iterationPercentile(h,0.5) << ", p90 " << iterationPercentile(h,0.9)
+       << ", p99 " << iterationPercentile(h,0.99) << ", max " << largest
+       << ", reached limit " << h.iterations[h.T] << " (" << 100.0*h.iterations[h.T]/total << "%)" << endl;
+  if (h.phases.size() > 1)
+    {
+      cout << "Frames by phase:";
+      for (int p=0; p<h.phases.size(); p++)
+	cout << "\t" << p << ": " << h.phases[p];
+      cout << endl;
+    }
+}
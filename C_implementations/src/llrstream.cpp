@@ -0,0 +1,308 @@
+/*==========================================================================================
+** llrstream.cpp
+** By Chris Winstead
+
+** Description:
+   Pipelined reading of captured channel values and writing of
+   decisions. See llrstream.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "llrstream.h"
+#include "options.h"
+using namespace std;
+
+
+static bool closingRequested(llrstream_struct & st)
+{
+  lock_guard<mutex> lock(st.m);
+  return st.closing;
+}
+
+
+// The bytes of the next frame, or NULL at the end of the input or
+// when the stream is being closed.
+static const unsigned char * nextChunk(llrstream_struct & st)
+{
+  size_t bytes = (size_t) st.N*st.valueBytes;
+  if (st.map != NULL)
+    {
+      if (st.offset + bytes > st.mapSize)
+	return NULL;
+      const unsigned char * p = st.map + st.offset;
+      st.offset += bytes;
+      return p;
+    }
+  size_t got = 0;
+  while (got < bytes)
+    {
+      // Wait in short slices, so that closeLLRStream() can stop a
+      // reader on a pipe whose writer is still open:
+      struct pollfd pfd = {st.fd, POLLIN, 0};
+      int ready = poll(&pfd,1,100);
+      if ((ready < 0) && (errno != EINTR))
+	break;
+      if (ready <= 0)
+	{
+	  if (closingRequested(st))
+	    return NULL;
+	  continue;
+	}
+      ssize_t n = read(st.fd,st.chunk.data()+got,bytes-got);
+      if (n <= 0)
+	break;
+      got += n;
+    }
+  if (got > 0 && got < bytes)
+    st.partialBytes = got;   // reported by closeLLRStream(), off the reader thread
+  return (got == bytes) ? st.chunk.data() : NULL;
+}
+
+
+static void convert(llrstream_struct & st, const unsigned char * p, vector<double> & y)
+{
+  for (int i=0; i<st.N; i++)
+    {
+      double v;
+      switch (st.format)
+	{
+	case LLR_F64: { double t; memcpy(&t,p+8*i,8); v = t; break; }
+	case LLR_I8:  v = ((const int8_t *) p)[i]; break;
+	case LLR_I16: { int16_t t; memcpy(&t,p+2*i,2); v = t; break; }
+	default:      { float t; memcpy(&t,p+4*i,4); v = t; break; }
+	}
+      y[i] = st.scale*v;
+    }
+  if (st.order != NULL)
+    toReordered(*st.order,y);
+}
+
+
+static void readerLoop(llrstream_struct * st)
+{
+  for (long k=0; ; k++)
+    {
+      unique_lock<mutex> lock(st->m);
+      st->cv.wait(lock,[&]() { return st->closing || (st->read - st->taken < LLR_SLOTS); });
+      if (st->closing)
+	break;
+      lock.unlock();
+
+      const unsigned char * p = nextChunk(*st);
+      if (p != NULL)
+	convert(*st,p,st->inSlots[k % LLR_SLOTS]);
+
+      lock.lock();
+      if (p == NULL)
+	{
+	  st->inputDone = true;
+	  st->cv.notify_all();
+	  break;
+	}
+      st->read++;
+      st->cv.notify_all();
+    }
+}
+
+
+static void writerLoop(llrstream_struct * st)
+{
+  int N = st->N;
+  while (true)
+    {
+      unique_lock<mutex> lock(st->m);
+      st->cv.wait(lock,[&]() { return st->closing || (st->written < st->queued); });
+      if (st->written == st->queued)
+	break;
+      long k = st->written;
+      lock.unlock();
+
+      vector<int> & d = st->outSlots[k % LLR_SLOTS];
+      int one = st->outOne[k % LLR_SLOTS];
+      if (st->order != NULL)
+	fromReordered(*st->order,d);
+      st->packed.assign((N+7)/8,0);
+      for (int i=0; i<N; i++)
+	if (d[i] == one)
+	  st->packed[i/8] |= 1 << (i%8);
+      fwrite(st->packed.data(),1,st->packed.size(),st->out);
+
+      lock.lock();
+      st->written++;
+      st->cv.notify_all();
+    }
+}
+
+
+void setupLLRStream(llrstream_struct & st, int N, double sigma, stopping_struct & stop, reorder_struct * order)
+{
+  st.enabled = hasOption("llr-in");
+  st.out = NULL;
+  st.map = NULL;
+  st.fd = -1;
+  if (!st.enabled)
+    return;
+  if (hasOption("corpus-in") || hasOption("shard") || hasOption("merge-shards") || hasOption("cache") || hasOption("resume"))
+    {
+      cout << "Error: --llr-in cannot be combined with --corpus-in, --shard, --cache or --resume." << endl;
+      exit(1);
+    }
+
+  st.N = N;
+  st.order = order;
+  string format = optionString("llr-format","f32");
+  const char * names[4] = {"f32", "f64", "i8", "i16"};
+  const int bytes[4] = {4, 8, 1, 2};
+  st.format = -1;
+  for (int k=0; k<4; k++)
+    if (format == names[k])
+      {
+	st.format = k;
+	st.valueBytes = bytes[k];
+      }
+  if (st.format < 0)
+    {
+      cout << "Error: unknown --llr-format=" << format << " (f32, f64, i8 or i16)" << endl;
+      exit(1);
+    }
+  // y = L*sigma^2/2 undoes the decoders' L = 2y/sigma^2:
+  st.scale = optionDouble("llr-scale",1.0);
+  if (!hasOption("llr-samples"))
+    st.scale *= sigma*sigma/2.0;
+
+  st.inName = optionString("llr-in","-");
+  long frames = -1;
+  if (st.inName == "-")
+    st.fd = 0;
+  else
+    {
+      struct stat info;
+      st.fd = open(st.inName.c_str(),O_RDONLY);
+      if ((st.fd >= 0) && (fstat(st.fd,&info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0))
+	{
+	  void * p = mmap(NULL,info.st_size,PROT_READ,MAP_PRIVATE,st.fd,0);
+	  if (p != MAP_FAILED)
+	    {
+	      st.map = (const unsigned char *) p;
+	      st.mapSize = info.st_size;
+	      madvise(p,info.st_size,MADV_SEQUENTIAL);
+	      frames = st.mapSize/((size_t) N*st.valueBytes);
+	    }
+	}
+    }
+  if (st.fd < 0)
+    {
+      cout << "Error: could not open " << st.inName << endl;
+      exit(1);
+    }
+  st.offset = 0;
+  st.partialBytes = 0;
+  st.chunk.assign((size_t) N*st.valueBytes,0);
+
+  if (hasOption("llr-out"))
+    {
+      st.outName = optionString("llr-out","");
+      st.out = fopen(st.outName.c_str(),"wb");
+      if (st.out == NULL)
+	{
+	  cout << "Error: could not open " << st.outName << endl;
+	  exit(1);
+	}
+    }
+
+  // Run to the end of the input unless --frames says otherwise:
+  stop.mode = STOP_RULES;
+  st.y.assign(N,0);
+  st.inSlots.assign(LLR_SLOTS,vector<double>(N,0));
+  st.outSlots.assign(LLR_SLOTS,vector<int>(N,0));
+  st.outOne.assign(LLR_SLOTS,1);
+  st.read = st.taken = st.queued = st.written = 0;
+  st.inputDone = st.closing = false;
+  st.reader = thread(readerLoop,&st);
+  if (st.out != NULL)
+    st.writer = thread(writerLoop,&st);
+
+  cout << "Decoding " << format << " " << (hasOption("llr-samples") ? "samples" : "LLRs") << " from " << st.inName;
+  if (frames >= 0)
+    cout << " (" << frames << " frames)";
+  if (st.out != NULL)
+    cout << ", decisions to " << st.outName;
+  cout << endl;
+}
+
+
+// Make the next frame current in st.y. Returns false at the end of
+// the input; always true when no stream is configured.
+bool nextLLRFrame(llrstream_struct & st)
+{
+  if (!st.enabled)
+    return true;
+  unique_lock<mutex> lock(st.m);
+  st.cv.wait(lock,[&]() { return st.inputDone || (st.read > st.taken); });
+  if (st.read == st.taken)
+    return false;
+  st.y.swap(st.inSlots[st.taken % LLR_SLOTS]);
+  st.taken++;
+  st.cv.notify_all();
+  return true;
+}
+
+
+// Queue the decisions of the current frame; d holds 'one' for a 1 bit.
+void writeLLRDecisions(llrstream_struct & st, vector<int> & d, int one)
+{
+  if (st.out == NULL)
+    return;
+  unique_lock<mutex> lock(st.m);
+  st.cv.wait(lock,[&]() { return st.queued - st.written < LLR_SLOTS; });
+  long k = st.queued;
+  lock.unlock();
+  st.outSlots[k % LLR_SLOTS].assign(d.begin(),d.end());
+  st.outOne[k % LLR_SLOTS] = one;
+  lock.lock();
+  st.queued++;
+  st.cv.notify_all();
+}
+
+
+void closeLLRStream(llrstream_struct & st)
+{
+  if (!st.enabled)
+    return;
+  {
+    lock_guard<mutex> lock(st.m);
+    st.closing = true;
+  }
+  st.cv.notify_all();
+  st.reader.join();
+  if (st.out != NULL)
+    {
+      st.writer.join();
+      fclose(st.out);
+      st.out = NULL;
+    }
+  if (st.map != NULL)
+    munmap((void *) st.map,st.mapSize);
+  if (st.fd > 0)
+    close(st.fd);
+  st.map = NULL;
+  st.enabled = 0;
+  if (st.partialBytes > 0)
+    cout << "Warning: ignored " << st.partialBytes << " bytes of a partial frame at the end of " << st.inName << endl;
+  cout << "Decoded " << st.taken << " frames from " << st.inName;
+  if (!st.outName.empty())
+    cout << "; decisions in " << st.outName;
+  cout << endl;
+}
@@ -0,0 +1,202 @@
+/*==========================================================================================
+** options.cpp
+** By Chris Winstead
+
+** Description:
+   Command-line switches shared by the simulators. See options.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include "options.h"
+using namespace std;
+
+static map<string,string> options;
+
+
+// True if 'usage' lists --name, followed by '=', ']' or white space.
+static bool documentedOption(const string & usage, const string & name)
+{
+  string flag = "--" + name;
+  for (size_t pos=usage.find(flag); pos != string::npos; pos=usage.find(flag,pos+1))
+    {
+      size_t end = pos + flag.size();
+      if ((end == usage.size()) || (strchr("= ]\n",usage[end]) != NULL))
+	return true;
+    }
+  return false;
+}
+
+
+int parseOptions(int & argc, char * argv[])
+{
+  return parseOptions(argc,argv,optionUsage());
+}
+
+
+// Move every --name[=value] argument into the option table and
+// compact the remaining positional arguments. Returns the number
+// of options found. A name that 'usage' does not list is an error,
+// so a mistyped switch cannot be silently ignored.
+int parseOptions(int & argc, char * argv[], const string & usage)
+{
+  int kept = 1;
+  int found = 0;
+  for (int i=1; i<argc; i++)
+    {
+      if (strncmp(argv[i],"--",2) == 0)
+	{
+	  string arg(argv[i]+2);
+	  size_t eq = arg.find('=');
+	  string name = arg.substr(0,eq);
+	  if (name.empty() || !documentedOption(usage,name))
+	    {
+	      cout << "Error: unknown option " << argv[i] << endl;
+	      exit(1);
+	    }
+	  if (eq == string::npos)
+	    options[name] = "";
+	  else
+	    options[name] = arg.substr(eq+1);
+	  found++;
+	}
+      else
+	argv[kept++] = argv[i];
+    }
+  argc = kept;
+  argv[argc] = NULL;
+  return found;
+}
+
+
+bool hasOption(const char * name)
+{
+  return (options.find(name) != options.end());
+}
+
+
+string optionString(const char * name, const char * defaultValue)
+{
+  map<string,string>::iterator it = options.find(name);
+  if (it == options.end())
+    return string(defaultValue);
+  return it->second;
+}
+
+
+long optionLong(const char * name, long defaultValue)
+{
+  map<string,string>::iterator it = options.find(name);
+  if ((it == options.end()) || it->second.empty())
+    return defaultValue;
+  const char * text = it->second.c_str();
+  char * end;
+  errno = 0;
+  long value = strtol(text,&end,10);
+  if ((end == text) || (*end != '\0') || (errno == ERANGE))
+    {
+      cout << "Error: --" << name << " expects an integer, not '" << it->second << "'" << endl;
+      exit(1);
+    }
+  return value;
+}
+
+
+double optionDouble(const char * name, double defaultValue)
+{
+  map<string,string>::iterator it = options.find(name);
+  if ((it == options.end()) || it->second.empty())
+    return defaultValue;
+  const char * text = it->second.c_str();
+  char * end;
+  errno = 0;
+  double value = strtod(text,&end);
+  if ((end == text) || (*end != '\0') || (errno == ERANGE))
+    {
+      cout << "Error: --" << name << " expects a number, not '" << it->second << "'" << endl;
+      exit(1);
+    }
+  return value;
+}
+
+
+void printOptions()
+{
+  for (map<string,string>::iterator it=options.begin(); it!=options.end(); it++)
+    {
+      cout << " --" << it->first;
+      if (!it->second.empty())
+	cout << " = \t" << it->second;
+      cout << endl;
+    }
+}
+
+
+map<string,string> allOptions()
+{
+  return options;
+}
+
+
+// Options that only control the run length (and --crn, whose seed
+// the cache and the decoder stream key separately):
+bool stoppingOption(const string & name)
+{
+  const char * names[] = { "frames", "min-frames", "relwidth", "target-fer", "ber", "confidence", "ci", "crn" };
+  for (int i=0; i<8; i++)
+    if (name == names[i])
+      return true;
+  return false;
+}
+
+
+// Summary of the switches understood by the simulators, appended
+// to each usage statement.
+string optionUsage()
+{
+  return string("Options:\n"
+		"  --reorder        relabel nodes with reverse Cuthill-McKee for cache locality\n"
+		"  --relwidth=r     stop when the FER confidence interval width is <= r*FER\n"
+		"  --ber            also apply --relwidth to the BER interval\n"
+		"  --target-fer=p   stop once the FER is shown to be below or above p\n"
+		"  --confidence=c   confidence level for the stopping rules (default 0.95)\n"
+		"  --ci=wilson|cp   Wilson (default) or Clopper-Pearson interval\n"
+		"  --frames=n       stop after n frames\n"
+		"  --min-frames=n   never stop before n frames\n"
+		"  --is-shift=m     importance sampling: shift channel noise mean by -m\n"
+		"  --is-scale=s     importance sampling: scale channel noise deviation by s\n"
+		"  --is-positions=f importance sampling: bias only the bit indices listed in f\n"
+		"  --checkpoints=a,b,...  also report results for iteration limits a, b, ...\n"
+		"  --crn=S          key each frame's random numbers by (S, frame index)\n"
+		"  --crn-decoder=k  key decoder noise by k instead of the binary and its parameters\n"
+		"  --outcomes=f     write per-frame outcomes to f for compareOutcomes\n"
+		"  --extrapolate=s1,s2,...  reweight frames to estimate FER/BER at these SNRs\n"
+		"  --snapshot=f     periodically save the run state to f (implies --crn)\n"
+		"  --snapshot-every=t  seconds between snapshots (default 600)\n"
+		"  --resume         continue the run saved in the --snapshot file\n"
+		"  --shard=k/K      simulate frames k, k+K, ... of --frames and write a shard record\n"
+		"  --merge-shards=K combine K shard records into the log row\n"
+		"  --cache=dir      reuse and extend results stored in dir for this point\n"
+		"  --corpus-out=f   append failed frames to the binary corpus f\n"
+		"  --corpus-in=f    decode the frames recorded in corpus f instead of simulating\n"
+		"  --sla            report per-frame decode latency percentiles and sustained frames/s\n"
+		"  --sla-rate=f     offer f frames/s to the decoder (default back-to-back)\n"
+		"  --sla-budget=us  count frames whose latency exceeds us microseconds\n"
+		"  --sla-cores=c    model c decoder cores sharing the offered frames (default 1)\n"
+		"  --status=f       keep a live JSON progress file at f (rewritten atomically)\n"
+		"  --status-every=t seconds between progress rewrites (default 10)\n"
+		"  --console-rate=n print at most n frame-error lines per second (default 10)\n"
+		"  --trace=f        NGDBFhw: write binary test-vector traces to f (see traceDump)\n"
+		"  --trace-frames=s trace failures (default), all, or frames a-b,c,...\n"
+		"  --trace-compress deflate trace records with zlib\n"
+		"  --llr-in=f       decode captured LLRs from file f (or - for stdin) until it ends\n"
+		"  --llr-format=t   f32 (default), f64, i8 or i16 values\n"
+		"  --llr-scale=s    multiply input values by s\n"
+		"  --llr-samples    input values are channel samples rather than LLRs\n"
+		"  --llr-out=f      write packed decisions for every --llr-in frame to f\n"
+		"A logfilename ending in .jsonl receives one JSON result record per run.\n");
+}
@@ -0,0 +1,87 @@
+/*==========================================================================================
+** outcomes.cpp
+** By Chris Winstead
+
+** Description:
+   Per-frame outcome files. See outcomes.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include "outcomes.h"
+#include "options.h"
+using namespace std;
+
+
+void openOutcomeFile(outcome_struct & out)
+{
+  out.fp = NULL;
+  if (!hasOption("outcomes"))
+    return;
+  string fileName = optionString("outcomes","");
+
+  // A resumed run keeps the records already written; the snapshot
+  // trims any written after it was taken.
+  if (hasOption("resume"))
+    {
+      out.fp = fopen(fileName.c_str(),"r+b");
+      if (out.fp != NULL)
+	{
+	  fseek(out.fp,0,SEEK_END);
+	  cout << "Appending per-frame outcomes to " << fileName << endl;
+	  return;
+	}
+    }
+
+  out.fp = fopen(fileName.c_str(),"wb");
+  if (out.fp == NULL)
+    {
+      cout << "Failed to open outcome file " << fileName << endl;
+      return;
+    }
+  fwrite(OUTCOME_MAGIC,1,8,out.fp);
+  cout << "Writing per-frame outcomes to " << fileName << endl;
+}
+
+
+void writeOutcome(outcome_struct & out, long frame, int errors, int iterations)
+{
+  if (out.fp == NULL)
+    return;
+  outcome_record rec;
+  rec.frame = frame;
+  rec.errors = errors;
+  rec.iterations = iterations;
+  fwrite(&rec,sizeof(rec),1,out.fp);
+}
+
+
+void closeOutcomeFile(outcome_struct & out)
+{
+  if (out.fp != NULL)
+    fclose(out.fp);
+  out.fp = NULL;
+}
+
+
+FILE * openOutcomeFileForReading(const char * fileName)
+{
+  FILE * fp = fopen(fileName,"rb");
+  if (fp == NULL)
+    return NULL;
+  char magic[8];
+  if ((fread(magic,1,8,fp) != 8) || (memcmp(magic,OUTCOME_MAGIC,8) != 0))
+    {
+      fclose(fp);
+      return NULL;
+    }
+  return fp;
+}
+
+
+int readOutcome(FILE * fp, outcome_record & rec)
+{
+  return (fread(&rec,sizeof(rec),1,fp) == 1);
+}
@@ -0,0 +1,150 @@
+/*==========================================================================================
+** perfcounters.cpp
+** By Chris Winstead
+
+** Description:
+   perf_event_open counter group for the decoding phases. See
+   perfcounters.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perfcounters.h"
+using namespace std;
+
+static const char * eventNames[PERF_EVENTS] = { "cycles", "instructions", "llc-misses", "branch-misses" };
+static const char * phaseNames[PERF_PHASES] = { "check", "symbol" };
+static const unsigned long long eventConfig[PERF_EVENTS] = {
+  PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+
+static int openEvent(unsigned long long config, int group)
+{
+  struct perf_event_attr attr;
+  memset(&attr,0,sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = (group == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(__NR_perf_event_open,&attr,0,-1,group,0);
+}
+
+
+void setupPerfCounters(perf_struct & P, alist_struct & H)
+{
+  P.enabled = 0;
+  P.leader = -1;
+  P.opened = 0;
+  P.frames = 0;
+  P.edges = 0;
+  for (int n=0; n<H.N; n++)
+    P.edges += H.num_nlist[n];
+  for (int p=0; p<PERF_PHASES; p++)
+    {
+      P.calls[p] = 0;
+      for (int e=0; e<PERF_EVENTS; e++)
+	P.counts[p][e] = 0;
+    }
+
+  for (int e=0; e<PERF_EVENTS; e++)
+    {
+      P.fd[e] = openEvent(eventConfig[e],P.leader);
+      P.slot[e] = -1;
+      if (P.fd[e] < 0)
+	continue;
+      if (P.leader == -1)
+	P.leader = P.fd[e];
+      P.slot[e] = P.opened++;
+    }
+  if (P.leader == -1)
+    {
+      cout << "Performance counters are not available (perf_event_open failed)." << endl;
+      return;
+    }
+  ioctl(P.leader,PERF_EVENT_IOC_RESET,PERF_IOC_FLAG_GROUP);
+  ioctl(P.leader,PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+  P.enabled = 1;
+  cout << "Performance counters:";
+  for (int e=0; e<PERF_EVENTS; e++)
+    if (P.slot[e] >= 0)
+      cout << " " << eventNames[e];
+  cout << endl;
+}
+
+
+// Group read: the number of counters, then one value per counter.
+static bool readGroup(perf_struct & P, unsigned long long * values)
+{
+  unsigned long long buf[1+PERF_EVENTS];
+  ssize_t want = (1+P.opened)*sizeof(unsigned long long);
+  if (read(P.leader,buf,want) != want)
+    return false;
+  for (int e=0; e<PERF_EVENTS; e++)
+    values[e] = (P.slot[e] >= 0) ? buf[1+P.slot[e]] : 0;
+  return true;
+}
+
+
+void perfBegin(perf_struct & P)
+{
+  if (P.enabled)
+    readGroup(P,P.start);
+}
+
+
+void perfEnd(perf_struct & P, int phase)
+{
+  if (!P.enabled)
+    return;
+  unsigned long long now[PERF_EVENTS];
+  if (!readGroup(P,now))
+    return;
+  for (int e=0; e<PERF_EVENTS; e++)
+    P.counts[phase][e] += now[e] - P.start[e];
+  P.calls[phase]++;
+}
+
+
+void reportPerfCounters(perf_struct & P, string logfilename, double SNR, const char * codeName)
+{
+  if (!P.enabled)
+    return;
+  for (int e=0; e<PERF_EVENTS; e++)
+    if (P.fd[e] >= 0)
+      close(P.fd[e]);
+
+  double frames = (P.frames > 0) ? P.frames : 1;
+  cout << "\nPerformance counters over " << P.frames << " frames, " << P.edges << " edges:\n"
+       << "\tphase\tevent\t\tcount\tper-frame\tper-edge\n";
+  string fileName = logfilename + ".perf";
+  ofstream of(fileName.c_str(),ios::app);
+  char tab = '\t';
+  for (int p=0; p<PERF_PHASES; p++)
+    {
+      double edgeVisits = (double) P.edges*P.calls[p];
+      if (edgeVisits <= 0)
+	continue;
+      for (int e=0; e<PERF_EVENTS; e++)
+	{
+	  if (P.slot[e] < 0)
+	    continue;
+	  unsigned long long n = P.counts[p][e];
+	  cout << "\t" << phaseNames[p] << "\t" << eventNames[e] << (string(eventNames[e]).size() < 8 ? "\t\t" : "\t")
+	       << n << "\t" << n/frames << "\t" << n/edgeVisits << endl;
+	  of << SNR << tab << phaseNames[p] << tab << eventNames[e] << tab << n << tab << n/frames << tab
+	     << n/edgeVisits << tab << P.frames << tab << P.calls[p] << tab << codeName << endl;
+	}
+      if ((P.slot[PERF_CYCLES] >= 0) && (P.slot[PERF_INSTRUCTIONS] >= 0) && (P.counts[p][PERF_CYCLES] > 0))
+	cout << "\t" << phaseNames[p] << "\tIPC\t\t" << (double) P.counts[p][PERF_INSTRUCTIONS]/P.counts[p][PERF_CYCLES] << endl;
+    }
+  of.close();
+}
@@ -0,0 +1,515 @@
+/*==========================================================================================
+** qc.cpp
+** By Chris Winstead
+
+** Description:
+   Quasi-cyclic code representation and block-rotation kernels.
+   See qc.h for the base-matrix conventions.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "qc.h"
+using namespace std;
+
+int tryQC(alist_struct & H, int Z, qc_struct & Q);
+int gcd(int a, int b);
+
+//============================================================//
+// Construction
+//============================================================//
+
+int detectQC(alist_struct & H, qc_struct & Q)
+{
+  int g = gcd(H.N,H.M);
+  for (int Z=g; Z>=QC_MIN_Z; Z--)
+    if (((g % Z) == 0) && tryQC(H,Z,Q))
+      return 1;
+  return 0;
+}
+
+
+// Check whether every Z x Z block of H is zero or a single
+// circulant permutation, recording the shifts if so.
+int tryQC(alist_struct & H, int Z, qc_struct & Q)
+{
+  int mb = H.M/Z;
+  int nb = H.N/Z;
+  vector<int> shift(mb*nb,-1);
+  vector<int> count(mb*nb,0);
+
+  for (int r=0; r<H.M; r++)
+    {
+      int rb = r/Z;
+      int t  = r%Z;
+      for (int j=0; j<H.num_mlist[r]; j++)
+	{
+	  int col = H.mlist[r][j]-1;
+	  int b = rb*nb + col/Z;
+	  int s = ((col%Z) - t + Z) % Z;
+	  if (count[b] == 0)
+	    {
+	      if (t != 0)
+		return 0;
+	      shift[b] = s;
+	    }
+	  else if ((shift[b] != s) || (count[b] != t))
+	    return 0;
+	  count[b]++;
+	}
+    }
+  for (int b=0; b<mb*nb; b++)
+    if ((count[b] != 0) && (count[b] != Z))
+      return 0;
+
+  Q.Z = Z;
+  Q.mb = mb;
+  Q.nb = nb;
+  Q.shift = shift;
+  setupQCBlocks(Q);
+  return 1;
+}
+
+
+void setupQCBlocks(qc_struct & Q)
+{
+  Q.M = Q.mb*Q.Z;
+  Q.N = Q.nb*Q.Z;
+  Q.eb_row.clear();
+  Q.eb_col.clear();
+  Q.eb_shift.clear();
+  Q.row_blocks.assign(Q.mb,vector<int>(0));
+  Q.col_blocks.assign(Q.nb,vector<int>(0));
+  for (int rb=0; rb<Q.mb; rb++)
+    for (int cb=0; cb<Q.nb; cb++)
+      {
+	int s = Q.shift[rb*Q.nb + cb];
+	if (s < 0)
+	  continue;
+	int e = Q.eb_row.size();
+	Q.eb_row.push_back(rb);
+	Q.eb_col.push_back(cb);
+	Q.eb_shift.push_back(s);
+	Q.row_blocks[rb].push_back(e);
+	Q.col_blocks[cb].push_back(e);
+      }
+  Q.E = Q.eb_row.size();
+}
+
+
+int isQCFileName(const char * fileName)
+{
+  int len = strlen(fileName);
+  return ((len > 3) && (strcmp(fileName+len-3,".qc") == 0));
+}
+
+
+int loadQCFile(const char * fileName, qc_struct & Q)
+{
+  ifstream theFile(fileName,ios::in);
+  if (!theFile)
+    {
+      cout << "Failed to open QC file " << fileName << endl;
+      return 0;
+    }
+
+  // Collect everything but comment lines:
+  stringstream body;
+  string line;
+  while (getline(theFile,line))
+    if ((line.size() > 0) && (line[0] != '#'))
+      body << line << "\n";
+
+  body >> Q.mb >> Q.nb >> Q.Z;
+  Q.shift.assign(Q.mb*Q.nb,-1);
+  for (int b=0; b<Q.mb*Q.nb; b++)
+    if (!(body >> Q.shift[b]) || (Q.shift[b] >= Q.Z))
+      {
+	cout << "Bad base matrix entry " << b << " in " << fileName << endl;
+	return 0;
+      }
+  setupQCBlocks(Q);
+  return 1;
+}
+
+
+void writeQCFile(const char * fileName, qc_struct & Q)
+{
+  ofstream of(fileName,ios::out);
+  of << "# Quasi-cyclic base matrix: N=" << Q.N << ", M=" << Q.M << ", Z=" << Q.Z << "\n";
+  of << "# mb nb Z, then mb rows of nb shifts (-1 = zero block)\n";
+  of << Q.mb << " " << Q.nb << " " << Q.Z << "\n";
+  for (int rb=0; rb<Q.mb; rb++)
+    {
+      for (int cb=0; cb<Q.nb; cb++)
+	of << Q.shift[rb*Q.nb + cb] << (cb < Q.nb-1 ? " " : "\n");
+    }
+  of.close();
+}
+
+
+// Expand the base matrix into an alist_struct with the same
+// allocation pattern as loadFile(), so freeAlist() applies.
+alist_struct qcToAlist(qc_struct & Q)
+{
+  alist_struct H;
+  int Z = Q.Z;
+  H.N = Q.N;
+  H.M = Q.M;
+  H.num_nlist = (int *) malloc(H.N*sizeof(int));
+  H.num_mlist = (int *) malloc(H.M*sizeof(int));
+  H.biggest_num_n = 0;
+  H.biggest_num_m = 0;
+  for (int cb=0; cb<Q.nb; cb++)
+    if (Q.col_blocks[cb].size() > H.biggest_num_n)
+      H.biggest_num_n = Q.col_blocks[cb].size();
+  for (int rb=0; rb<Q.mb; rb++)
+    if (Q.row_blocks[rb].size() > H.biggest_num_m)
+      H.biggest_num_m = Q.row_blocks[rb].size();
+
+  H.nlist = (int **) malloc(H.N*sizeof(int *));
+  H.mlist = (int **) malloc(H.M*sizeof(int *));
+  for (int n=0; n<H.N; n++)
+    {
+      int cb = n/Z;
+      int k  = n%Z;
+      H.nlist[n] = (int *) malloc(H.biggest_num_n*sizeof(int));
+      H.num_nlist[n] = Q.col_blocks[cb].size();
+      for (int j=0; j<H.num_nlist[n]; j++)
+	{
+	  int e = Q.col_blocks[cb][j];
+	  H.nlist[n][j] = Q.eb_row[e]*Z + (k - Q.eb_shift[e] + Z) % Z + 1;
+	}
+      for (int j=H.num_nlist[n]; j<H.biggest_num_n; j++)
+	H.nlist[n][j] = 0;
+    }
+  for (int m=0; m<H.M; m++)
+    {
+      int rb = m/Z;
+      int t  = m%Z;
+      H.mlist[m] = (int *) malloc(H.biggest_num_m*sizeof(int));
+      H.num_mlist[m] = Q.row_blocks[rb].size();
+      for (int j=0; j<H.num_mlist[m]; j++)
+	{
+	  int e = Q.row_blocks[rb][j];
+	  H.mlist[m][j] = Q.eb_col[e]*Z + (t + Q.eb_shift[e]) % Z + 1;
+	}
+      for (int j=H.num_mlist[m]; j<H.biggest_num_m; j++)
+	H.mlist[m][j] = 0;
+    }
+  H.biggest_num_n_alloc = H.biggest_num_n;
+  H.biggest_num_m_alloc = H.biggest_num_m;
+  H.l_up_to = NULL;
+  H.u_up_to = NULL;
+  H.norder = NULL;
+  H.tot = 0;
+  H.same_length = 0;
+  return H;
+}
+
+
+int gcd(int a, int b)
+{
+  while (b != 0)
+    {
+      int tmp = a % b;
+      a = b;
+      b = tmp;
+    }
+  return a;
+}
+
+
+//============================================================//
+// Block kernels
+//============================================================//
+
+// dst[t] = src[(t+s)%Z]
+inline void rotateGather(const double * src, double * dst, int Z, int s)
+{
+  int n1 = Z - s;
+  for (int t=0; t<n1; t++)
+    dst[t] = src[t+s];
+  for (int t=n1; t<Z; t++)
+    dst[t] = src[t-n1];
+}
+
+// dst[(t+s)%Z] += src[t]
+inline void rotateScatterAdd(double * dst, const double * src, int Z, int s)
+{
+  int n1 = Z - s;
+  for (int t=0; t<n1; t++)
+    dst[t+s] += src[t];
+  for (int t=n1; t<Z; t++)
+    dst[t-n1] += src[t];
+}
+
+
+void setupQCMessages(qc_struct & Q, vector<double> & msgs)
+{
+  msgs.assign(Q.E*Q.Z,0.0);
+}
+
+
+void initializeQCMessages(qc_struct & Q, vector<double> & sym_to_check, vector<double> & y)
+{
+  for (int e=0; e<Q.E; e++)
+    rotateGather(&y[Q.eb_col[e]*Q.Z], &sym_to_check[e*Q.Z], Q.Z, Q.eb_shift[e]);
+}
+
+
+void qcMinSumCheckUpdates(qc_struct & Q, vector<double> & sym_to_check, vector<double> & check_to_sym)
+{
+  int Z = Q.Z;
+  vector<double> minMag(Z), minMag2(Z), prod(Z);
+  vector<int> minIdx(Z);
+
+  for (int rb=0; rb<Q.mb; rb++)
+    {
+      vector<int> & blocks = Q.row_blocks[rb];
+      for (int t=0; t<Z; t++)
+	{
+	  minMag[t]  = INFINITY;
+	  minMag2[t] = INFINITY;
+	  prod[t]    = 1.0;
+	  minIdx[t]  = -1;
+	}
+      for (int k=0; k<blocks.size(); k++)
+	{
+	  const double * msg = &sym_to_check[blocks[k]*Z];
+	  for (int t=0; t<Z; t++)
+	    {
+	      double mag = fabs(msg[t]);
+	      if (msg[t] < 0.0)
+		prod[t] = -prod[t];
+	      if (mag <= minMag[t])
+		{
+		  minMag2[t] = minMag[t];
+		  minMag[t]  = mag;
+		  minIdx[t]  = k;
+		}
+	      else if (mag < minMag2[t])
+		minMag2[t] = mag;
+	    }
+	}
+      for (int k=0; k<blocks.size(); k++)
+	{
+	  const double * msg = &sym_to_check[blocks[k]*Z];
+	  double * out = &check_to_sym[blocks[k]*Z];
+	  for (int t=0; t<Z; t++)
+	    {
+	      double mag = (minIdx[t] == k) ? minMag2[t] : minMag[t];
+	      out[t] = (msg[t] < 0.0) ? -prod[t]*mag : prod[t]*mag;
+	    }
+	}
+    }
+}
+
+
+// Sum-product check update. The product over all other edges is
+// formed from prefix and suffix products to avoid dividing by
+// small tanh values.
+void qcBPCheckUpdates(qc_struct & Q, vector<double> & sym_to_check, vector<double> & check_to_sym)
+{
+  int Z = Q.Z;
+  vector<double> th, suffix;
+
+  for (int rb=0; rb<Q.mb; rb++)
+    {
+      vector<int> & blocks = Q.row_blocks[rb];
+      int dc = blocks.size();
+      th.resize(dc*Z);
+      suffix.assign((dc+1)*Z,1.0);
+      for (int k=0; k<dc; k++)
+	{
+	  const double * msg = &sym_to_check[blocks[k]*Z];
+	  for (int t=0; t<Z; t++)
+	    th[k*Z+t] = tanh(msg[t]/2.0);
+	}
+      for (int k=dc-1; k>=0; k--)
+	for (int t=0; t<Z; t++)
+	  suffix[k*Z+t] = suffix[(k+1)*Z+t]*th[k*Z+t];
+
+      vector<double> prefix(Z,1.0);
+      for (int k=0; k<dc; k++)
+	{
+	  double * out = &check_to_sym[blocks[k]*Z];
+	  for (int t=0; t<Z; t++)
+	    {
+	      double p = prefix[t]*suffix[(k+1)*Z+t];
+	      out[t] = log((1.0+p)/(1.0-p));
+	      prefix[t] *= th[k*Z+t];
+	    }
+	}
+    }
+}
+
+
+// Symbol update shared by min-sum and BP. Outgoing messages are
+// clipped to +/-maxLLR when maxLLR > 0.
+void qcSymNodeUpdates(qc_struct & Q, vector<double> & y, vector<int> & d, vector<double> & sym_to_check, vector<double> & check_to_sym, double maxLLR)
+{
+  int Z = Q.Z;
+  vector<double> sum(y);
+  vector<double> rotated(Z);
+
+  for (int e=0; e<Q.E; e++)
+    rotateScatterAdd(&sum[Q.eb_col[e]*Z], &check_to_sym[e*Z], Z, Q.eb_shift[e]);
+
+  for (int e=0; e<Q.E; e++)
+    {
+      rotateGather(&sum[Q.eb_col[e]*Z], &rotated[0], Z, Q.eb_shift[e]);
+      const double * in = &check_to_sym[e*Z];
+      double * out = &sym_to_check[e*Z];
+      for (int t=0; t<Z; t++)
+	{
+	  double msg = rotated[t] - in[t];
+	  if ((maxLLR > 0) && (fabs(msg) > maxLLR))
+	    msg = (msg < 0.0) ? -maxLLR : maxLLR;
+	  out[t] = msg;
+	}
+    }
+
+  for (int i=0; i<Q.N; i++)
+    d[i] = (sum[i] > 0) ? 1 : -1;
+}
+
+
+//============================================================//
+// Bit-vector kernels
+//============================================================//
+
+int qcWords(qc_struct & Q)
+{
+  return (Q.Z + QCWORD_BITS - 1)/QCWORD_BITS;
+}
+
+// dst[t] = src[(t+s)%Z] on Z-bit vectors packed in W words.
+inline void rotateBits(const qcword * src, qcword * dst, int Z, int W, int s)
+{
+  if (W == 1)
+    {
+      qcword mask = (Z == QCWORD_BITS) ? ~((qcword) 0) : ((((qcword) 1) << Z) - 1);
+      dst[0] = (s == 0) ? src[0] : (((src[0] >> s) | (src[0] << (Z-s))) & mask);
+      return;
+    }
+
+  // General case: (src >> s) | (src << (Z-s)), masked to Z bits.
+  int ls = Z - s;
+  for (int i=0; i<W; i++)
+    {
+      int ws = s/QCWORD_BITS, bs = s%QCWORD_BITS;
+      qcword lo = (i+ws < W)   ? src[i+ws]   : 0;
+      qcword hi = (i+ws+1 < W) ? src[i+ws+1] : 0;
+      qcword a = bs ? ((lo >> bs) | (hi << (QCWORD_BITS-bs))) : lo;
+
+      int wl = ls/QCWORD_BITS, bl = ls%QCWORD_BITS;
+      qcword cur  = (i-wl >= 0)   ? src[i-wl]   : 0;
+      qcword prev = (i-wl-1 >= 0) ? src[i-wl-1] : 0;
+      qcword b = bl ? ((cur << bl) | (prev >> (QCWORD_BITS-bl))) : cur;
+
+      dst[i] = a | b;
+    }
+  int tail = Z % QCWORD_BITS;
+  if (tail)
+    dst[W-1] &= (((qcword) 1) << tail) - 1;
+}
+
+
+void packQCSymbols(qc_struct & Q, vector<int> & d, int one, vector<qcword> & dbits)
+{
+  int W = qcWords(Q);
+  dbits.assign(Q.nb*W,0);
+  for (int i=0; i<Q.N; i++)
+    if (d[i] == one)
+      {
+	int k = i%Q.Z;
+	dbits[(i/Q.Z)*W + k/QCWORD_BITS] |= ((qcword) 1) << (k%QCWORD_BITS);
+      }
+}
+
+
+void unpackQCChecks(qc_struct & Q, vector<qcword> & sbits, vector<int> & syndrome)
+{
+  int W = qcWords(Q);
+  for (int m=0; m<Q.M; m++)
+    {
+      int t = m%Q.Z;
+      syndrome[m] = (sbits[(m/Q.Z)*W + t/QCWORD_BITS] >> (t%QCWORD_BITS)) & 1;
+    }
+}
+
+
+// Syndrome of each block row as the XOR of rotated decision
+// vectors. Returns 1 if every check is satisfied.
+int qcSyndrome(qc_struct & Q, vector<qcword> & dbits, vector<qcword> & sbits)
+{
+  int W = qcWords(Q);
+  vector<qcword> rotated(W);
+  qcword any = 0;
+
+  sbits.assign(Q.mb*W,0);
+  for (int rb=0; rb<Q.mb; rb++)
+    {
+      qcword * acc = &sbits[rb*W];
+      for (int k=0; k<Q.row_blocks[rb].size(); k++)
+	{
+	  int e = Q.row_blocks[rb][k];
+	  rotateBits(&dbits[Q.eb_col[e]*W], &rotated[0], Q.Z, W, Q.eb_shift[e]);
+	  for (int w=0; w<W; w++)
+	    acc[w] ^= rotated[w];
+	}
+      for (int w=0; w<W; w++)
+	any |= acc[w];
+    }
+  return (any == 0);
+}
+
+
+// Number of unsatisfied checks adjacent to each symbol. Syndrome
+// vectors are rotated back into symbol order and summed into
+// bit-sliced counters, Z symbols at a time.
+void qcUnsatisfiedCounts(qc_struct & Q, vector<qcword> & sbits, vector<int> & counts)
+{
+  int W = qcWords(Q);
+  vector<qcword> rotated(W);
+  vector<qcword> planes(QC_MAX_PLANES*W);
+
+  for (int cb=0; cb<Q.nb; cb++)
+    {
+      int numPlanes = 1;
+      while ((1 << numPlanes) <= Q.col_blocks[cb].size())
+	numPlanes++;
+
+      planes.assign(QC_MAX_PLANES*W,0);
+      for (int k=0; k<Q.col_blocks[cb].size(); k++)
+	{
+	  int e = Q.col_blocks[cb][k];
+	  rotateBits(&sbits[Q.eb_row[e]*W], &rotated[0], Q.Z, W, (Q.Z - Q.eb_shift[e]) % Q.Z);
+	  for (int w=0; w<W; w++)
+	    {
+	      qcword carry = rotated[w];
+	      for (int p=0; (p<numPlanes) && carry; p++)
+		{
+		  qcword next = planes[p*W + w] & carry;
+		  planes[p*W + w] ^= carry;
+		  carry = next;
+		}
+	    }
+	}
+
+      for (int k=0; k<Q.Z; k++)
+	{
+	  int count = 0;
+	  for (int p=0; p<numPlanes; p++)
+	    count |= ((planes[p*W + k/QCWORD_BITS] >> (k%QCWORD_BITS)) & 1) << p;
+	  counts[cb*Q.Z + k] = count;
+	}
+    }
+}
@@ -0,0 +1,116 @@
+/*==========================================================================================
+** regular.cpp
+** By Chris Winstead
+
+** Description:
+   Edge tables and kernel selection for the degree-specialized
+   min-sum decoder. See regular.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <vector>
+#include "regular.h"
+using namespace std;
+
+static int edgeSlot(int list[], int len, int node)
+{
+  for (int j=0; j<len; j++)
+    if (list[j]-1 == node)
+      return j;
+  return -1;
+}
+
+// Degrees with compiled instantiations. These cover the regular
+// sides of the codes in ../codes (dv 3,4,6 and dc 8,32) plus a few
+// common neighbours.
+regular_check_fn selectCheckKernel(int dc)
+{
+  switch (dc)
+    {
+    case 6:  return regularMinSumCheckUpdates<6>;
+    case 7:  return regularMinSumCheckUpdates<7>;
+    case 8:  return regularMinSumCheckUpdates<8>;
+    case 16: return regularMinSumCheckUpdates<16>;
+    case 32: return regularMinSumCheckUpdates<32>;
+    default: return NULL;
+    }
+}
+
+regular_sym_fn selectSymKernel(int dv)
+{
+  switch (dv)
+    {
+    case 3: return regularSymNodeUpdates<3>;
+    case 4: return regularSymNodeUpdates<4>;
+    case 5: return regularSymNodeUpdates<5>;
+    case 6: return regularSymNodeUpdates<6>;
+    default: return NULL;
+    }
+}
+
+
+// Build the flat edge tables and choose kernels. Returns 1 if at
+// least one side of the graph has a specialized instantiation.
+int detectRegular(alist_struct & H, regular_struct & G)
+{
+  G.N = H.N;
+  G.M = H.M;
+  G.dv = H.num_nlist[0];
+  G.dc = H.num_mlist[0];
+  G.max_dv = 0;
+  G.max_dc = 0;
+
+  G.sym_start.assign(H.N+1,0);
+  for (int i=0; i<H.N; i++)
+    {
+      if (H.num_nlist[i] != G.dv)
+	G.dv = 0;
+      if (H.num_nlist[i] > G.max_dv)
+	G.max_dv = H.num_nlist[i];
+      G.sym_start[i+1] = G.sym_start[i] + H.num_nlist[i];
+    }
+  G.check_start.assign(H.M+1,0);
+  for (int m=0; m<H.M; m++)
+    {
+      if (H.num_mlist[m] != G.dc)
+	G.dc = 0;
+      if (H.num_mlist[m] > G.max_dc)
+	G.max_dc = H.num_mlist[m];
+      G.check_start[m+1] = G.check_start[m] + H.num_mlist[m];
+    }
+  G.E = G.sym_start[H.N];
+
+  regular_check_fn checkKernel = selectCheckKernel(G.dc);
+  regular_sym_fn symKernel = selectSymKernel(G.dv);
+  if ((checkKernel == NULL) && (symKernel == NULL))
+    return 0;
+  G.minSumCheckUpdates = checkKernel ? checkKernel : regularMinSumCheckUpdates<0>;
+  G.symNodeUpdates = symKernel ? symKernel : regularSymNodeUpdates<0>;
+
+  G.check_edges.assign(G.E,0);
+  G.sym_edges.assign(G.E,0);
+  for (int m=0; m<H.M; m++)
+    for (int k=0; k<H.num_mlist[m]; k++)
+      {
+	int snode = H.mlist[m][k]-1;
+	int j = edgeSlot(H.nlist[snode], H.num_nlist[snode], m);
+	G.check_edges[G.check_start[m]+k] = G.sym_start[snode]+j;
+	G.sym_edges[G.sym_start[snode]+j] = G.check_start[m]+k;
+      }
+  return 1;
+}
+
+
+void setupRegularMessages(regular_struct & G, vector<double> & sym_to_check, vector<double> & check_to_sym)
+{
+  sym_to_check.assign(G.E,0.0);
+  check_to_sym.assign(G.E,0.0);
+}
+
+
+void initializeRegularMessages(regular_struct & G, vector<double> & sym_to_check, vector<double> & y)
+{
+  for (int i=0; i<G.N; i++)
+    for (int j=G.sym_start[i]; j<G.sym_start[i+1]; j++)
+      sym_to_check[j] = y[i];
+}
@@ -0,0 +1,233 @@
+/*==========================================================================================
+** reorder.cpp
+** By Chris Winstead
+
+** Description:
+   Reverse Cuthill-McKee relabelling of the Tanner graph. See
+   reorder.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "reorder.h"
+using namespace std;
+
+// Nodes 0..N-1 are symbols, N..N+M-1 are checks.
+void graphNeighbours(alist_struct & H, int node, vector<int> & nbrs);
+int  graphDegree(alist_struct & H, int node);
+int  bfsLevels(alist_struct & H, int root, vector<int> & level, vector<int> & order);
+
+//============================================================//
+// Ordering
+//============================================================//
+
+void computeRCMOrder(alist_struct & H, reorder_struct & P)
+{
+  int T = H.N + H.M;
+  vector<char> visited(T,0);
+  vector<int> order;
+  vector<int> level(T,-1);
+  vector<int> component;
+  vector<int> nbrs;
+  order.reserve(T);
+
+  while (order.size() < T)
+    {
+      // Start each component from its lowest-degree unvisited node:
+      int root = -1;
+      for (int v=0; v<T; v++)
+	if (!visited[v] && ((root < 0) || (graphDegree(H,v) < graphDegree(H,root))))
+	  root = v;
+
+      // Walk to a pseudo-peripheral node:
+      int ecc = bfsLevels(H,root,level,component);
+      for (int pass=0; pass<4; pass++)
+	{
+	  int candidate = -1;
+	  for (int k=0; k<component.size(); k++)
+	    {
+	      int v = component[k];
+	      if ((level[v] == ecc) && ((candidate < 0) || (graphDegree(H,v) < graphDegree(H,candidate))))
+		candidate = v;
+	    }
+	  int newEcc = bfsLevels(H,candidate,level,component);
+	  if (newEcc <= ecc)
+	    break;
+	  root = candidate;
+	  ecc = newEcc;
+	}
+
+      // Cuthill-McKee breadth-first numbering:
+      int head = order.size();
+      order.push_back(root);
+      visited[root] = 1;
+      while (head < order.size())
+	{
+	  int v = order[head++];
+	  graphNeighbours(H,v,nbrs);
+	  vector<pair<int,int> > next;
+	  for (int k=0; k<nbrs.size(); k++)
+	    if (!visited[nbrs[k]])
+	      {
+		visited[nbrs[k]] = 1;
+		next.push_back(make_pair(graphDegree(H,nbrs[k]),nbrs[k]));
+	      }
+	  sort(next.begin(),next.end());
+	  for (int k=0; k<next.size(); k++)
+	    order.push_back(next[k].second);
+	}
+    }
+  reverse(order.begin(),order.end());
+
+  P.sym_order.clear();
+  P.check_order.clear();
+  for (int k=0; k<T; k++)
+    {
+      if (order[k] < H.N)
+	P.sym_order.push_back(order[k]);
+      else
+	P.check_order.push_back(order[k]-H.N);
+    }
+  P.sym_index.assign(H.N,0);
+  P.check_index.assign(H.M,0);
+  for (int i=0; i<H.N; i++)
+    P.sym_index[P.sym_order[i]] = i;
+  for (int i=0; i<H.M; i++)
+    P.check_index[P.check_order[i]] = i;
+}
+
+
+// Breadth-first search from root over the root's component.
+// Returns the eccentricity of root.
+int bfsLevels(alist_struct & H, int root, vector<int> & level, vector<int> & order)
+{
+  vector<int> nbrs;
+  for (int k=0; k<order.size(); k++)
+    level[order[k]] = -1;
+  order.clear();
+  order.push_back(root);
+  level[root] = 0;
+  int ecc = 0;
+  for (int head=0; head<order.size(); head++)
+    {
+      int v = order[head];
+      graphNeighbours(H,v,nbrs);
+      for (int k=0; k<nbrs.size(); k++)
+	if (level[nbrs[k]] < 0)
+	  {
+	    level[nbrs[k]] = level[v]+1;
+	    ecc = level[nbrs[k]];
+	    order.push_back(nbrs[k]);
+	  }
+    }
+  return ecc;
+}
+
+
+void graphNeighbours(alist_struct & H, int node, vector<int> & nbrs)
+{
+  nbrs.clear();
+  if (node < H.N)
+    for (int j=0; j<H.num_nlist[node]; j++)
+      nbrs.push_back(H.N + H.nlist[node][j]-1);
+  else
+    for (int j=0; j<H.num_mlist[node-H.N]; j++)
+      nbrs.push_back(H.mlist[node-H.N][j]-1);
+}
+
+
+int graphDegree(alist_struct & H, int node)
+{
+  if (node < H.N)
+    return H.num_nlist[node];
+  return H.num_mlist[node-H.N];
+}
+
+
+//============================================================//
+// Relabelling
+//============================================================//
+
+// Build the relabelled matrix with the same allocation pattern as
+// loadFile(), so freeAlist() applies. Each row and column list is
+// sorted so that gathers proceed in increasing address order.
+alist_struct permuteAlist(alist_struct & H, reorder_struct & P)
+{
+  alist_struct G;
+  G.N = H.N;
+  G.M = H.M;
+  G.biggest_num_n = H.biggest_num_n;
+  G.biggest_num_m = H.biggest_num_m;
+  G.biggest_num_n_alloc = H.biggest_num_n;
+  G.biggest_num_m_alloc = H.biggest_num_m;
+  G.num_nlist = (int *) malloc(G.N*sizeof(int));
+  G.num_mlist = (int *) malloc(G.M*sizeof(int));
+  G.nlist = (int **) malloc(G.N*sizeof(int *));
+  G.mlist = (int **) malloc(G.M*sizeof(int *));
+
+  vector<int> entries;
+  for (int n=0; n<G.N; n++)
+    {
+      int old = P.sym_order[n];
+      entries.clear();
+      for (int j=0; j<H.num_nlist[old]; j++)
+	entries.push_back(P.check_index[H.nlist[old][j]-1]+1);
+      sort(entries.begin(),entries.end());
+      G.num_nlist[n] = entries.size();
+      G.nlist[n] = (int *) malloc(G.biggest_num_n*sizeof(int));
+      for (int j=0; j<G.biggest_num_n; j++)
+	G.nlist[n][j] = (j < entries.size()) ? entries[j] : 0;
+    }
+  for (int m=0; m<G.M; m++)
+    {
+      int old = P.check_order[m];
+      entries.clear();
+      for (int j=0; j<H.num_mlist[old]; j++)
+	entries.push_back(P.sym_index[H.mlist[old][j]-1]+1);
+      sort(entries.begin(),entries.end());
+      G.num_mlist[m] = entries.size();
+      G.mlist[m] = (int *) malloc(G.biggest_num_m*sizeof(int));
+      for (int j=0; j<G.biggest_num_m; j++)
+	G.mlist[m][j] = (j < entries.size()) ? entries[j] : 0;
+    }
+  G.l_up_to = NULL;
+  G.u_up_to = NULL;
+  G.norder = NULL;
+  G.tot = 0;
+  G.same_length = 0;
+  return G;
+}
+
+
+void reorderCode(alist_struct & H, reorder_struct & P)
+{
+  double before = averageCheckSpan(H);
+  computeRCMOrder(H,P);
+  alist_struct G = permuteAlist(H,P);
+  freeAlist(H);
+  H = G;
+  cout << "Reordered nodes (RCM): average check span " << before << " -> " << averageCheckSpan(H) << endl;
+}
+
+
+// Mean distance between the first and last symbol of each check,
+// a rough measure of the gather footprint.
+double averageCheckSpan(alist_struct & H)
+{
+  double total = 0;
+  for (int m=0; m<H.M; m++)
+    {
+      int lo = H.N, hi = -1;
+      for (int j=0; j<H.num_mlist[m]; j++)
+	{
+	  int s = H.mlist[m][j]-1;
+	  lo = min(lo,s);
+	  hi = max(hi,s);
+	}
+      if (hi >= lo)
+	total += hi-lo;
+    }
+  return total/H.M;
+}
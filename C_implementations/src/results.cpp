@@ -0,0 +1,289 @@
+/*==========================================================================================
+** results.cpp
+** By Chris Winstead
+
+** Description:
+   JSON Lines result records. See results.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "results.h"
+#include "options.h"
+using namespace std;
+
+
+string jsonString(const string & s)
+{
+  string out = "\"";
+  for (size_t i=0; i<s.size(); i++)
+    {
+      unsigned char ch = s[i];
+      if ((ch == '"') || (ch == '\\'))
+	{
+	  out += '\\';
+	  out += ch;
+	}
+      else if (ch == '\n')
+	out += "\\n";
+      else if (ch == '\t')
+	out += "\\t";
+      else if (ch < 0x20)
+	{
+	  char buf[8];
+	  snprintf(buf,sizeof(buf),"\\u%04x",ch);
+	  out += buf;
+	}
+      else
+	out += ch;
+    }
+  return out + "\"";
+}
+
+
+// Round-trip precision; JSON has no NaN or infinities.
+string jsonNumber(double v)
+{
+  if (!isfinite(v))
+    return "null";
+  char buf[32];
+  snprintf(buf,sizeof(buf),"%.15g",v);
+  if (strtod(buf,NULL) != v)
+    snprintf(buf,sizeof(buf),"%.17g",v);
+  return buf;
+}
+
+
+string jsonNumber(long v)
+{
+  ostringstream s;
+  s << v;
+  return s.str();
+}
+
+
+template <class T>
+static string jsonArray(const vector<T> & v)
+{
+  string out = "[";
+  for (size_t i=0; i<v.size(); i++)
+    {
+      if (i > 0)
+	out += ",";
+      out += jsonNumber(v[i]);
+    }
+  return out + "]";
+}
+
+
+// Appends "name":value to an object under construction.
+static void member(string & obj, const string & name, const string & value)
+{
+  if (obj.size() > 1)
+    obj += ",";
+  obj += jsonString(name) + ":" + value;
+}
+
+
+int isJsonLog(const string & logfilename)
+{
+  size_t n = logfilename.size();
+  return (n >= 6) && (logfilename.compare(n-6,6,".jsonl") == 0);
+}
+
+
+void setupResult(result_struct & res, const char * decoder, const char * code, double SNR, long totalWords)
+{
+  string name(decoder);
+  size_t slash = name.find_last_of('/');
+  res.decoder = (slash == string::npos) ? name : name.substr(slash+1);
+  res.code = code;
+  res.SNR = SNR;
+  res.started = time(0);
+  res.start = chrono::steady_clock::now();
+  res.startWords = totalWords;
+  res.params.clear();
+}
+
+
+void resultParam(result_struct & res, const char * name, int v)
+{
+  res.params.push_back(make_pair(string(name),jsonNumber((long) v)));
+}
+
+
+void resultParam(result_struct & res, const char * name, long v)
+{
+  res.params.push_back(make_pair(string(name),jsonNumber(v)));
+}
+
+
+void resultParam(result_struct & res, const char * name, double v)
+{
+  res.params.push_back(make_pair(string(name),jsonNumber(v)));
+}
+
+
+void resultParam(result_struct & res, const char * name, const char * v)
+{
+  res.params.push_back(make_pair(string(name),jsonString(v)));
+}
+
+
+bool writeResultRecord(result_struct & res, string logfilename, snapshot_struct & snap, stopping_struct & stop,
+		       is_struct & IS, sla_struct & sla, long errors, long totalBits, long wordErrors, long totalWords, long totalIterations)
+{
+  string params = "{";
+  for (size_t i=0; i<res.params.size(); i++)
+    member(params,res.params[i].first,res.params[i].second);
+
+  // Empty vectors belong to modules that are switched off.
+  string counters = "{", histograms = "{";
+  for (size_t i=0; i<snap.fields.size(); i++)
+    {
+      snapshot_field & f = snap.fields[i];
+      if (((f.type == SNAP_VINT) && ((vector<int> *) f.p)->empty())
+	  || ((f.type == SNAP_VLONG) && ((vector<long> *) f.p)->empty())
+	  || (((f.type == SNAP_VDOUBLE) || (f.type == SNAP_VMEAN)) && ((vector<double> *) f.p)->empty()))
+	continue;
+      switch (f.type)
+	{
+	case SNAP_INT:     member(counters,f.name,jsonNumber((long) *(int *) f.p)); break;
+	case SNAP_LONG:    member(counters,f.name,jsonNumber(*(long *) f.p)); break;
+	case SNAP_DOUBLE:  member(counters,f.name,jsonNumber(*(double *) f.p)); break;
+	case SNAP_SEED:    member(params,f.name,jsonNumber((long) *(unsigned long long *) f.p)); break;
+	case SNAP_VINT:
+	  {
+	    vector<int> & v = *(vector<int> *) f.p;
+	    member(histograms,f.name,jsonArray(vector<long>(v.begin(),v.end())));
+	    break;
+	  }
+	case SNAP_VLONG:   member(histograms,f.name,jsonArray(*(vector<long> *) f.p)); break;
+	case SNAP_VDOUBLE:
+	case SNAP_VMEAN:   member(histograms,f.name,jsonArray(*(vector<double> *) f.p)); break;
+	default: break;   // file positions are not results
+	}
+    }
+  params += "}";
+  counters += "}";
+  histograms += "}";
+
+  string options = "{";
+  map<string,string> opts = allOptions();
+  for (map<string,string>::iterator it=opts.begin(); it!=opts.end(); it++)
+    member(options,it->first,jsonString(it->second));
+  options += "}";
+
+  double elapsed = chrono::duration<double>(chrono::steady_clock::now() - res.start).count();
+  long runWords = totalWords - res.startWords;
+  double ferLow, ferHigh, berLow, berHigh;
+  confidenceInterval(stop,totalWords,wordErrors,ferLow,ferHigh);
+  confidenceInterval(stop,totalBits,errors,berLow,berHigh);
+  string metrics = "{";
+  member(metrics,"ber",jsonNumber((double) errors/totalBits));
+  member(metrics,"fer",jsonNumber((double) wordErrors/totalWords));
+  member(metrics,"fer_lower",jsonNumber(ferLow));
+  member(metrics,"fer_upper",jsonNumber(ferHigh));
+  member(metrics,"ber_lower",jsonNumber(berLow));
+  member(metrics,"ber_upper",jsonNumber(berHigh));
+  member(metrics,"confidence",jsonNumber(stop.confidence));
+  member(metrics,"avg_iterations",jsonNumber((double) totalIterations/totalWords));
+  member(metrics,"elapsed_s",jsonNumber(elapsed));
+  member(metrics,"frames_this_run",jsonNumber(runWords));
+  member(metrics,"frames_per_s",jsonNumber((elapsed > 0) ? runWords/elapsed : 0.0));
+  metrics += "}";
+
+  string record = "{";
+  member(record,"schema",jsonNumber((long) RESULT_SCHEMA));
+  member(record,"decoder",jsonString(res.decoder));
+  member(record,"code",jsonString(res.code));
+  member(record,"snr",jsonNumber(res.SNR));
+  member(record,"time",jsonNumber((long) res.started));
+  member(record,"params",params);
+  member(record,"options",options);
+  member(record,"counters",counters);
+  member(record,"histograms",histograms);
+  member(record,"metrics",metrics);
+
+  if (IS.enabled)
+    {
+      double fer, ferStd, ber, berStd;
+      isEstimates(IS,fer,ferStd,ber,berStd);
+      string is = "{";
+      member(is,"shift",jsonNumber(IS.shift));
+      member(is,"scale",jsonNumber(IS.scale));
+      member(is,"fer",jsonNumber(fer));
+      member(is,"fer_std",jsonNumber(ferStd));
+      long w = totalWords, we = wordErrors, b = totalBits, be = errors;
+      stoppingCounts(stop,w,we,b,be);
+      confidenceInterval(stop,w,we,ferLow,ferHigh);
+      member(is,"fer_lower",jsonNumber(ferLow));
+      member(is,"fer_upper",jsonNumber(ferHigh));
+      member(is,"ber",jsonNumber(ber));
+      member(is,"ber_std",jsonNumber(berStd));
+      member(is,"effective_samples",jsonNumber(isEffectiveSampleSize(IS)));
+      member(record,"importance_sampling",is + "}");
+    }
+
+  if (sla.enabled && (sla.frames > 0))
+    {
+      string lat = "{";
+      member(lat,"rate",jsonNumber(sla.rate));
+      member(lat,"cores",jsonNumber((long) sla.cores));
+      member(lat,"budget_us",jsonNumber(sla.budget*1e6));
+      member(lat,"frames",jsonNumber(sla.frames));
+      member(lat,"frames_per_s",jsonNumber((sla.makespan > 0) ? sla.frames/sla.makespan : 0.0));
+      member(lat,"utilization",jsonNumber((sla.makespan > 0) ? sla.busy/(sla.cores*sla.makespan) : 0.0));
+      member(lat,"p50_us",jsonNumber(slaPercentile(sla.latency,0.5)));
+      member(lat,"p90_us",jsonNumber(slaPercentile(sla.latency,0.9)));
+      member(lat,"p99_us",jsonNumber(slaPercentile(sla.latency,0.99)));
+      member(lat,"p999_us",jsonNumber(slaPercentile(sla.latency,0.999)));
+      member(lat,"max_us",jsonNumber(sla.latency.maxValue/1e3));
+      member(lat,"service_p50_us",jsonNumber(slaPercentile(sla.service,0.5)));
+      member(lat,"service_p99_us",jsonNumber(slaPercentile(sla.service,0.99)));
+      member(lat,"misses",jsonNumber(sla.misses));
+      member(lat,"service_misses",jsonNumber(sla.serviceMisses));
+      member(record,"latency",lat + "}");
+    }
+  record += "}\n";
+
+  // One write under an exclusive lock: O_APPEND alone does not make
+  // large writes atomic on every filesystem.
+  int fd = open(logfilename.c_str(),O_WRONLY|O_APPEND|O_CREAT,0666);
+  if (fd < 0)
+    {
+      cout << "Could not open result file " << logfilename << endl;
+      return false;
+    }
+  flock(fd,LOCK_EX);
+  size_t done = 0;
+  while (done < record.size())
+    {
+      ssize_t n = write(fd,record.data()+done,record.size()-done);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  break;
+	}
+      done += n;
+    }
+  flock(fd,LOCK_UN);
+  close(fd);
+  if (done < record.size())
+    {
+      cout << "Short write to result file " << logfilename << endl;
+      return false;
+    }
+  return true;
+}
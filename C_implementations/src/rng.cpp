@@ -0,0 +1,109 @@
+/*==========================================================================================
+** rng.cpp
+** By Chris Winstead
+
+** Description:
+   Counter-based per-frame seeding. See rng.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "rng.h"
+#include "rand.h"
+#include "options.h"
+using namespace std;
+
+
+// Finalizer from Steele, Lea and Flood's SplitMix64.
+unsigned long long splitmix64(unsigned long long x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+
+int ran_keyed = 0;
+static unsigned long long ranKey = 0;
+static unsigned long long ranCount = 0;
+
+
+// Draw ranCount of the current frame's sequence, as 31 bits like random():
+long ran_keyed_next()
+{
+  return (long) (splitmix64(ranKey + 0x9E3779B97F4A7C15ULL*(ranCount++)) >> 33);
+}
+
+
+unsigned long long frameKey(unsigned long long seed, int stream, long frame)
+{
+  unsigned long long h = splitmix64(seed);
+  h = splitmix64(h ^ (unsigned long long) stream);
+  return splitmix64(h ^ (unsigned long long) frame);
+}
+
+
+void setupCommonRandomNumbers(crn_struct & crn)
+{
+  crn.enabled = hasOption("crn");
+  crn.seed = (unsigned long long) optionLong("crn",0);
+  crn.decoder = 0;
+  crn.shard = 0;
+  crn.shards = 1;
+  if (crn.enabled)
+    cout << "Common random numbers: frames keyed by seed " << crn.seed << endl;
+}
+
+
+// Index of local frame 'frame' in the unsharded sequence.
+long globalFrame(crn_struct & crn, long frame)
+{
+  return crn.shard + crn.shards*frame;
+}
+
+
+// Sets crn.decoder from --crn-decoder, or else from the parameter
+// list of setupSnapshot() without the log file and the options that
+// only decide how long to run.
+void keyDecoderStream(crn_struct & crn, const char * binary, const vector<string> & params, string logfilename)
+{
+  if (hasOption("crn-decoder"))
+    {
+      crn.decoder = (unsigned long long) optionLong("crn-decoder",0);
+      return;
+    }
+  string name(binary);
+  size_t slash = name.rfind('/');
+  if (slash != string::npos)
+    name = name.substr(slash+1);
+  unsigned long long h = splitmix64(0);
+  for (int i=0; i<name.size(); i++)
+    h = splitmix64(h ^ (unsigned char) name[i]);
+  for (int i=0; i<params.size(); i++)
+    {
+      const string & p = params[i];
+      if (p == "arg " + logfilename)
+	continue;
+      if ((p.compare(0,4,"opt ") == 0) && stoppingOption(p.substr(4,p.find('=')-4)))
+	continue;
+      h = splitmix64(h ^ 0x0A);
+      for (int j=0; j<p.size(); j++)
+	h = splitmix64(h ^ (unsigned char) p[j]);
+    }
+  crn.decoder = h;
+}
+
+
+void seedFrame(crn_struct & crn, int stream, long frame)
+{
+  if (!crn.enabled)
+    return;
+  ranKey = frameKey(crn.seed,stream,globalFrame(crn,frame));
+  if (stream == RNG_STREAM_DECODER)
+    ranKey = splitmix64(ranKey ^ crn.decoder);
+  ranCount = 0;
+  ran_keyed = 1;
+}
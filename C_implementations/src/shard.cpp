@@ -0,0 +1,119 @@
+/*==========================================================================================
+** shard.cpp
+** By Chris Winstead
+
+** Description:
+   Sharded simulation and merging of shard records. See shard.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include "shard.h"
+#include "options.h"
+using namespace std;
+
+
+void setupShard(shard_struct & shard, crn_struct & crn, stopping_struct & stop)
+{
+  shard.enabled = hasOption("shard");
+  shard.merging = hasOption("merge-shards");
+  shard.k = 0;
+  shard.K = 1;
+  shard.frames = stop.maxFrames;
+  if (!shard.enabled && !shard.merging)
+    return;
+
+  if (shard.enabled && shard.merging)
+    {
+      cout << "Error: --shard and --merge-shards are exclusive." << endl;
+      exit(1);
+    }
+  if (shard.enabled)
+    {
+      string spec = optionString("shard","");
+      if ((sscanf(spec.c_str(),"%ld/%ld",&shard.k,&shard.K) != 2) || (shard.k < 0) || (shard.k >= shard.K))
+	{
+	  cout << "Error: --shard expects k/K with 0 <= k < K, got '" << spec << "'" << endl;
+	  exit(1);
+	}
+    }
+  else
+    shard.K = optionLong("merge-shards",0);
+
+  if ((shard.frames <= 0) || (shard.K < 1) || (shard.K > shard.frames))
+    {
+      cout << "Error: shards need --frames=n with n at least the number of shards." << endl;
+      exit(1);
+    }
+  if ((stop.relWidth > 0) || (stop.targetFER > 0))
+    {
+      cout << "Error: --relwidth and --target-fer cannot be split into shards." << endl;
+      exit(1);
+    }
+
+  if (!crn.enabled)
+    {
+      crn.enabled = 1;
+      crn.seed = 0;
+    }
+  stop.minFrames = 0;
+  if (shard.enabled)
+    {
+      crn.shard = shard.k;
+      crn.shards = shard.K;
+      stop.maxFrames = (shard.frames - shard.k + shard.K - 1)/shard.K;
+      cout << "Shard " << shard.k << " of " << shard.K << ": " << stop.maxFrames << " of "
+	   << shard.frames << " frames, seed " << crn.seed << endl;
+    }
+}
+
+
+string shardFileName(string logfilename, long k, long K)
+{
+  stringstream ss;
+  ss << logfilename << ".shard" << k << "of" << K;
+  return ss.str();
+}
+
+
+// Add every shard record into the registered variables. The frame
+// counter then equals --frames and the simulation loop is skipped.
+void mergeShards(shard_struct & shard, snapshot_struct & snap, string logfilename)
+{
+  if (!shard.merging)
+    return;
+
+  long * totalWords = NULL;
+  for (int i=0; i<snap.fields.size(); i++)
+    if (snap.fields[i].name == "totalWords")
+      totalWords = (long *) snap.fields[i].p;
+
+  for (long k=0; k<shard.K; k++)
+    {
+      string fileName = shardFileName(logfilename,k,shard.K);
+      if (!readSnapshotFile(snap,fileName,SNAP_MERGE,snap.params))
+	{
+	  cout << "Error: missing shard record " << fileName << endl;
+	  exit(1);
+	}
+    }
+  if ((totalWords == NULL) || (*totalWords != shard.frames))
+    {
+      cout << "Error: shard records do not add up to " << shard.frames << " frames." << endl;
+      exit(1);
+    }
+  cout << "Merged " << shard.K << " shard records." << endl;
+}
+
+
+void writeShardRecord(shard_struct & shard, snapshot_struct & snap, string logfilename)
+{
+  string fileName = shardFileName(logfilename,shard.k,shard.K);
+  if (writeSnapshotFile(snap,fileName,snap.params))
+    cout << "Wrote shard record " << fileName << endl;
+  else
+    cout << "Failed to write shard record " << fileName << endl;
+}
@@ -0,0 +1,177 @@
+/*==========================================================================================
+** sla.cpp
+** By Chris Winstead
+
+** Description:
+   Link model and latency histograms for the service-level mode.
+   See sla.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include "sla.h"
+#include "options.h"
+using namespace std;
+
+
+// Log-linear buckets: values below 2*SLA_SUB_BUCKETS are exact,
+// above that each power of two is split into SLA_SUB_BUCKETS.
+static int bucketOf(unsigned long long v)
+{
+  if (v < 2*SLA_SUB_BUCKETS)
+    return (int) v;
+  int shift = 63 - __builtin_clzll(v) - 6;
+  return shift*SLA_SUB_BUCKETS + (int) (v >> shift);
+}
+
+
+static double bucketValue(int b)
+{
+  if (b < 2*SLA_SUB_BUCKETS)
+    return b;
+  int shift = b/SLA_SUB_BUCKETS - 1;
+  unsigned long long low = (unsigned long long) (b - shift*SLA_SUB_BUCKETS) << shift;
+  return low + 0.5*((1ULL << shift) - 1);
+}
+
+
+static void clearHistogram(sla_histogram & h)
+{
+  h.counts.assign(64*SLA_SUB_BUCKETS,0);
+  h.total = 0;
+  h.maxValue = 0;
+}
+
+
+static void addToHistogram(sla_histogram & h, double seconds)
+{
+  unsigned long long ns = (unsigned long long) llround(seconds*1e9);
+  h.counts[bucketOf(ns)]++;
+  h.total++;
+  if (ns > h.maxValue)
+    h.maxValue = ns;
+}
+
+
+// Value in microseconds below which a fraction p of the samples lie.
+double slaPercentile(sla_histogram & h, double p)
+{
+  if (h.total == 0)
+    return 0.0;
+  long rank = (long) ceil(p*h.total);
+  if (rank < 1)
+    rank = 1;
+  long seen = 0;
+  for (size_t b=0; b<h.counts.size(); b++)
+    {
+      seen += h.counts[b];
+      if (seen >= rank)
+	return fmin(bucketValue(b),(double) h.maxValue)/1e3;
+    }
+  return h.maxValue/1e3;
+}
+
+
+void setupSLA(sla_struct & S)
+{
+  S.enabled = hasOption("sla") || hasOption("sla-rate") || hasOption("sla-budget") || hasOption("sla-cores");
+  S.rate = optionDouble("sla-rate",0.0);
+  S.budget = optionDouble("sla-budget",0.0)*1e-6;
+  S.cores = (int) optionLong("sla-cores",1);
+  if (S.cores < 1)
+    S.cores = 1;
+  S.freeAt.assign(S.cores,0.0);
+  S.frames = 0;
+  S.misses = 0;
+  S.serviceMisses = 0;
+  S.busy = 0.0;
+  S.makespan = 0.0;
+  clearHistogram(S.latency);
+  clearHistogram(S.service);
+  if (!S.enabled)
+    return;
+
+  cout << "Latency mode: ";
+  if (S.rate > 0)
+    cout << S.rate << " frames/s offered";
+  else
+    cout << "back-to-back frames";
+  cout << " to " << S.cores << " core" << (S.cores > 1 ? "s" : "");
+  if (S.budget > 0)
+    cout << ", budget " << S.budget*1e6 << " us";
+  cout << endl;
+}
+
+
+void slaRecordFrame(sla_struct & S, double serviceSeconds)
+{
+  int core = 0;
+  for (int k=1; k<S.cores; k++)
+    if (S.freeAt[k] < S.freeAt[core])
+      core = k;
+
+  double arrival = (S.rate > 0) ? S.frames/S.rate : S.freeAt[core];
+  double start = (arrival > S.freeAt[core]) ? arrival : S.freeAt[core];
+  double completion = start + serviceSeconds;
+  S.freeAt[core] = completion;
+  if (completion > S.makespan)
+    S.makespan = completion;
+
+  double latency = completion - arrival;
+  addToHistogram(S.latency,latency);
+  addToHistogram(S.service,serviceSeconds);
+  S.busy += serviceSeconds;
+  S.frames++;
+  if (S.budget > 0)
+    {
+      if (latency > S.budget)
+	S.misses++;
+      if (serviceSeconds > S.budget)
+	S.serviceMisses++;
+    }
+}
+
+
+void reportSLA(sla_struct & S, string logfilename, double SNR, const char * codeName)
+{
+  if (!S.enabled || (S.frames == 0))
+    return;
+
+  double fps = (S.makespan > 0) ? S.frames/S.makespan : 0.0;
+  double utilization = (S.makespan > 0) ? S.busy/(S.cores*S.makespan) : 0.0;
+  double meanService = S.busy/S.frames;
+  int coresNeeded = (S.rate > 0) ? (int) ceil(S.rate*meanService) : 1;
+  double missFraction = (double) S.misses/S.frames;
+  double p[4] = { 0.5, 0.9, 0.99, 0.999 };
+  double lat[4], svc[4];
+  for (int k=0; k<4; k++)
+    {
+      lat[k] = slaPercentile(S.latency,p[k]);
+      svc[k] = slaPercentile(S.service,p[k]);
+    }
+
+  cout << "\nLatency over " << S.frames << " frames on " << S.cores << " core" << (S.cores > 1 ? "s" : "") << ":\n"
+       << "\tsustained\t" << fps << " frames/s (utilization " << 100*utilization << "%)\n"
+       << "\tlatency us\tp50 " << lat[0] << "\tp90 " << lat[1] << "\tp99 " << lat[2]
+       << "\tp99.9 " << lat[3] << "\tmax " << S.latency.maxValue/1e3 << endl
+       << "\tservice us\tp50 " << svc[0] << "\tp90 " << svc[1] << "\tp99 " << svc[2]
+       << "\tp99.9 " << svc[3] << "\tmax " << S.service.maxValue/1e3 << endl;
+  if (S.budget > 0)
+    cout << "\tdeadline misses\t" << S.misses << " (" << 100*missFraction << "%), "
+	 << S.serviceMisses << " with service time over budget\n";
+  if (S.rate > 0)
+    cout << "\tcores needed for " << S.rate << " frames/s: " << coresNeeded << endl;
+
+  string fileName = logfilename + ".sla";
+  ofstream of(fileName.c_str(),ios::app);
+  char tab = '\t';
+  of << SNR << tab << S.rate << tab << S.cores << tab << S.budget*1e6 << tab << S.frames << tab
+     << fps << tab << utilization << tab
+     << lat[0] << tab << lat[1] << tab << lat[2] << tab << lat[3] << tab << S.latency.maxValue/1e3 << tab
+     << S.misses << tab << missFraction << tab
+     << svc[0] << tab << svc[2] << tab << svc[3] << tab << S.service.maxValue/1e3 << tab
+     << S.serviceMisses << tab << coresNeeded << tab << codeName << endl;
+  of.close();
+}
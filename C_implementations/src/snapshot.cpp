@@ -0,0 +1,462 @@
+/*==========================================================================================
+** snapshot.cpp
+** By Chris Winstead
+
+** Description:
+   Periodic run-state snapshots and resume. See snapshot.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include "snapshot.h"
+#include "options.h"
+#include "console.h"
+using namespace std;
+
+#define SNAPSHOT_MAGIC "LDPCSNAP1"
+
+static volatile sig_atomic_t snapshotSignal = 0;
+
+static void snapshotSignalHandler(int sig)
+{
+  snapshotSignal = sig;
+}
+
+
+// Options that do not change the simulated results:
+static bool bookkeepingOption(const string & name)
+{
+  return (name == "resume") || (name.compare(0,8,"snapshot") == 0) || (name == "outcomes")
+    || (name == "shard") || (name == "merge-shards") || (name == "cache") || (name == "corpus-out")
+    || (name.compare(0,3,"sla") == 0) || (name.compare(0,6,"status") == 0)
+    || (name == "console-rate")
+    || (name.compare(0,5,"trace") == 0) || (name == "llr-out");
+}
+
+
+// The field registry and parameter list are always built, since
+// shard records use them too; only periodic saving needs --snapshot.
+void setupSnapshot(snapshot_struct & snap, crn_struct & crn, int argc, char * argv[])
+{
+  snap.enabled = hasOption("snapshot");
+  snap.fileName = optionString("snapshot","");
+  snap.interval = optionLong("snapshot-every",600);
+  snap.lastSave = time(0);
+  snap.params.clear();
+  snap.fields.clear();
+
+  for (int i=1; i<argc; i++)
+    snap.params.push_back(string("arg ") + argv[i]);
+  map<string,string> opts = allOptions();
+  for (map<string,string>::iterator it=opts.begin(); it!=opts.end(); it++)
+    if (!bookkeepingOption(it->first))
+      snap.params.push_back("opt " + it->first + "=" + it->second);
+
+  snapshot_field f = { "crn", SNAP_SEED, &crn.seed, NULL };
+  snap.fields.push_back(f);
+  if (!snap.enabled)
+    return;
+
+  if (!crn.enabled)
+    {
+      crn.enabled = 1;
+      crn.seed = (unsigned long long) time(0)*1000003ULL + getpid();
+      cout << "Snapshots enabled: frames keyed by seed " << crn.seed << endl;
+    }
+
+  signal(SIGINT,snapshotSignalHandler);
+  signal(SIGTERM,snapshotSignalHandler);
+  cout << "Saving run state to " << snap.fileName << " every " << snap.interval << " s" << endl;
+}
+
+
+static void addField(snapshot_struct & snap, const char * name, int type, void * p)
+{
+  snapshot_field f = { name, type, p, NULL };
+  snap.fields.push_back(f);
+}
+
+void snapshotField(snapshot_struct & snap, const char * name, int & v)            { addField(snap,name,SNAP_INT,&v); }
+void snapshotField(snapshot_struct & snap, const char * name, long & v)           { addField(snap,name,SNAP_LONG,&v); }
+void snapshotField(snapshot_struct & snap, const char * name, double & v)         { addField(snap,name,SNAP_DOUBLE,&v); }
+void snapshotField(snapshot_struct & snap, const char * name, vector<int> & v)    { addField(snap,name,SNAP_VINT,&v); }
+void snapshotField(snapshot_struct & snap, const char * name, vector<long> & v)   { addField(snap,name,SNAP_VLONG,&v); }
+void snapshotField(snapshot_struct & snap, const char * name, vector<double> & v) { addField(snap,name,SNAP_VDOUBLE,&v); }
+void snapshotField(snapshot_struct & snap, const char * name, ifstream & v)       { addField(snap,name,SNAP_STREAM,&v); }
+
+void snapshotMean(snapshot_struct & snap, const char * name, vector<double> & v, long & weight)
+{
+  addField(snap,name,SNAP_VMEAN,&v);
+  snap.fields.back().weight = &weight;
+}
+
+
+// Register an output file opened for appending (or NULL).
+void snapshotFile(snapshot_struct & snap, const char * name, FILE *& fp)
+{
+  addField(snap,name,SNAP_FILE,&fp);
+}
+
+
+void snapshotModules(snapshot_struct & snap, is_struct & IS, extrap_struct & X, checkpoint_struct & cp, outcome_struct & out)
+{
+  snapshotField(snap,"is.frames",IS.frames);
+  snapshotField(snap,"is.sumW",IS.sumW);
+  snapshotField(snap,"is.sumW2",IS.sumW2);
+  snapshotField(snap,"is.sumWE",IS.sumWE);
+  snapshotField(snap,"is.sumW2E",IS.sumW2E);
+  snapshotField(snap,"is.sumWB",IS.sumWB);
+  snapshotField(snap,"is.sumW2B",IS.sumW2B);
+
+  snapshotField(snap,"extrap.frames",X.frames);
+  snapshotField(snap,"extrap.sumW",X.sumW);
+  snapshotField(snap,"extrap.sumW2",X.sumW2);
+  snapshotField(snap,"extrap.sumWE",X.sumWE);
+  snapshotField(snap,"extrap.sumW2E",X.sumW2E);
+  snapshotField(snap,"extrap.sumWB",X.sumWB);
+  snapshotField(snap,"extrap.sumW2B",X.sumW2B);
+  snapshotField(snap,"extrap.failures",X.failures);
+
+  snapshotField(snap,"cp.frames",cp.frames);
+  snapshotField(snap,"cp.bitErrors",cp.bitErrors);
+  snapshotField(snap,"cp.wordErrors",cp.wordErrors);
+  snapshotField(snap,"cp.iterations",cp.iterations);
+
+  snapshotFile(snap,"outcomes",out.fp);
+}
+
+
+template <typename T>
+static void writeVector(ostream & os, vector<T> & v)
+{
+  os << v.size();
+  for (int i=0; i<v.size(); i++)
+    os << " " << v[i];
+}
+
+template <typename T>
+static bool readVector(istream & is, vector<T> & v)
+{
+  long n;
+  if (!(is >> n))
+    return false;
+  v.resize(n);
+  for (long i=0; i<n; i++)
+    if (!(is >> v[i]))
+      return false;
+  return true;
+}
+
+
+static void writeField(ostream & os, snapshot_field & f)
+{
+  os << f.name << " ";
+  switch (f.type)
+    {
+    case SNAP_INT:     os << *(int *) f.p; break;
+    case SNAP_LONG:    os << *(long *) f.p; break;
+    case SNAP_DOUBLE:  os << *(double *) f.p; break;
+    case SNAP_VINT:    writeVector(os,*(vector<int> *) f.p); break;
+    case SNAP_VLONG:   writeVector(os,*(vector<long> *) f.p); break;
+    case SNAP_VDOUBLE:
+    case SNAP_VMEAN:   writeVector(os,*(vector<double> *) f.p); break;
+    case SNAP_SEED:    os << *(unsigned long long *) f.p; break;
+    case SNAP_STREAM:
+      {
+	ifstream & s = *(ifstream *) f.p;
+	os << (s.is_open() ? (long long) s.tellg() : -1LL);
+	break;
+      }
+    case SNAP_FILE:
+      {
+	FILE * fp = *(FILE **) f.p;
+	long pos = -1;
+	if (fp != NULL)
+	  {
+	    fflush(fp);
+	    pos = ftell(fp);
+	  }
+	os << pos;
+	break;
+      }
+    }
+  os << "\n";
+}
+
+
+static bool readField(istream & is, snapshot_field & f)
+{
+  switch (f.type)
+    {
+    case SNAP_INT:     return (bool) (is >> *(int *) f.p);
+    case SNAP_LONG:    return (bool) (is >> *(long *) f.p);
+    case SNAP_DOUBLE:  return (bool) (is >> *(double *) f.p);
+    case SNAP_VINT:    return readVector(is,*(vector<int> *) f.p);
+    case SNAP_VLONG:   return readVector(is,*(vector<long> *) f.p);
+    case SNAP_VDOUBLE:
+    case SNAP_VMEAN:   return readVector(is,*(vector<double> *) f.p);
+    case SNAP_SEED:    return (bool) (is >> *(unsigned long long *) f.p);
+    case SNAP_STREAM:
+      {
+	long long pos;
+	if (!(is >> pos))
+	  return false;
+	ifstream & s = *(ifstream *) f.p;
+	if ((pos >= 0) && s.is_open())
+	  {
+	    s.clear();
+	    s.seekg(pos);
+	  }
+	return true;
+      }
+    case SNAP_FILE:
+      {
+	long pos;
+	if (!(is >> pos))
+	  return false;
+	FILE * fp = *(FILE **) f.p;
+	if ((pos >= 0) && (fp != NULL))
+	  {
+	    // Drop records written after the snapshot was taken:
+	    fflush(fp);
+	    if (ftruncate(fileno(fp),pos) != 0)
+	      return false;
+	    fseek(fp,pos,SEEK_SET);
+	  }
+	return true;
+      }
+    }
+  return false;
+}
+
+
+template <typename T>
+static bool addValue(istream & is, T & v)
+{
+  T x;
+  if (!(is >> x))
+    return false;
+  v += x;
+  return true;
+}
+
+template <typename T>
+static bool addVector(istream & is, vector<T> & v)
+{
+  vector<T> x;
+  if (!readVector(is,x) || (x.size() != v.size()))
+    return false;
+  for (int i=0; i<v.size(); i++)
+    v[i] += x[i];
+  return true;
+}
+
+
+// Merge one saved field into the registered variable. Mean fields
+// need the saved frame count, which is passed in as 'savedWeight';
+// they are merged before the counters, so *f.weight still holds
+// the count behind the current values.
+static bool mergeField(istream & is, snapshot_field & f, long savedWeight)
+{
+  switch (f.type)
+    {
+    case SNAP_INT:     return addValue(is,*(int *) f.p);
+    case SNAP_LONG:    return addValue(is,*(long *) f.p);
+    case SNAP_DOUBLE:  return addValue(is,*(double *) f.p);
+    case SNAP_VINT:    return addVector(is,*(vector<int> *) f.p);
+    case SNAP_VLONG:   return addVector(is,*(vector<long> *) f.p);
+    case SNAP_VDOUBLE: return addVector(is,*(vector<double> *) f.p);
+    case SNAP_VMEAN:
+      {
+	vector<double> & v = *(vector<double> *) f.p;
+	vector<double> x;
+	double n0 = *f.weight;
+	double n1 = savedWeight;
+	if (!readVector(is,x) || (x.size() != v.size()))
+	  return false;
+	if (n0+n1 > 0)
+	  for (int i=0; i<v.size(); i++)
+	    v[i] = (n0*v[i] + n1*x[i])/(n0+n1);
+	return true;
+      }
+    case SNAP_STREAM:
+    case SNAP_FILE:
+    case SNAP_SEED:
+      return true;
+    }
+  return false;
+}
+
+
+// Read a snapshot-format file into the registered fields, either
+// replacing (SNAP_RESTORE, SNAP_CONTINUE) or accumulating into
+// (SNAP_MERGE) their values. Returns false if the file cannot be
+// opened. A file saved with parameters other than 'params', or a
+// damaged file, ends the program.
+bool readSnapshotFile(snapshot_struct & snap, string fileName, int mode, const vector<string> & params)
+{
+  ifstream f(fileName.c_str());
+  if (!f.is_open())
+    return false;
+
+  string line;
+  getline(f,line);
+  if (line != SNAPSHOT_MAGIC)
+    {
+      cout << "Error: " << fileName << " is not a snapshot file." << endl;
+      exit(1);
+    }
+
+  vector<string> saved;
+  map<string,string> values;
+  while (getline(f,line))
+    {
+      if ((line.compare(0,4,"arg ") == 0) || (line.compare(0,4,"opt ") == 0) || (line.compare(0,4,"key ") == 0))
+	{
+	  saved.push_back(line);
+	  continue;
+	}
+      size_t sp = line.find(' ');
+      if (sp != string::npos)
+	values[line.substr(0,sp)] = line.substr(sp+1);
+    }
+
+  if (saved != params)
+    {
+      cout << "Error: " << fileName << " was saved with different parameters:" << endl;
+      for (int i=0; i<saved.size(); i++)
+	cout << "\t" << saved[i] << endl;
+      exit(1);
+    }
+  // Files saved before an output file was registered lack its entry:
+  int missing = 0;
+  for (int k=0; k<snap.fields.size(); k++)
+    if ((snap.fields[k].type == SNAP_FILE) && (values.count(snap.fields[k].name) == 0))
+      missing++;
+  if (values.size() + missing != snap.fields.size())
+    {
+      cout << "Error: incomplete snapshot in " << fileName << endl;
+      exit(1);
+    }
+
+  for (int pass=0; pass<2; pass++)
+    for (int k=0; k<snap.fields.size(); k++)
+      {
+	snapshot_field & fld = snap.fields[k];
+	if ((mode == SNAP_MERGE) && ((fld.type == SNAP_VMEAN) != (pass == 0)))
+	  continue;
+	if ((mode != SNAP_MERGE) && (pass == 1))
+	  continue;
+	if ((mode == SNAP_CONTINUE) && (fld.type == SNAP_FILE))
+	  continue;
+	map<string,string>::iterator it = values.find(fld.name);
+	if ((it == values.end()) && (fld.type == SNAP_FILE))
+	  continue;
+	bool ok = (it != values.end());
+	if (ok)
+	  {
+	    istringstream ss(it->second);
+	    if (mode != SNAP_MERGE)
+	      ok = readField(ss,fld);
+	    else
+	      {
+		long savedWeight = 0;
+		for (int w=0; w<snap.fields.size(); w++)
+		  if ((snap.fields[w].p == fld.weight) && (fld.weight != NULL))
+		    savedWeight = atol(values[snap.fields[w].name].c_str());
+		ok = mergeField(ss,fld,savedWeight);
+	      }
+	  }
+	if (!ok)
+	  {
+	    cout << "Error: bad snapshot entry '" << fld.name << "' in " << fileName << endl;
+	    exit(1);
+	  }
+      }
+  return true;
+}
+
+
+// Restore the registered fields from the snapshot file if --resume
+// was given. Returns true if a snapshot was loaded.
+bool resumeSnapshot(snapshot_struct & snap)
+{
+  if (!snap.enabled || !hasOption("resume"))
+    return false;
+  if (!readSnapshotFile(snap,snap.fileName,SNAP_RESTORE,snap.params))
+    {
+      cout << "No snapshot in " << snap.fileName << "; starting a new run." << endl;
+      return false;
+    }
+  cout << "Resumed run state from " << snap.fileName << endl;
+  return true;
+}
+
+
+// Write the registered fields to fileName via a synced temporary
+// file, so that fileName is never left half-written.
+bool writeSnapshotFile(snapshot_struct & snap, string fileName, const vector<string> & params)
+{
+  ostringstream os;
+  os.precision(17);
+  os << SNAPSHOT_MAGIC << "\n";
+  for (int i=0; i<params.size(); i++)
+    os << params[i] << "\n";
+  for (int i=0; i<snap.fields.size(); i++)
+    writeField(os,snap.fields[i]);
+
+  string tmpName = fileName + ".tmp";
+  FILE * fp = fopen(tmpName.c_str(),"w");
+  if (fp == NULL)
+    return false;
+  string text = os.str();
+  bool ok = (fwrite(text.data(),1,text.size(),fp) == text.size());
+  ok = (fflush(fp) == 0) && ok;
+  ok = (fsync(fileno(fp)) == 0) && ok;
+  fclose(fp);
+  return ok && (rename(tmpName.c_str(),fileName.c_str()) == 0);
+}
+
+
+void saveSnapshot(snapshot_struct & snap)
+{
+  if (!snap.enabled)
+    return;
+  if (!writeSnapshotFile(snap,snap.fileName,snap.params))
+    consoleWrite("Failed to write snapshot " + snap.fileName + "\n",CONSOLE_SUMMARY);
+  snap.lastSave = time(0);
+}
+
+
+// Called once per frame, after all counters are updated. On SIGINT
+// or SIGTERM the state is saved and the program exits.
+void saveSnapshotIfDue(snapshot_struct & snap)
+{
+  if (!snap.enabled)
+    return;
+  if (snapshotSignal)
+    {
+      saveSnapshot(snap);
+      drainConsole();
+      cout << "\nInterrupted; run state saved to " << snap.fileName << ". Continue with --resume." << endl;
+      exit(128 + snapshotSignal);
+    }
+  if (time(0) - snap.lastSave >= snap.interval)
+    saveSnapshot(snap);
+}
+
+
+void finishSnapshot(snapshot_struct & snap)
+{
+  if (snap.enabled)
+    remove(snap.fileName.c_str());
+}
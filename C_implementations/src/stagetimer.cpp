@@ -0,0 +1,63 @@
+/*==========================================================================================
+** stagetimer.cpp
+** By Chris Winstead
+
+** Description:
+   Setup and reporting for the per-stage timers. See stagetimer.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include "stagetimer.h"
+using namespace std;
+
+static const char * stageNames[STAGE_COUNT] = { "channel", "init", "check", "symbol", "perturb", "syndrome", "bookkeeping" };
+
+
+static double steadySeconds()
+{
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void setupStageTimer(stagetimer_struct & T)
+{
+  for (int s=0; s<STAGE_COUNT; s++)
+    T.ticks[s] = 0;
+  T.frames = 0;
+  T.iterations = 0;
+  T.startSeconds = steadySeconds();
+  T.startTicks = stageClock();
+  T.last = T.startTicks;
+}
+
+
+void reportStages(stagetimer_struct & T, string logfilename, double SNR, const char * codeName)
+{
+  double seconds = steadySeconds() - T.startSeconds;
+  double ticksPerSecond = (seconds > 0) ? (stageClock() - T.startTicks)/seconds : 1.0;
+  unsigned long long total = 0;
+  for (int s=0; s<STAGE_COUNT; s++)
+    total += T.ticks[s];
+  double frames = (T.frames > 0) ? T.frames : 1;
+  double iterations = (T.iterations > 0) ? T.iterations : 1;
+
+  cout << "\nTime by stage over " << T.frames << " frames, " << T.iterations << " iterations:\n"
+       << "\tstage\t\tseconds\tshare\tticks/frame\tticks/iteration\n";
+  string fileName = logfilename + ".stages";
+  ofstream of(fileName.c_str(),ios::app);
+  char tab = '\t';
+  for (int s=0; s<STAGE_COUNT; s++)
+    {
+      double share = (total > 0) ? (double) T.ticks[s]/total : 0;
+      cout << "\t" << stageNames[s] << (string(stageNames[s]).size() < 8 ? "\t\t" : "\t")
+	   << T.ticks[s]/ticksPerSecond << "\t" << 100*share << "%\t"
+	   << T.ticks[s]/frames << "\t" << T.ticks[s]/iterations << endl;
+      of << SNR << tab << stageNames[s] << tab << T.ticks[s] << tab << T.ticks[s]/ticksPerSecond << tab
+	 << share << tab << T.ticks[s]/frames << tab << T.ticks[s]/iterations << tab
+	 << T.frames << tab << T.iterations << tab << codeName << endl;
+    }
+  of.close();
+}
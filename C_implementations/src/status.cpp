@@ -0,0 +1,109 @@
+/*==========================================================================================
+** status.cpp
+** By Chris Winstead
+
+** Description:
+   Atomically rewritten progress file. See status.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "status.h"
+#include "results.h"
+#include "options.h"
+#include "console.h"
+using namespace std;
+
+
+static double cpuSeconds(int who)
+{
+  struct rusage usage;
+  if (getrusage(who,&usage) != 0)
+    return 0.0;
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6*(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+
+void setupStatus(status_struct & st, const char * decoder, const char * code, double SNR, long totalWords)
+{
+  st.enabled = hasOption("status");
+  st.fileName = optionString("status","");
+  st.interval = optionDouble("status-every",10.0);
+  string name(decoder);
+  size_t slash = name.find_last_of('/');
+  st.decoder = (slash == string::npos) ? name : name.substr(slash+1);
+  st.code = code;
+  st.SNR = SNR;
+  st.start = chrono::steady_clock::now();
+  st.next = st.start;
+  st.lastSeconds = 0.0;
+  st.startWords = totalWords;
+  st.lastWords = totalWords;
+  if (st.enabled)
+    cout << "Writing progress to " << st.fileName << " every " << st.interval << " s" << endl;
+}
+
+
+void writeStatus(status_struct & st, stopping_struct & stop, long words, long wordErrors, long bits, long bitErrors, const char * state)
+{
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  st.next = now + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(st.interval));
+  double elapsed = chrono::duration<double>(now - st.start).count();
+  double rate = (elapsed > 0) ? (words - st.startWords)/elapsed : 0.0;
+  double recent = (elapsed > st.lastSeconds) ? (words - st.lastWords)/(elapsed - st.lastSeconds) : rate;
+  st.lastSeconds = elapsed;
+  st.lastWords = words;
+
+  // Estimates and interval follow the stopping rules, i.e. the
+  // weighted estimates under importance sampling:
+  long w = words, we = wordErrors, b = bits, be = bitErrors;
+  stoppingCounts(stop,w,we,b,be);
+  double ferLow, ferHigh;
+  confidenceInterval(stop,w,we,ferLow,ferHigh);
+  long remaining = framesToStop(stop,words,wordErrors,bits,bitErrors);
+  char host[256] = "";
+  gethostname(host,sizeof(host)-1);
+
+  string s = "{\"state\":" + jsonString(state)
+    + ",\"pid\":" + jsonNumber((long) getpid())
+    + ",\"host\":" + jsonString(host)
+    + ",\"decoder\":" + jsonString(st.decoder)
+    + ",\"code\":" + jsonString(st.code)
+    + ",\"snr\":" + jsonNumber(st.SNR)
+    + ",\"updated\":" + jsonNumber((long) time(0))
+    + ",\"frames\":" + jsonNumber(words)
+    + ",\"word_errors\":" + jsonNumber(wordErrors)
+    + ",\"bit_errors\":" + jsonNumber(bitErrors)
+    + ",\"bits\":" + jsonNumber(bits)
+    + ",\"fer\":" + jsonNumber((w > 0) ? (double) we/w : 0.0)
+    + ",\"fer_lower\":" + jsonNumber(ferLow)
+    + ",\"fer_upper\":" + jsonNumber(ferHigh)
+    + ",\"confidence\":" + jsonNumber(stop.confidence)
+    + ",\"ber\":" + jsonNumber((b > 0) ? (double) be/b : 0.0)
+    + ",\"frames_per_s\":" + jsonNumber(rate)
+    + ",\"recent_frames_per_s\":" + jsonNumber(recent)
+    + ",\"frames_to_stop\":" + ((remaining >= 0) ? jsonNumber(remaining) : string("null"))
+    + ",\"eta_s\":" + (((remaining >= 0) && (rate > 0)) ? jsonNumber(remaining/rate) : string("null"))
+    + ",\"elapsed_s\":" + jsonNumber(elapsed)
+    + ",\"threads\":[{\"thread\":\"decode\",\"utilization\":" + jsonNumber((elapsed > 0) ? cpuSeconds(RUSAGE_THREAD)/elapsed : 0.0) + "}]"
+    + "}\n";
+
+  string tmp = st.fileName + ".tmp";
+  ofstream of(tmp.c_str(),ios::trunc);
+  of << s;
+  of.close();
+  if (!of || (rename(tmp.c_str(),st.fileName.c_str()) != 0))
+    consoleWrite("Could not write status file " + st.fileName + "\n",CONSOLE_SUMMARY);
+}
+
+
+void finishStatus(status_struct & st, stopping_struct & stop, long words, long wordErrors, long bits, long bitErrors)
+{
+  if (st.enabled)
+    writeStatus(st,stop,words,wordErrors,bits,bitErrors,"done");
+}
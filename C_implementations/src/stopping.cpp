@@ -0,0 +1,331 @@
+/*==========================================================================================
+** stopping.cpp
+** By Chris Winstead
+
+** Description:
+   Confidence intervals and stopping rules for the simulation loops.
+   See stopping.h for the options.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include "stopping.h"
+#include "options.h"
+using namespace std;
+
+double normalQuantile(double p);
+double betaQuantile(double a, double b, double p);
+double betaContinuedFraction(double a, double b, double x);
+
+
+// --target-fer is tested only at frame counts n_0 = 1 and
+// n_k+1 = max(n_k + 1, ceil(1.5 n_k)), i.e. 1, 2, 3, 5, 8, 12, ...
+// Look k spends alpha/((k+1)(k+2)) of the error budget alpha = 1-c;
+// the spends sum to alpha, so by the union bound the verdict is
+// wrong with probability at most alpha however long the run. The
+// schedule depends on the frame count alone, so resumed runs keep it.
+// Returns the index of the look at 'frames', or -1 between looks.
+static long targetLook(long frames)
+{
+  long n = 1;
+  for (long k=0; n <= frames; k++)
+    {
+      if (n == frames)
+	return k;
+      n = max(n+1, (long) ceil(1.5*n));
+    }
+  return -1;
+}
+
+
+// Exact (Clopper-Pearson) interval for look k. Wilson's interval
+// is too narrow at the small counts where early looks fall.
+static void targetInterval(stopping_struct & S, long k, long trials, long successes, double & lower, double & upper)
+{
+  double alpha = (1.0 - S.confidence)/((k+1.0)*(k+2.0));
+  double n = trials;
+  double e = successes;
+  lower = (successes == 0) ? 0.0 : betaQuantile(e, n-e+1, alpha/2.0);
+  upper = (successes >= trials) ? 1.0 : betaQuantile(e+1, n-e, 1.0-alpha/2.0);
+}
+
+
+void setupStopping(stopping_struct & S, is_struct & IS, long legacyBitErrors, long legacyWordErrors, long legacyFrames)
+{
+  S.IS = IS.enabled ? &IS : NULL;
+  S.legacyBitErrors = legacyBitErrors;
+  S.legacyWordErrors = legacyWordErrors;
+  S.legacyFrames = legacyFrames;
+  S.confidence = optionDouble("confidence",0.95);
+  S.z = normalQuantile(1.0 - (1.0-S.confidence)/2.0);
+  S.interval = (optionString("ci","wilson") == "cp") ? CI_CLOPPER_PEARSON : CI_WILSON;
+  S.relWidth = optionDouble("relwidth",0.0);
+  S.targetFER = optionDouble("target-fer",0.0);
+  S.useBER = hasOption("ber");
+  S.maxFrames = optionLong("frames",0);
+  S.minFrames = optionLong("min-frames",0);
+
+  if ((S.relWidth > 0) || (S.targetFER > 0) || (S.maxFrames > 0))
+    S.mode = STOP_RULES;
+  else
+    S.mode = STOP_LEGACY;
+}
+
+
+// Under importance sampling the raw counts describe the biased
+// channel. They are replaced by the binomial counts whose mean and
+// variance match the weighted estimates: n = p(1-p)/var, k = p*n.
+// Without bias (equal weights) this gives back words and wordErrors.
+void stoppingCounts(stopping_struct & S, long & words, long & wordErrors, long & bits, long & bitErrors)
+{
+  if ((S.IS == NULL) || (S.IS->frames == 0))
+    return;
+  double fer, ferStd, ber, berStd;
+  isEstimates(*S.IS,fer,ferStd,ber,berStd);
+  if (ferStd > 0)
+    {
+      double n = fer*(1-fer)/(ferStd*ferStd);
+      words = llround(n);
+      wordErrors = llround(fer*n);
+    }
+  if (berStd > 0)
+    {
+      double n = ber*(1-ber)/(berStd*berStd);
+      bits = llround(n);
+      bitErrors = llround(ber*n);
+    }
+}
+
+
+bool keepSimulating(stopping_struct & S, long words, long wordErrors, long bits, long bitErrors)
+{
+  long frames = words;
+  stoppingCounts(S,words,wordErrors,bits,bitErrors);
+  bool legacyContinue = (bitErrors < S.legacyBitErrors) || (wordErrors < S.legacyWordErrors) || (frames < S.legacyFrames);
+  if (S.mode == STOP_LEGACY)
+    return legacyContinue;
+
+  if ((S.maxFrames > 0) && (frames >= S.maxFrames))
+    return false;
+  if ((frames == 0) || (frames < S.minFrames))
+    return true;
+
+  // Proven easier or harder than the target:
+  long look = (S.targetFER > 0) ? targetLook(frames) : -1;
+  double lower, upper;
+  if (look >= 0)
+    {
+      targetInterval(S,look,words,wordErrors,lower,upper);
+      if ((upper < S.targetFER) || (lower > S.targetFER))
+	return false;
+    }
+
+  confidenceInterval(S,words,wordErrors,lower,upper);
+  if ((S.relWidth > 0) && (wordErrors > 0) && (upper-lower <= S.relWidth*wordErrors/words))
+    {
+      if (!S.useBER)
+	return false;
+      confidenceInterval(S,bits,bitErrors,lower,upper);
+      if ((bitErrors > 0) && (upper-lower <= S.relWidth*bitErrors/bits))
+	return false;
+    }
+
+  // A point too close to --target-fer to decide would run forever,
+  // so without a cap or --relwidth the heuristic still ends it:
+  if ((S.maxFrames <= 0) && (S.relWidth <= 0) && !legacyContinue)
+    return false;
+
+  // With only a frame cap, run to the cap:
+  return true;
+}
+
+
+// Estimated frames still needed before keepSimulating() ends the run,
+// from the normal approximation at the current error rates, or -1
+// when no estimate is possible (legacy heuristic, or no errors yet
+// under --relwidth).
+long framesToStop(stopping_struct & S, long words, long wordErrors, long bits, long bitErrors)
+{
+  if (S.mode == STOP_LEGACY)
+    return -1;
+  long frames = words;
+  stoppingCounts(S,words,wordErrors,bits,bitErrors);
+  // Raw frames per equivalent frame under importance sampling:
+  double perFrame = (words > 0) ? (double) frames/words : 1.0;
+
+  double z2 = S.z*S.z;
+  double best = -1;
+  if ((S.relWidth > 0) && (wordErrors > 0))
+    {
+      double p = (double) wordErrors/words;
+      double need = 4*z2*(1-p)/(S.relWidth*S.relWidth*p);
+      if (S.useBER)
+	{
+	  if (bitErrors == 0)
+	    need = -1;
+	  else
+	    {
+	      double pb = (double) bitErrors/bits;
+	      need = max(need, 4*z2*(1-pb)/(S.relWidth*S.relWidth*pb)*words/bits);
+	    }
+	}
+      best = need;
+    }
+  if (S.targetFER > 0)
+    {
+      // Normal approximation at the level of a look near 'frames':
+      double p = (words > 0) ? (double) wordErrors/words : 0.0;
+      double t = S.targetFER;
+      double k = 1.0 + log(frames + 1.0)/log(1.5);
+      double zt = normalQuantile(1.0 - (1.0-S.confidence)/(2.0*k*(k+1.0)));
+      double need = -1;
+      if (p == 0)
+	need = zt*zt*(1-t)/t;
+      else if (p != t)
+	need = zt*zt*p*(1-p)/((t-p)*(t-p));
+      if ((need >= 0) && ((best < 0) || (need < best)))
+	best = need;
+    }
+  if (best >= 0)
+    best *= perFrame;
+  if ((S.maxFrames > 0) && ((best < 0) || (best > S.maxFrames)))
+    best = S.maxFrames;
+  if (best < 0)
+    return -1;
+  if (best < S.minFrames)
+    best = S.minFrames;
+  return (best > frames) ? (long) ceil(best - frames) : 0;
+}
+
+
+void confidenceInterval(stopping_struct & S, long trials, long successes, double & lower, double & upper)
+{
+  double n = trials;
+  double k = successes;
+  if (trials == 0)
+    {
+      lower = 0;
+      upper = 1;
+      return;
+    }
+
+  if (S.interval == CI_CLOPPER_PEARSON)
+    {
+      double alpha = 1.0 - S.confidence;
+      lower = (successes == 0) ? 0.0 : betaQuantile(k, n-k+1, alpha/2.0);
+      upper = (successes == trials) ? 1.0 : betaQuantile(k+1, n-k, 1.0-alpha/2.0);
+      return;
+    }
+
+  double p = k/n;
+  double z2 = S.z*S.z;
+  double denom = 1.0 + z2/n;
+  double center = (p + z2/(2*n))/denom;
+  double half = S.z*sqrt(p*(1-p)/n + z2/(4*n*n))/denom;
+  lower = max(0.0, center-half);
+  upper = min(1.0, center+half);
+}
+
+
+void reportStopping(stopping_struct & S, long words, long wordErrors, long bits, long bitErrors)
+{
+  double lower, upper;
+  const char * name = (S.interval == CI_CLOPPER_PEARSON) ? "Clopper-Pearson" : "Wilson";
+  stoppingCounts(S,words,wordErrors,bits,bitErrors);
+  confidenceInterval(S,words,wordErrors,lower,upper);
+  cout << S.confidence*100 << "% " << name << (S.IS ? " interval (weighted)" : " interval") << ": FER in [" << lower << ", " << upper << "]";
+  confidenceInterval(S,bits,bitErrors,lower,upper);
+  cout << ", BER in [" << lower << ", " << upper << "]" << endl;
+}
+
+
+//============================================================//
+// Distribution functions
+//============================================================//
+
+// Inverse of the standard normal CDF by bisection on erfc.
+double normalQuantile(double p)
+{
+  double lo = -40, hi = 40;
+  for (int it=0; it<200; it++)
+    {
+      double mid = 0.5*(lo+hi);
+      if (0.5*erfc(-mid*M_SQRT1_2) < p)
+	lo = mid;
+      else
+	hi = mid;
+    }
+  return 0.5*(lo+hi);
+}
+
+
+// Regularized incomplete beta function I_x(a,b), evaluated by
+// continued fraction (Numerical Recipes betai/betacf). lgamma is
+// used rather than gammln() from r.cpp, which loses accuracy for
+// the very large arguments that appear with millions of frames.
+double incompleteBeta(double a, double b, double x)
+{
+  if (x <= 0.0)
+    return 0.0;
+  if (x >= 1.0)
+    return 1.0;
+  double bt = exp(lgamma(a+b) - lgamma(a) - lgamma(b) + a*log(x) + b*log1p(-x));
+  if (x < (a+1.0)/(a+b+2.0))
+    return bt*betaContinuedFraction(a,b,x)/a;
+  return 1.0 - bt*betaContinuedFraction(b,a,1.0-x)/b;
+}
+
+
+double betaContinuedFraction(double a, double b, double x)
+{
+  const double FPMIN = 1e-300;
+  const double EPS = 1e-14;
+  double qab = a+b, qap = a+1.0, qam = a-1.0;
+  double c = 1.0;
+  double d = 1.0 - qab*x/qap;
+  if (fabs(d) < FPMIN)
+    d = FPMIN;
+  d = 1.0/d;
+  double h = d;
+  for (int m=1; m<=100000; m++)
+    {
+      int m2 = 2*m;
+      double aa = m*(b-m)*x/((qam+m2)*(a+m2));
+      d = 1.0 + aa*d;
+      if (fabs(d) < FPMIN) d = FPMIN;
+      c = 1.0 + aa/c;
+      if (fabs(c) < FPMIN) c = FPMIN;
+      d = 1.0/d;
+      h *= d*c;
+      aa = -(a+m)*(qab+m)*x/((a+m2)*(qap+m2));
+      d = 1.0 + aa*d;
+      if (fabs(d) < FPMIN) d = FPMIN;
+      c = 1.0 + aa/c;
+      if (fabs(c) < FPMIN) c = FPMIN;
+      d = 1.0/d;
+      double del = d*c;
+      h *= del;
+      if (fabs(del-1.0) < EPS)
+	break;
+    }
+  return h;
+}
+
+
+// Solve I_x(a,b) = p for x by bisection in the log domain, which
+// keeps precision for the tiny error rates of interest.
+double betaQuantile(double a, double b, double p)
+{
+  double lo = -745.0, hi = 0.0;
+  for (int it=0; it<200; it++)
+    {
+      double mid = 0.5*(lo+hi);
+      if (incompleteBeta(a,b,exp(mid)) < p)
+	lo = mid;
+      else
+	hi = mid;
+    }
+  return exp(0.5*(lo+hi));
+}
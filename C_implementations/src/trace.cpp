@@ -0,0 +1,363 @@
+/*==========================================================================================
+** trace.cpp
+** By Chris Winstead
+
+** Description:
+   Capture, writing and reading of binary decoder traces.
+   See trace.h.
+==============================================================================================*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+#include "trace.h"
+#include "options.h"
+using namespace std;
+
+
+template <class T>
+static void putColumn(vector<unsigned char> & raw, const vector<T> & v)
+{
+  const unsigned char * p = (const unsigned char *) v.data();
+  raw.insert(raw.end(),p,p+v.size()*sizeof(T));
+}
+
+
+template <class T>
+static bool getColumn(const vector<unsigned char> & raw, size_t & pos, vector<T> & v, size_t n)
+{
+  if (pos + n*sizeof(T) > raw.size())
+    return false;
+  v.resize(n);
+  if (n > 0)
+    memcpy(v.data(),&raw[pos],n*sizeof(T));
+  pos += n*sizeof(T);
+  return true;
+}
+
+
+// Parse --trace-frames=a-b,c,... into inclusive ranges.
+static void parseFrames(trace_struct & tr, const string & spec)
+{
+  tr.all = (spec == "all");
+  tr.failuresOnly = (spec == "failures");
+  if (tr.all || tr.failuresOnly)
+    return;
+  size_t pos = 0;
+  while (pos < spec.size())
+    {
+      size_t comma = spec.find(',',pos);
+      if (comma == string::npos)
+	comma = spec.size();
+      string item = spec.substr(pos,comma-pos);
+      size_t dash = item.find('-');
+      long a = atol(item.c_str());
+      long b = (dash == string::npos) ? a : atol(item.c_str()+dash+1);
+      tr.first.push_back(a);
+      tr.last.push_back(b);
+      pos = comma+1;
+    }
+}
+
+
+static bool selected(trace_struct & tr, long frame)
+{
+  if (tr.all || tr.failuresOnly)
+    return true;
+  for (int k=0; k<tr.first.size(); k++)
+    if ((frame >= tr.first[k]) && (frame <= tr.last[k]))
+      return true;
+  return false;
+}
+
+
+void setupTrace(trace_struct & tr, alist_struct & H, int Q, int NQ, int Smult, double theta, double w, double SNR, int argc, char * argv[])
+{
+  tr.file = NULL;
+  tr.writing = 0;
+  tr.capturing = 0;
+  tr.records = 0;
+  if (!hasOption("trace"))
+    return;
+
+  tr.N = H.N;
+  tr.M = H.M;
+  tr.Q = Q;
+  tr.NQ = NQ;
+  tr.Smult = Smult;
+  tr.theta = theta;
+  tr.w = w;
+  tr.SNR = SNR;
+  tr.compress = hasOption("trace-compress");
+  parseFrames(tr,optionString("trace-frames","failures"));
+  tr.text = "";
+  for (int i=0; i<argc; i++)
+    tr.text += string(argv[i]) + " ";
+  tr.num_nlist.assign(H.num_nlist,H.num_nlist+H.N);
+  tr.nlist.clear();
+  tr.nlistStart.assign(H.N,0);
+  for (int i=0; i<H.N; i++)
+    {
+      tr.nlistStart[i] = tr.nlist.size();
+      for (int j=0; j<H.num_nlist[i]; j++)
+	tr.nlist.push_back(H.nlist[i][j]-1);
+    }
+
+  string fileName = optionString("trace","");
+  // A resumed run keeps the records already written; the snapshot
+  // trims any written after it was taken.
+  if (hasOption("resume"))
+    {
+      tr.file = fopen(fileName.c_str(),"r+b");
+      if (tr.file != NULL)
+	{
+	  fseek(tr.file,0,SEEK_END);
+	  tr.writing = 1;
+	  cout << "Appending traced frames to " << fileName << endl;
+	  return;
+	}
+    }
+  tr.file = fopen(fileName.c_str(),"wb");
+  if (tr.file == NULL)
+    {
+      cout << "Error: could not open trace file " << fileName << endl;
+      exit(1);
+    }
+  int header[6] = {tr.N, tr.M, tr.Q, tr.NQ, tr.Smult, (int) tr.text.size()};
+  double params[3] = {tr.theta, tr.w, tr.SNR};
+  fwrite(TRACE_MAGIC,1,8,tr.file);
+  fwrite(header,sizeof(int),6,tr.file);
+  fwrite(params,sizeof(double),3,tr.file);
+  fwrite(tr.text.data(),1,tr.text.size(),tr.file);
+  fwrite(tr.num_nlist.data(),sizeof(int),tr.N,tr.file);
+  fwrite(tr.nlist.data(),sizeof(int),tr.nlist.size(),tr.file);
+  tr.writing = 1;
+  cout << "Tracing " << optionString("trace-frames","failures") << " frames to " << fileName
+       << (tr.compress ? " (compressed)" : "") << endl;
+}
+
+
+void beginTraceFrame(trace_struct & tr, long frame, vector<double> & y, vector<double> & yprime,
+		     vector<double> & qmodified, vector<double> & qprime, vector<int> & c)
+{
+  tr.capturing = tr.writing && selected(tr,frame);
+  if (!tr.capturing)
+    return;
+  trace_record & r = tr.rec;
+  r.frame = frame;
+  r.y.assign(y.begin(),y.end());
+  r.yprime.assign(yprime.begin(),yprime.end());
+  r.qmodified.assign(qmodified.begin(),qmodified.end());
+  r.qprime.assign(qprime.begin(),qprime.end());
+  r.c.assign(c.begin(),c.end());
+  r.phaseIterations.clear();
+  r.it.clear();
+  r.qpointer.clear();
+  r.theta.clear();
+  r.d.clear();
+  r.flip.clear();
+  r.E.clear();
+  r.syndrome.clear();
+}
+
+
+void beginTracePhase(trace_struct & tr)
+{
+  if (tr.capturing)
+    tr.rec.phaseIterations.push_back(0);
+}
+
+
+void traceIteration(trace_struct & tr, int it, int qpointer, double theta, vector<int> & d,
+		    vector<int> & E, vector<int> & flip, vector<int> & syndrome)
+{
+  trace_record & r = tr.rec;
+  r.phaseIterations.back()++;
+  r.it.push_back(it);
+  r.qpointer.push_back(qpointer);
+  r.theta.push_back(theta);
+  r.d.insert(r.d.end(),d.begin(),d.end());
+  r.flip.insert(r.flip.end(),flip.begin(),flip.end());
+  r.E.insert(r.E.end(),E.begin(),E.end());
+  r.syndrome.insert(r.syndrome.end(),syndrome.begin(),syndrome.end());
+}
+
+
+void endTraceFrame(trace_struct & tr, int errors, int iterations)
+{
+  if (!tr.capturing)
+    return;
+  tr.capturing = 0;
+  if (tr.failuresOnly && (errors == 0))
+    return;
+
+  trace_record & r = tr.rec;
+  r.errors = errors;
+  r.iterations = iterations;
+  tr.raw.clear();
+  putColumn(tr.raw,r.y);
+  putColumn(tr.raw,r.yprime);
+  putColumn(tr.raw,r.qmodified);
+  putColumn(tr.raw,r.qprime);
+  putColumn(tr.raw,r.c);
+  putColumn(tr.raw,r.phaseIterations);
+  putColumn(tr.raw,r.it);
+  putColumn(tr.raw,r.qpointer);
+  putColumn(tr.raw,r.theta);
+  putColumn(tr.raw,r.d);
+  putColumn(tr.raw,r.flip);
+  putColumn(tr.raw,r.E);
+  putColumn(tr.raw,r.syndrome);
+
+  const unsigned char * payload = tr.raw.data();
+  long long rawBytes = tr.raw.size();
+  long long storedBytes = rawBytes;
+  int compressed = 0;
+  if (tr.compress)
+    {
+      uLongf len = compressBound(rawBytes);
+      tr.packed.resize(len);
+      if ((compress2(tr.packed.data(),&len,tr.raw.data(),rawBytes,Z_BEST_SPEED) == Z_OK) && (len < rawBytes))
+	{
+	  payload = tr.packed.data();
+	  storedBytes = len;
+	  compressed = 1;
+	}
+    }
+
+  long long frame = r.frame;
+  int fields[5] = {r.errors, r.iterations, (int) r.phaseIterations.size(), (int) r.it.size(), compressed};
+  fwrite(&frame,sizeof(long long),1,tr.file);
+  fwrite(fields,sizeof(int),5,tr.file);
+  fwrite(&rawBytes,sizeof(long long),1,tr.file);
+  fwrite(&storedBytes,sizeof(long long),1,tr.file);
+  fwrite(payload,1,storedBytes,tr.file);
+  tr.records++;
+}
+
+
+void closeTrace(trace_struct & tr)
+{
+  if (tr.file == NULL)
+    return;
+  fclose(tr.file);
+  tr.file = NULL;
+  if (tr.writing)
+    cout << "Wrote " << tr.records << " trace records." << endl;
+  tr.writing = 0;
+}
+
+
+bool openTrace(trace_struct & tr, const string & fileName)
+{
+  tr.writing = 0;
+  tr.capturing = 0;
+  tr.records = 0;
+  tr.file = fopen(fileName.c_str(),"rb");
+  if (tr.file == NULL)
+    return false;
+  char magic[8];
+  int header[6];
+  double params[3];
+  if ((fread(magic,1,8,tr.file) != 8) || (memcmp(magic,TRACE_MAGIC,8) != 0)
+      || (fread(header,sizeof(int),6,tr.file) != 6) || (fread(params,sizeof(double),3,tr.file) != 3))
+    {
+      closeTrace(tr);
+      return false;
+    }
+  tr.N = header[0];
+  tr.M = header[1];
+  tr.Q = header[2];
+  tr.NQ = header[3];
+  tr.Smult = header[4];
+  tr.theta = params[0];
+  tr.w = params[1];
+  tr.SNR = params[2];
+  tr.text.assign(header[5],' ');
+  tr.num_nlist.assign(tr.N,0);
+  if ((fread(&tr.text[0],1,header[5],tr.file) != header[5])
+      || (fread(tr.num_nlist.data(),sizeof(int),tr.N,tr.file) != tr.N))
+    {
+      closeTrace(tr);
+      return false;
+    }
+  tr.nlistStart.assign(tr.N,0);
+  int edges = 0;
+  for (int i=0; i<tr.N; i++)
+    {
+      tr.nlistStart[i] = edges;
+      edges += tr.num_nlist[i];
+    }
+  tr.nlist.assign(edges,0);
+  if (fread(tr.nlist.data(),sizeof(int),edges,tr.file) != edges)
+    {
+      closeTrace(tr);
+      return false;
+    }
+  tr.dataStart = ftell(tr.file);
+  return true;
+}
+
+
+bool readTraceRecord(trace_struct & tr)
+{
+  long long frame, rawBytes, storedBytes;
+  int fields[5];
+  if ((tr.file == NULL) || (fread(&frame,sizeof(long long),1,tr.file) != 1)
+      || (fread(fields,sizeof(int),5,tr.file) != 5)
+      || (fread(&rawBytes,sizeof(long long),1,tr.file) != 1)
+      || (fread(&storedBytes,sizeof(long long),1,tr.file) != 1))
+    return false;
+
+  tr.packed.resize(storedBytes);
+  if (fread(tr.packed.data(),1,storedBytes,tr.file) != storedBytes)
+    return false;
+  if (fields[4])
+    {
+      uLongf len = rawBytes;
+      tr.raw.resize(rawBytes);
+      if ((uncompress(tr.raw.data(),&len,tr.packed.data(),storedBytes) != Z_OK) || (len != rawBytes))
+	return false;
+    }
+  else
+    tr.raw.swap(tr.packed);
+
+  trace_record & r = tr.rec;
+  r.frame = frame;
+  r.errors = fields[0];
+  r.iterations = fields[1];
+  size_t phases = fields[2], traced = fields[3], N = tr.N, M = tr.M, Q = tr.Q;
+  size_t pos = 0;
+  bool ok = getColumn(tr.raw,pos,r.y,N) && getColumn(tr.raw,pos,r.yprime,N)
+    && getColumn(tr.raw,pos,r.qmodified,Q) && getColumn(tr.raw,pos,r.qprime,Q)
+    && getColumn(tr.raw,pos,r.c,N) && getColumn(tr.raw,pos,r.phaseIterations,phases)
+    && getColumn(tr.raw,pos,r.it,traced) && getColumn(tr.raw,pos,r.qpointer,traced)
+    && getColumn(tr.raw,pos,r.theta,traced) && getColumn(tr.raw,pos,r.d,traced*N)
+    && getColumn(tr.raw,pos,r.flip,traced*N) && getColumn(tr.raw,pos,r.E,traced*N)
+    && getColumn(tr.raw,pos,r.syndrome,traced*M);
+  if (ok)
+    tr.records++;
+  return ok;
+}
+
+
+// Total traced iterations in the file, read from the record
+// headers only. Reading restarts at the first record.
+long countTraceIterations(trace_struct & tr)
+{
+  long total = 0;
+  long long frame, rawBytes, storedBytes;
+  int fields[5];
+  fseek(tr.file,tr.dataStart,SEEK_SET);
+  while ((fread(&frame,sizeof(long long),1,tr.file) == 1) && (fread(fields,sizeof(int),5,tr.file) == 5)
+	 && (fread(&rawBytes,sizeof(long long),1,tr.file) == 1) && (fread(&storedBytes,sizeof(long long),1,tr.file) == 1)
+	 && (fseek(tr.file,storedBytes,SEEK_CUR) == 0))
+    total += fields[3];
+  fseek(tr.file,tr.dataStart,SEEK_SET);
+  tr.records = 0;
+  return total;
+}
@@ -0,0 +1,143 @@
+//==============================================================
+// traceDump.cpp
+//
+// Lists the records of a binary decoder trace written with
+// --trace (trace.h), or renders them in the text views of the
+// old LOG_PROCESSING dumps:
+//
+//    traceDump trace.bin                 one line per record
+//    traceDump trace.bin prefix          prefix_<frame>_msgs.dat,
+//                                        prefix_<frame>_chanin.dat,
+//                                        prefix_<frame>_noise.dat
+//
+// --frame=k renders or lists only frame k.
+//==============================================================
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cmath>
+using namespace std;
+
+#include "trace.h"
+#include "options.h"
+
+
+// The low width bits of v, most significant first (as std::bitset prints).
+static string bits(unsigned long v, int width)
+{
+  string s(width,'0');
+  for (int b=0; b<width; b++)
+    if ((v >> b) & 1)
+      s[width-1-b] = '1';
+  return s;
+}
+
+
+// Sign-magnitude NQ-bit sample to the odd integer it represents
+// (unpack() in NGDBFhw.cpp).
+static int unpack(unsigned long sample, int NQ)
+{
+  unsigned long b = ((sample << 1) | 1) & ((1UL << (NQ+1)) - 1);
+  if (b & (1UL << NQ))
+    return -(long) (b & ((1UL << NQ) - 1));
+  return b;
+}
+
+
+static void writeViews(trace_struct & tr, const string & prefix)
+{
+  trace_record & r = tr.rec;
+  int N = tr.N, M = tr.M, NQ = tr.NQ;
+  stringstream base;
+  base << prefix << "_" << r.frame;
+
+  ofstream ofchanin((base.str() + "_chanin.dat").c_str(),ios::trunc);
+  for (int idx=0; idx<N; idx++)
+    ofchanin << bits(r.yprime[idx],NQ) << "\n";
+  ofchanin.close();
+
+  ofstream ofnoise((base.str() + "_noise.dat").c_str(),ios::trunc);
+  for (int idx=0; idx<tr.Q; idx++)
+    ofnoise << bits(r.qprime[idx],NQ) << "\n";
+  ofnoise.close();
+
+  ofstream ofmsgs((base.str() + "_msgs.dat").c_str(),ios::trunc);
+  ofmsgs << "GLOBALS:\n\ttheta = " << tr.theta << "(" << bits((unsigned long) tr.theta,NQ+1) << ")\n";
+  ofmsgs << "\tSmult = " << tr.Smult << "\n";
+  for (int t=0; t<r.it.size(); t++)
+    {
+      const unsigned char * d = &r.d[(size_t) t*N];
+      const unsigned char * flip = &r.flip[(size_t) t*N];
+      const short * E = &r.E[(size_t) t*N];
+      const unsigned char * syndrome = &r.syndrome[(size_t) t*M];
+      int qpointer = r.qpointer[t];
+      ofmsgs << "IT " << r.it[t] << "\n";
+      for (int idx=0; idx<N; idx++)
+	{
+	  unsigned long yul = r.yprime[idx];
+	  ofmsgs << "S" << idx << ":\n";
+	  ofmsgs << "\tchan_msg, x: " << r.y[idx] << " " << r.y[idx]/(2.0*tr.w) << " " << yul << " (" << bits(yul,NQ) << ") ["
+		 << unpack(yul,NQ) << "], " << (int) d[idx] << "\n";
+
+	  ofmsgs << "\tin_messages: ";
+	  int SSum = 0;
+	  for (int jdx=0; jdx<tr.num_nlist[idx]; jdx++)
+	    {
+	      int msg = syndrome[tr.nlist[tr.nlistStart[idx]+jdx]];
+	      ofmsgs << msg << " ";
+	      SSum += 1-msg;
+	    }
+	  unsigned long Sul = SSum*tr.Smult;
+	  ofmsgs << "\n\tS: " << SSum << " " << " (" << Sul << "," << bits(Sul,NQ+1) << ")";
+	  unsigned long uq = r.qprime[idx+qpointer];
+	  ofmsgs << "\n\tq: " << r.qmodified[idx+qpointer] << " " << uq << " (" << bits(uq,NQ+1) << ")";
+	  ofmsgs << " [" << unpack(uq,NQ) << "]";
+	  ofmsgs << "\n\tE: " << E[idx] << "\n";
+	  ofmsgs << "\ttheta: " << r.theta[t] << "\n";
+	  ofmsgs << "\tflip: " << (int) flip[idx] << "\n";
+	}
+    }
+  ofmsgs.close();
+  cout << "Wrote " << base.str() << "_msgs.dat, _chanin.dat and _noise.dat" << endl;
+}
+
+
+int main(int argc, char * argv[])
+{
+  const char * options = "[--frame=k]";
+  parseOptions(argc,argv,options);
+  if ((argc != 2) && (argc != 3))
+    {
+      cout << "Usage: " << argv[0] << " tracefile [outprefix] " << options << "\n";
+      return 0;
+    }
+
+  trace_struct tr;
+  if (!openTrace(tr,argv[1]))
+    {
+      cout << "Error: " << argv[1] << " is not a decoder trace." << endl;
+      return 1;
+    }
+  cout << "N=" << tr.N << ", M=" << tr.M << ", NQ=" << tr.NQ << ", SNR=" << tr.SNR << "\n"
+       << "Written by: " << tr.text << endl;
+
+  bool oneFrame = hasOption("frame");
+  long frame = optionLong("frame",0);
+  if (argc == 2)
+    cout << "frame\terrors\titerations\tphases\ttraced\n";
+  while (readTraceRecord(tr))
+    {
+      trace_record & r = tr.rec;
+      if (oneFrame && (r.frame != frame))
+	continue;
+      if (argc == 3)
+	writeViews(tr,argv[2]);
+      else
+	cout << r.frame << "\t" << r.errors << "\t" << r.iterations << "\t"
+	     << r.phaseIterations.size() << "\t" << r.it.size() << "\n";
+    }
+  closeTrace(tr);
+  return 0;
+}